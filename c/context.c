@@ -28,10 +28,214 @@
 #  include <config.h>
 #endif
 
+#include <ctype.h>
 #include <string.h>
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>
+#endif
 #include "rdfa_utils.h"
 #include "rdfa.h"
 
+static void rdfa_free_element_context(rdfacontext* context);
+
+/**
+ * The RDFa 1.1 initial context, which declares these prefixes and terms.
+ */
+static const struct rdfainitialmapping
+{
+   const char* key;
+   const char* value;
+} g_rdfa_1_1_prefixes[] =
+{
+   { "grddl", "http://www.w3.org/2003/g/data-view#" },
+   { "ma", "http://www.w3.org/ns/ma-ont#" },
+   { "owl", "http://www.w3.org/2002/07/owl#" },
+   { "rdf", "http://www.w3.org/1999/02/22-rdf-syntax-ns#" },
+   { "rdfa", "http://www.w3.org/ns/rdfa#" },
+   { "rdfs", "http://www.w3.org/2000/01/rdf-schema#" },
+   { "rif", "http://www.w3.org/2007/rif#" },
+   { "skos", "http://www.w3.org/2004/02/skos/core#" },
+   { "skosxl", "http://www.w3.org/2008/05/skos-xl#" },
+   { "wdr", "http://www.w3.org/2007/05/powder#" },
+   { "void", "http://rdfs.org/ns/void#" },
+   { "wdrs", "http://www.w3.org/2007/05/powder-s#" },
+   { "xhv", "http://www.w3.org/1999/xhtml/vocab#" },
+   { "xml", "http://www.w3.org/XML/1998/namespace" },
+   { "xsd", "http://www.w3.org/2001/XMLSchema#" },
+   { "cc", "http://creativecommons.org/ns#" },
+   { "ctag", "http://commontag.org/ns#" },
+   { "dc", "http://purl.org/dc/terms/" },
+   { "dcterms", "http://purl.org/dc/terms/" },
+   { "foaf", "http://xmlns.com/foaf/0.1/" },
+   { "gr", "http://purl.org/goodrelations/v1#" },
+   { "ical", "http://www.w3.org/2002/12/cal/icaltzd#" },
+   { "og", "http://ogp.me/ns#" },
+   { "rev", "http://purl.org/stuff/rev#" },
+   { "sioc", "http://rdfs.org/sioc/ns#" },
+   { "v", "http://rdf.data-vocabulary.org/#" },
+   { "vcard", "http://www.w3.org/2006/vcard/ns#" },
+   { "schema", "http://schema.org/" }
+};
+
+/* the initial contexts that terms come from */
+#define RDFA_INITIAL_TERMS_1_1 1
+#define RDFA_INITIAL_TERMS_XHTML1 2
+
+/* the vocabulary of most of the XHTML+RDFa terms */
+#define XHV_URI "http://www.w3.org/1999/xhtml/vocab#"
+
+/* a perfect hash of the terms of the initial contexts, no two of them
+ * have the same length, second and last character in this combination.
+ * All of the terms are lowercase and at least two characters long. */
+#define RDFA_TERM_HASH_SIZE 64
+#define RDFA_TERM_HASH(length, second, last) \
+   ((5 * (length) + (second) + 3 * (last)) & (RDFA_TERM_HASH_SIZE - 1))
+
+/**
+ * The terms of the RDFa 1.1 and the XHTML+RDFa initial contexts, in the
+ * slots given by RDFA_TERM_HASH(), with the initial contexts that declare
+ * them. The role term is from the role attribute module.
+ */
+static const struct
+{
+   const char* term;
+   const char* iri;
+   int initial_terms;
+} g_rdfa_initial_terms[RDFA_TERM_HASH_SIZE] =
+{
+   { "appendix", XHV_URI "appendix", RDFA_INITIAL_TERMS_XHTML1 },
+   { "icon", XHV_URI "icon", RDFA_INITIAL_TERMS_XHTML1 },
+   { "stylesheet", XHV_URI "stylesheet", RDFA_INITIAL_TERMS_XHTML1 },
+   { NULL, NULL, 0 },
+   { NULL, NULL, 0 },
+   { NULL, NULL, 0 },
+   { NULL, NULL, 0 },
+   { "describedby", "http://www.w3.org/2007/05/powder-s#describedby",
+      RDFA_INITIAL_TERMS_1_1 },
+   { "alternate", XHV_URI "alternate", RDFA_INITIAL_TERMS_XHTML1 },
+   { "help", XHV_URI "help", RDFA_INITIAL_TERMS_XHTML1 },
+   { "up", XHV_URI "up", RDFA_INITIAL_TERMS_XHTML1 },
+   { NULL, NULL, 0 },
+   { NULL, NULL, 0 },
+   { NULL, NULL, 0 },
+   { "top", XHV_URI "top", RDFA_INITIAL_TERMS_XHTML1 },
+   { NULL, NULL, 0 },
+   { NULL, NULL, 0 },
+   { "last", XHV_URI "last", RDFA_INITIAL_TERMS_XHTML1 },
+   { "section", XHV_URI "section", RDFA_INITIAL_TERMS_XHTML1 },
+   { NULL, NULL, 0 },
+   { NULL, NULL, 0 },
+   { "next", XHV_URI "next", RDFA_INITIAL_TERMS_XHTML1 },
+   { NULL, NULL, 0 },
+   { NULL, NULL, 0 },
+   { "bookmark", XHV_URI "bookmark", RDFA_INITIAL_TERMS_XHTML1 },
+   { NULL, NULL, 0 },
+   { NULL, NULL, 0 },
+   { NULL, NULL, 0 },
+   { "meta", XHV_URI "meta", RDFA_INITIAL_TERMS_XHTML1 },
+   { NULL, NULL, 0 },
+   { "first", XHV_URI "first", RDFA_INITIAL_TERMS_XHTML1 },
+   { "p3pv1", XHV_URI "p3pv1", RDFA_INITIAL_TERMS_XHTML1 },
+   { NULL, NULL, 0 },
+   { "chapter", XHV_URI "chapter", RDFA_INITIAL_TERMS_XHTML1 },
+   { NULL, NULL, 0 },
+   { NULL, NULL, 0 },
+   { NULL, NULL, 0 },
+   { NULL, NULL, 0 },
+   { NULL, NULL, 0 },
+   { NULL, NULL, 0 },
+   { "prev", XHV_URI "prev", RDFA_INITIAL_TERMS_XHTML1 },
+   { "start", XHV_URI "start", RDFA_INITIAL_TERMS_XHTML1 },
+   { NULL, NULL, 0 },
+   { NULL, NULL, 0 },
+   { "cite", XHV_URI "cite", RDFA_INITIAL_TERMS_XHTML1 },
+   { NULL, NULL, 0 },
+   { NULL, NULL, 0 },
+   { "index", XHV_URI "index", RDFA_INITIAL_TERMS_XHTML1 },
+   { "contents", XHV_URI "contents", RDFA_INITIAL_TERMS_XHTML1 },
+   { "subsection", XHV_URI "subsection", RDFA_INITIAL_TERMS_XHTML1 },
+   { "role", XHV_URI "role",
+      RDFA_INITIAL_TERMS_1_1 | RDFA_INITIAL_TERMS_XHTML1 },
+   { "previous", XHV_URI "previous", RDFA_INITIAL_TERMS_XHTML1 },
+   { NULL, NULL, 0 },
+   { NULL, NULL, 0 },
+   { NULL, NULL, 0 },
+   { NULL, NULL, 0 },
+   { "copyright", XHV_URI "copyright", RDFA_INITIAL_TERMS_XHTML1 },
+   { NULL, NULL, 0 },
+   { NULL, NULL, 0 },
+   { "license", XHV_URI "license",
+      RDFA_INITIAL_TERMS_1_1 | RDFA_INITIAL_TERMS_XHTML1 },
+   { NULL, NULL, 0 },
+   { NULL, NULL, 0 },
+   { NULL, NULL, 0 },
+   { "glossary", XHV_URI "glossary", RDFA_INITIAL_TERMS_XHTML1 }
+};
+
+#define RDFA_NUM_INITIAL_MAPPINGS(mappings) \
+   (sizeof(mappings) / sizeof(struct rdfainitialmapping))
+
+/* the URI mappings of the RDFa 1.1 initial context are built once and
+ * then shared, read-only, by every context. No terms are declared by
+ * documents, so every context shares a mapping without entries for them. */
+static rdfamapping g_rdfa_empty_mapping;
+static rdfamapping* g_rdfa_1_1_uri_mappings = NULL;
+#ifdef HAVE_PTHREAD_H
+static pthread_once_t g_rdfa_initial_mappings_once = PTHREAD_ONCE_INIT;
+#else
+static int g_rdfa_initial_mappings_built = 0;
+#endif
+
+/**
+ * Adds the mappings of an initial context to a mapping.
+ *
+ * @param mapping the mapping to add to.
+ * @param mappings the mappings of the initial context.
+ * @param num_mappings the number of mappings.
+ */
+static void rdfa_add_initial_mappings(rdfamapping* mapping,
+   const struct rdfainitialmapping* mappings, size_t num_mappings)
+{
+   size_t i;
+
+   for(i = 0; i < num_mappings; i++)
+   {
+      rdfa_update_mapping(mapping, mappings[i].key, mappings[i].value,
+         (update_mapping_value_fp)rdfa_replace_string);
+   }
+}
+
+/**
+ * Builds the shared URI mappings of the initial context. They outlive
+ * every context, so they are allocated with the standard allocator.
+ */
+static void rdfa_build_initial_mappings(void)
+{
+   const rdfaallocator* previous_allocator = rdfa_use_allocator(NULL);
+
+   g_rdfa_1_1_uri_mappings = rdfa_create_mapping(MAX_URI_MAPPINGS);
+   rdfa_add_initial_mappings(g_rdfa_1_1_uri_mappings, g_rdfa_1_1_prefixes,
+      RDFA_NUM_INITIAL_MAPPINGS(g_rdfa_1_1_prefixes));
+   rdfa_use_allocator(previous_allocator);
+}
+
+/**
+ * Builds the shared URI mappings of the initial context if they haven't
+ * been built yet.
+ */
+static void rdfa_ensure_initial_mappings(void)
+{
+#ifdef HAVE_PTHREAD_H
+   pthread_once(&g_rdfa_initial_mappings_once, &rdfa_build_initial_mappings);
+#else
+   if(!g_rdfa_initial_mappings_built)
+   {
+      rdfa_build_initial_mappings();
+      g_rdfa_initial_mappings_built = 1;
+   }
+#endif
+}
+
 rdfacontext* rdfa_create_context(const char* base)
 {
    rdfacontext* rval = NULL;
@@ -41,8 +245,10 @@ rdfacontext* rdfa_create_context(const char* base)
    if(base_length > 0)
    {
       char* cleaned_base;
+      const rdfaallocator* previous_allocator;
 
-      /* malloc and init whole context to NULL */
+      /* the root context is always allocated with the standard allocator
+       * because an allocator can only be set once the context exists */
       rval = (rdfacontext*)malloc(sizeof(rdfacontext));
       if(!rval)
          return NULL;
@@ -50,9 +256,11 @@ rdfacontext* rdfa_create_context(const char* base)
       memset(rval, 0, sizeof(rdfacontext));
 
       /* clean and initialize base */
+      previous_allocator = rdfa_use_allocator(NULL);
       cleaned_base = rdfa_iri_get_base(base);
-      rval->base = rdfa_replace_string(rval->base, cleaned_base);
-      free(cleaned_base);
+      rdfa_update_base(rval, cleaned_base);
+      rdfa_free(cleaned_base);
+      rdfa_use_allocator(previous_allocator);
    }
    else
    {
@@ -81,16 +289,24 @@ void rdfa_init_context(rdfacontext* context)
       char* cleaned_base = rdfa_iri_get_base(context->base);
       context->parent_subject =
          rdfa_replace_string(context->parent_subject, cleaned_base);
-      free(cleaned_base);
+      rdfa_free(cleaned_base);
    }
 
    /* the [parent object] is set to null; */
    context->parent_object = NULL;
 
+   /* none of the resources is a bnode yet */
+   context->parent_subject_bnode = RDFA_NO_BNODE;
+   context->parent_object_bnode = RDFA_NO_BNODE;
+
+   /* _: doesn't refer to a bnode until it is first used */
+   context->underscore_colon_bnode = RDFA_NO_BNODE;
+
 #ifdef LIBRDFA_IN_RAPTOR
 #else
    /* the [list of URI mappings] is cleared; */
    context->uri_mappings = rdfa_create_mapping(MAX_URI_MAPPINGS);
+   context->prefix_scope = context;
 #endif
 
    /* the [list of incomplete triples] is cleared; */
@@ -104,7 +320,7 @@ void rdfa_init_context(rdfacontext* context)
 
    /* the list of term mappings is set to null
     * (or a list defined in the initial context of the Host Language). */
-   context->term_mappings = rdfa_create_mapping(MAX_TERM_MAPPINGS);
+   context->term_mappings = &g_rdfa_empty_mapping;
 
    /* the maximum number of list mappings */
    context->list_mappings = rdfa_create_mapping(MAX_LIST_MAPPINGS);
@@ -136,9 +352,11 @@ void rdfa_init_context(rdfacontext* context)
 
    /* * [new subject] is set to null; */
    context->new_subject = NULL;
+   context->new_subject_bnode = RDFA_NO_BNODE;
 
    /* * [current object resource] is set to null; */
    context->current_object_resource = NULL;
+   context->current_object_resource_bnode = RDFA_NO_BNODE;
 
    /* * the [local list of URI mappings] is set to the list of URI
     *   mappings from the [evaluation context];
@@ -154,185 +372,87 @@ void rdfa_init_context(rdfacontext* context)
     *   NOTE: This step is done in rdfa_create_new_element_context() */
 }
 
-#ifdef LIBRDFA_IN_RAPTOR
-#define DECLARE_URI_MAPPING(context, prefix, value)                     \
-do {                                                                    \
-    raptor_namespace_stack* nstack = &context->sax2->namespaces;        \
-    raptor_namespace* ns = raptor_new_namespace(nstack,                 \
-      (const unsigned char *)prefix, (const unsigned char*)value, 0);   \
-    raptor_namespaces_start_namespace(nstack, ns);                      \
-    } while(0)
-#else
-#define DECLARE_URI_MAPPING(context, prefix, value)                     \
-  rdfa_update_mapping(context->uri_mappings, prefix, value,             \
-                      (update_mapping_value_fp)rdfa_replace_string)
-#endif
+const char* rdfa_get_term_mapping_view(
+   rdfacontext* context, rdfaview term, int fold_case)
+{
+   if(term.length >= 2)
+   {
+      int second = (unsigned char)term.data[1];
+      int last = (unsigned char)term.data[term.length - 1];
+      const char* name;
+      size_t i;
+
+      if(fold_case)
+      {
+         second = tolower(second);
+         last = tolower(last);
+      }
+      i = RDFA_TERM_HASH(term.length, second, last);
+      name = g_rdfa_initial_terms[i].term;
+
+      if(name != NULL &&
+         (g_rdfa_initial_terms[i].initial_terms & context->initial_terms))
+      {
+         size_t c;
+
+         for(c = 0; c < term.length && name[c] != '\0'; c++)
+         {
+            int ch = (unsigned char)term.data[c];
+
+            if((fold_case ? tolower(ch) : ch) != name[c])
+            {
+               break;
+            }
+         }
+         if(c == term.length && name[c] == '\0')
+         {
+            return g_rdfa_initial_terms[i].iri;
+         }
+      }
+   }
+
+   /* the term isn't one of the initial terms */
+   return (const char*)rdfa_get_mapping_view(context->term_mappings, term);
+}
 
 void rdfa_setup_initial_context(rdfacontext* context)
 {
+   int terms = 0;
 #ifdef LIBRDFA_IN_RAPTOR
+   size_t i;
 #else
    char* key = NULL;
    void* value = NULL;
-   void** mptr = context->uri_mappings;
+   size_t mindex = 0;
 #endif
 
+   rdfa_ensure_initial_mappings();
+
    /* Setup the base RDFa 1.1 prefix and term mappings */
    if(context->rdfa_version == RDFA_VERSION_1_1)
    {
-      /* Setup the base RDFa 1.1 prefix mappings */
-      DECLARE_URI_MAPPING(context,
-         "grddl", "http://www.w3.org/2003/g/data-view#");
-      DECLARE_URI_MAPPING(context,
-         "ma", "http://www.w3.org/ns/ma-ont#");
-      DECLARE_URI_MAPPING(context,
-         "owl", "http://www.w3.org/2002/07/owl#");
-      DECLARE_URI_MAPPING(context,
-         "rdf", "http://www.w3.org/1999/02/22-rdf-syntax-ns#");
-      DECLARE_URI_MAPPING(context,
-         "rdfa", "http://www.w3.org/ns/rdfa#");
-      DECLARE_URI_MAPPING(context,
-         "rdfs", "http://www.w3.org/2000/01/rdf-schema#");
-      DECLARE_URI_MAPPING(context,
-         "rif", "http://www.w3.org/2007/rif#");
-      DECLARE_URI_MAPPING(context,
-         "skos", "http://www.w3.org/2004/02/skos/core#");
-      DECLARE_URI_MAPPING(context,
-         "skosxl", "http://www.w3.org/2008/05/skos-xl#");
-      DECLARE_URI_MAPPING(context,
-         "wdr", "http://www.w3.org/2007/05/powder#");
-      DECLARE_URI_MAPPING(context,
-         "void", "http://rdfs.org/ns/void#");
-      DECLARE_URI_MAPPING(context,
-         "wdrs", "http://www.w3.org/2007/05/powder-s#");
-      DECLARE_URI_MAPPING(context,
-         "xhv", "http://www.w3.org/1999/xhtml/vocab#");
-      DECLARE_URI_MAPPING(context,
-         "xml", "http://www.w3.org/XML/1998/namespace");
-      DECLARE_URI_MAPPING(context,
-         "xsd", "http://www.w3.org/2001/XMLSchema#");
-      DECLARE_URI_MAPPING(context,
-         "cc", "http://creativecommons.org/ns#");
-      DECLARE_URI_MAPPING(context,
-         "ctag", "http://commontag.org/ns#");
-      DECLARE_URI_MAPPING(context,
-         "dc", "http://purl.org/dc/terms/");
-      DECLARE_URI_MAPPING(context,
-         "dcterms", "http://purl.org/dc/terms/");
-      DECLARE_URI_MAPPING(context,
-         "foaf", "http://xmlns.com/foaf/0.1/");
-      DECLARE_URI_MAPPING(context,
-         "gr", "http://purl.org/goodrelations/v1#");
-      DECLARE_URI_MAPPING(context,
-         "ical", "http://www.w3.org/2002/12/cal/icaltzd#");
-      DECLARE_URI_MAPPING(context,
-         "og", "http://ogp.me/ns#");
-      DECLARE_URI_MAPPING(context,
-         "rev", "http://purl.org/stuff/rev#");
-      DECLARE_URI_MAPPING(context,
-         "sioc", "http://rdfs.org/sioc/ns#");
-      DECLARE_URI_MAPPING(context,
-         "v", "http://rdf.data-vocabulary.org/#");
-      DECLARE_URI_MAPPING(context,
-         "vcard", "http://www.w3.org/2006/vcard/ns#");
-      DECLARE_URI_MAPPING(context,
-         "schema", "http://schema.org/");
-
-      /* Setup the base RDFa 1.1 term mappings */
-      rdfa_update_mapping(context->term_mappings,
-         "describedby", "http://www.w3.org/2007/05/powder-s#describedby",
-         (update_mapping_value_fp)rdfa_replace_string);
-      rdfa_update_mapping(context->term_mappings,
-         "license", "http://www.w3.org/1999/xhtml/vocab#license",
-         (update_mapping_value_fp)rdfa_replace_string);
-      rdfa_update_mapping(context->term_mappings,
-         "role", "http://www.w3.org/1999/xhtml/vocab#role",
-         (update_mapping_value_fp)rdfa_replace_string);
+#ifdef LIBRDFA_IN_RAPTOR
+      raptor_namespace_stack* nstack = &context->sax2->namespaces;
+
+      for(i = 0; i < RDFA_NUM_INITIAL_MAPPINGS(g_rdfa_1_1_prefixes); i++)
+      {
+         raptor_namespace* ns = raptor_new_namespace(nstack,
+            (const unsigned char*)g_rdfa_1_1_prefixes[i].key,
+            (const unsigned char*)g_rdfa_1_1_prefixes[i].value, 0);
+         raptor_namespaces_start_namespace(nstack, ns);
+      }
+#else
+      /* the prefixes are looked up in the initial URI mappings when the
+       * document hasn't declared them */
+      context->initial_uri_mappings = g_rdfa_1_1_uri_mappings;
+#endif
+      terms |= RDFA_INITIAL_TERMS_1_1;
    }
 
    /* Setup the term mappings for XHTML1 */
    if(context->host_language == HOST_LANGUAGE_XHTML1)
    {
-      rdfa_update_mapping(context->term_mappings,
-         "alternate", "http://www.w3.org/1999/xhtml/vocab#alternate",
-         (update_mapping_value_fp)rdfa_replace_string);
-      rdfa_update_mapping(context->term_mappings,
-         "appendix", "http://www.w3.org/1999/xhtml/vocab#appendix",
-         (update_mapping_value_fp)rdfa_replace_string);
-      rdfa_update_mapping(context->term_mappings,
-         "cite", "http://www.w3.org/1999/xhtml/vocab#cite",
-         (update_mapping_value_fp)rdfa_replace_string);
-      rdfa_update_mapping(context->term_mappings,
-         "bookmark", "http://www.w3.org/1999/xhtml/vocab#bookmark",
-         (update_mapping_value_fp)rdfa_replace_string);
-      rdfa_update_mapping(context->term_mappings,
-         "contents", "http://www.w3.org/1999/xhtml/vocab#contents",
-         (update_mapping_value_fp)rdfa_replace_string);
-      rdfa_update_mapping(context->term_mappings,
-         "chapter", "http://www.w3.org/1999/xhtml/vocab#chapter",
-         (update_mapping_value_fp)rdfa_replace_string);
-      rdfa_update_mapping(context->term_mappings,
-         "copyright", "http://www.w3.org/1999/xhtml/vocab#copyright",
-         (update_mapping_value_fp)rdfa_replace_string);
-      rdfa_update_mapping(context->term_mappings,
-         "first", "http://www.w3.org/1999/xhtml/vocab#first",
-         (update_mapping_value_fp)rdfa_replace_string);
-      rdfa_update_mapping(context->term_mappings,
-         "glossary", "http://www.w3.org/1999/xhtml/vocab#glossary",
-         (update_mapping_value_fp)rdfa_replace_string);
-      rdfa_update_mapping(context->term_mappings,
-         "help", "http://www.w3.org/1999/xhtml/vocab#help",
-         (update_mapping_value_fp)rdfa_replace_string);
-      rdfa_update_mapping(context->term_mappings,
-         "icon", "http://www.w3.org/1999/xhtml/vocab#icon",
-         (update_mapping_value_fp)rdfa_replace_string);
-      rdfa_update_mapping(context->term_mappings,
-         "index", "http://www.w3.org/1999/xhtml/vocab#index",
-         (update_mapping_value_fp)rdfa_replace_string);
-      rdfa_update_mapping(context->term_mappings,
-         "last", "http://www.w3.org/1999/xhtml/vocab#last",
-         (update_mapping_value_fp)rdfa_replace_string);
-      rdfa_update_mapping(context->term_mappings,
-         "license", "http://www.w3.org/1999/xhtml/vocab#license",
-         (update_mapping_value_fp)rdfa_replace_string);
-      rdfa_update_mapping(context->term_mappings,
-         "meta", "http://www.w3.org/1999/xhtml/vocab#meta",
-         (update_mapping_value_fp)rdfa_replace_string);
-      rdfa_update_mapping(context->term_mappings,
-         "next", "http://www.w3.org/1999/xhtml/vocab#next",
-         (update_mapping_value_fp)rdfa_replace_string);
-      rdfa_update_mapping(context->term_mappings,
-         "prev", "http://www.w3.org/1999/xhtml/vocab#prev",
-         (update_mapping_value_fp)rdfa_replace_string);
-      rdfa_update_mapping(context->term_mappings,
-         "previous", "http://www.w3.org/1999/xhtml/vocab#previous",
-         (update_mapping_value_fp)rdfa_replace_string);
-      rdfa_update_mapping(context->term_mappings,
-         "section", "http://www.w3.org/1999/xhtml/vocab#section",
-         (update_mapping_value_fp)rdfa_replace_string);
-      rdfa_update_mapping(context->term_mappings,
-         "start", "http://www.w3.org/1999/xhtml/vocab#start",
-         (update_mapping_value_fp)rdfa_replace_string);
-      rdfa_update_mapping(context->term_mappings,
-         "stylesheet", "http://www.w3.org/1999/xhtml/vocab#stylesheet",
-         (update_mapping_value_fp)rdfa_replace_string);
-      rdfa_update_mapping(context->term_mappings,
-         "subsection", "http://www.w3.org/1999/xhtml/vocab#subsection",
-         (update_mapping_value_fp)rdfa_replace_string);
-      rdfa_update_mapping(context->term_mappings,
-         "top", "http://www.w3.org/1999/xhtml/vocab#top",
-         (update_mapping_value_fp)rdfa_replace_string);
-      rdfa_update_mapping(context->term_mappings,
-         "up", "http://www.w3.org/1999/xhtml/vocab#up",
-         (update_mapping_value_fp)rdfa_replace_string);
-      rdfa_update_mapping(context->term_mappings,
-         "p3pv1", "http://www.w3.org/1999/xhtml/vocab#p3pv1",
-         (update_mapping_value_fp)rdfa_replace_string);
-
-      /* From the role attribute module */
-      rdfa_update_mapping(context->term_mappings,
-         "role", "http://www.w3.org/1999/xhtml/vocab#role",
-         (update_mapping_value_fp)rdfa_replace_string);
+      terms |= RDFA_INITIAL_TERMS_XHTML1;
    }
 
    /* Setup the prefix and term mappings for HTML4 and HTML5 */
@@ -341,14 +461,26 @@ void rdfa_setup_initial_context(rdfacontext* context)
       /* No term or prefix mappings as of 2012-04-04 */
    }
 
+   /* the terms are looked up in the initial terms that are declared by
+    * these initial contexts */
+   context->initial_terms = terms;
+
 #ifdef LIBRDFA_IN_RAPTOR
    /* Raptor does this elsewhere */
 #else
+   /* the base and the initial mappings have changed, so nothing that was
+    * resolved before can be re-used */
+   rdfa_clear_curie_cache(context->curie_cache);
+   rdfa_init_mapping_fingerprint(context);
+
+   /* the xmlns declarations of the initial mappings are serialized again
+    * when they are first needed */
+   rdfa_free(context->xmlns_preamble);
+   context->xmlns_preamble = NULL;
+
    /* Generate namespace triples for all values in the uri_mapping */
-   while(*mptr != NULL)
+   while(rdfa_next_uri_mapping(context, &mindex, &key, &value))
    {
-      rdfa_next_mapping(mptr++, &key, &value);
-      mptr++;
       rdfa_generate_namespace_triple(context, key, value);
    }
 #endif
@@ -356,55 +488,73 @@ void rdfa_setup_initial_context(rdfacontext* context)
 
 /**
  * Creates a new context for the current element by cloning certain
- * parts of the old context on the top of the given stack.
+ * parts of the old context on the top of the given stack. Only the
+ * parts of the context that an element needs are built, the rest of
+ * the context is set up by the element processing rules. Contexts
+ * that were released by elements that have ended are re-used.
  *
  * @param context_stack the context stack that is associated with this
  *                      processing run.
  */
 rdfacontext* rdfa_create_new_element_context(rdfalist* context_stack)
 {
+   rdfacontext* root_context = (rdfacontext*)context_stack->items[0]->data;
    rdfacontext* parent_context = (rdfacontext*)
       context_stack->items[context_stack->num_items - 1]->data;
-   rdfacontext* rval = rdfa_create_context(parent_context->base);
+   rdfacontext* rval = root_context->context_pool;
 
-   if(!rval)
-      return NULL;
+   if(rval != NULL)
+   {
+      /* take a context from the pool, it is already cleared */
+      root_context->context_pool = rval->next_pooled_context;
+      rval->next_pooled_context = NULL;
+   }
+   else
+   {
+      rval = (rdfacontext*)rdfa_malloc(sizeof(rdfacontext));
+      if(!rval)
+         return NULL;
+
+      memset(rval, 0, sizeof(rdfacontext));
+   }
 
    /* * Otherwise, the values are: */
 
    /* * the [ base ] is set to the [ base ] value of the current
     *   [ evaluation context ]; */
    rval->base = rdfa_replace_string(rval->base, parent_context->base);
-   rdfa_init_context(rval);
+   rval->base_parts = parent_context->base_parts;
 
    /* Set the processing depth as parent + 1 */
    rval->depth = parent_context->depth + 1;
 
-   /* copy the URI mappings */
-#ifdef LIBRDFA_IN_RAPTOR
-   /* Raptor does this automatically for URIs */
-#else
-   rdfa_free_mapping(rval->uri_mappings, (free_mapping_value_fp)free);
-#endif
-   rdfa_free_mapping(rval->term_mappings, (free_mapping_value_fp)free);
-   rdfa_free_mapping(rval->list_mappings, (free_mapping_value_fp)rdfa_free_list);
-   rdfa_free_mapping(rval->local_list_mappings, (free_mapping_value_fp)rdfa_free_list);
+   /* share the URI and term mappings, any changes that this element makes
+    * to them are undone by rdfa_restore_mappings() when the element ends */
 #ifdef LIBRDFA_IN_RAPTOR
    /* Raptor does this automatically for URIs */
 #else
-   rval->uri_mappings =
-      rdfa_copy_mapping((void**)parent_context->uri_mappings,
-         (copy_mapping_value_fp)rdfa_replace_string);
+   rval->uri_mappings = parent_context->uri_mappings;
+   rval->initial_uri_mappings = parent_context->initial_uri_mappings;
+   rval->prefix_scope = parent_context->prefix_scope;
 #endif
-   rval->term_mappings =
-      rdfa_copy_mapping((void**)parent_context->term_mappings,
-         (copy_mapping_value_fp)rdfa_replace_string);
-   rval->list_mappings =
-      rdfa_copy_mapping((void**)parent_context->local_list_mappings,
-         (copy_mapping_value_fp)rdfa_replace_list);
-   rval->local_list_mappings =
-      rdfa_copy_mapping((void**)parent_context->local_list_mappings,
-         (copy_mapping_value_fp)rdfa_replace_list);
+   rval->curie_cache = parent_context->curie_cache;
+   rval->mapping_version = parent_context->mapping_version;
+   rval->shared_curie_cache = parent_context->shared_curie_cache;
+   rval->mapping_fingerprint = parent_context->mapping_fingerprint;
+   rval->namespaces = parent_context->namespaces;
+   rval->term_mappings = parent_context->term_mappings;
+   rval->initial_terms = parent_context->initial_terms;
+   rval->shares_mappings = 1;
+
+   /* copy the list mappings */
+   rval->list_mappings = rdfa_replace_mapping(rval->list_mappings,
+      parent_context->local_list_mappings,
+      (copy_mapping_value_fp)rdfa_replace_list,
+      (free_mapping_value_fp)rdfa_free_list);
+   rval->local_list_mappings = rdfa_replace_mapping(rval->local_list_mappings,
+      parent_context->local_list_mappings,
+      (copy_mapping_value_fp)rdfa_replace_list,
+      (free_mapping_value_fp)rdfa_free_list);
 
    /* inherit the parent context's host language and RDFa processor mode */
    rval->host_language = parent_context->host_language;
@@ -417,12 +567,9 @@ rdfacontext* rdfa_create_new_element_context(rdfalist* context_stack)
          rdfa_replace_string(rval->language, parent_context->language);
    }
 
-   /* inherit the parent context's default vocabulary */
-   if(parent_context->default_vocabulary != NULL)
-   {
-      rval->default_vocabulary = rdfa_replace_string(
-         rval->default_vocabulary, parent_context->default_vocabulary);
-   }
+   /* inherit the parent context's default vocabulary, it is only copied
+    * if this element changes it */
+   rval->default_vocabulary = parent_context->default_vocabulary;
 
    /* set the callbacks callback */
    rval->default_graph_triple_callback =
@@ -430,13 +577,15 @@ rdfacontext* rdfa_create_new_element_context(rdfalist* context_stack)
    rval->processor_graph_triple_callback =
       parent_context->processor_graph_triple_callback;
    rval->buffer_filler_callback = parent_context->buffer_filler_callback;
+   rval->literal_chunk_callback = parent_context->literal_chunk_callback;
+   rval->borrowed_triple_callback = parent_context->borrowed_triple_callback;
+   rval->compact_triple_callback = parent_context->compact_triple_callback;
+   rval->namespace_callback = parent_context->namespace_callback;
 
    /* inherit the bnode count, _: bnode name, recurse flag, and state
     * of the xml_literal_namespace_insertion */
    rval->bnode_count = parent_context->bnode_count;
-   rval->underscore_colon_bnode_name =
-      rdfa_replace_string(rval->underscore_colon_bnode_name,
-                          parent_context->underscore_colon_bnode_name);
+   rval->underscore_colon_bnode = parent_context->underscore_colon_bnode;
    rval->recurse = parent_context->recurse;
    rval->skip_element = 0;
    rval->callback_data = parent_context->callback_data;
@@ -444,6 +593,17 @@ rdfacontext* rdfa_create_new_element_context(rdfalist* context_stack)
       parent_context->xml_literal_namespaces_defined;
    rval->xml_literal_xml_lang_defined =
       parent_context->xml_literal_xml_lang_defined;
+   rval->capture_literals = parent_context->capture_literals;
+   rval->streaming_context = parent_context->streaming_context;
+
+   /* the resources of the element aren't set yet */
+   rval->new_subject_bnode = RDFA_NO_BNODE;
+   rval->current_object_resource_bnode = RDFA_NO_BNODE;
+   rval->about_bnode = RDFA_NO_BNODE;
+   rval->typed_resource_bnode = RDFA_NO_BNODE;
+   rval->resource_bnode = RDFA_NO_BNODE;
+   rval->href_bnode = RDFA_NO_BNODE;
+   rval->src_bnode = RDFA_NO_BNODE;
 
 #if 0
    /* inherit the parent context's new_subject
@@ -460,51 +620,65 @@ rdfacontext* rdfa_create_new_element_context(rdfalist* context_stack)
       /* o the [ parent subject ] is set to the value of [ new subject ],
        *   if non-null, or the value of the [ parent subject ] of the
        *   current [ evaluation context ]; */
-      if(parent_context->new_subject != NULL)
+      if(RDFA_RESOURCE_IS_SET(
+         parent_context->new_subject, parent_context->new_subject_bnode))
       {
-         rval->parent_subject = rdfa_replace_string(
-            rval->parent_subject, parent_context->new_subject);
+         rdfa_replace_resource(&rval->parent_subject,
+            &rval->parent_subject_bnode, parent_context->new_subject,
+            parent_context->new_subject_bnode);
       }
       else
       {
-         rval->parent_subject = rdfa_replace_string(
-            rval->parent_subject, parent_context->parent_subject);
+         rdfa_replace_resource(&rval->parent_subject,
+            &rval->parent_subject_bnode, parent_context->parent_subject,
+            parent_context->parent_subject_bnode);
       }
 
       /* o the [ parent object ] is set to value of [ current object
        *   resource ], if non-null, or the value of [ new subject ], if
        *   non-null, or the value of the [ parent subject ] of the
        *   current [ evaluation context ]; */
-      if(parent_context->current_object_resource != NULL)
+      if(RDFA_RESOURCE_IS_SET(parent_context->current_object_resource,
+         parent_context->current_object_resource_bnode))
       {
-         rval->parent_object =
-            rdfa_replace_string(
-               rval->parent_object, parent_context->current_object_resource);
+         rdfa_replace_resource(&rval->parent_object,
+            &rval->parent_object_bnode,
+            parent_context->current_object_resource,
+            parent_context->current_object_resource_bnode);
       }
-      else if(parent_context->new_subject != NULL)
+      else if(RDFA_RESOURCE_IS_SET(
+         parent_context->new_subject, parent_context->new_subject_bnode))
       {
-         rval->parent_object =
-            rdfa_replace_string(
-               rval->parent_object, parent_context->new_subject);
+         rdfa_replace_resource(&rval->parent_object,
+            &rval->parent_object_bnode, parent_context->new_subject,
+            parent_context->new_subject_bnode);
       }
       else
       {
-         rval->parent_object =
-            rdfa_replace_string(
-               rval->parent_object, parent_context->parent_subject);
+         rdfa_replace_resource(&rval->parent_object,
+            &rval->parent_object_bnode, parent_context->parent_subject,
+            parent_context->parent_subject_bnode);
       }
 
       /* o the [ list of incomplete triples ] is set to the [ local list
        *   of incomplete triples ]; */
       rval->incomplete_triples = rdfa_replace_list(
          rval->incomplete_triples, parent_context->local_incomplete_triples);
+
+      /* * the [local list of incomplete triples] is set to null; */
+      if(rval->local_incomplete_triples == NULL)
+      {
+         rval->local_incomplete_triples = rdfa_create_list(3);
+      }
    }
    else
    {
-      rval->parent_subject = rdfa_replace_string(
-         rval->parent_subject, parent_context->parent_subject);
-      rval->parent_object = rdfa_replace_string(
-         rval->parent_object, parent_context->parent_object);
+      rdfa_replace_resource(&rval->parent_subject,
+         &rval->parent_subject_bnode, parent_context->parent_subject,
+         parent_context->parent_subject_bnode);
+      rdfa_replace_resource(&rval->parent_object,
+         &rval->parent_object_bnode, parent_context->parent_object,
+         parent_context->parent_object_bnode);
 
       /* copy the incomplete triples */
       rval->incomplete_triples = rdfa_replace_list(
@@ -539,53 +713,162 @@ void rdfa_free_context_stack(rdfacontext* context)
          rval = rdfa_pop_item(context->context_stack);
          if(rval && rval != context)
          {
-            rdfa_free_context((rdfacontext*)rval);
+            rdfa_free_element_context((rdfacontext*)rval);
          }
       }
       while(rval);
-      free(context->context_stack->items);
-      free(context->context_stack);
+      rdfa_free(context->context_stack->items);
+      rdfa_free(context->context_stack);
       context->context_stack = NULL;
    }
+
+   /* free the element contexts that are waiting to be re-used */
+   while(context->context_pool != NULL)
+   {
+      rdfacontext* pooled_context = context->context_pool;
+      context->context_pool = pooled_context->next_pooled_context;
+      rdfa_free_element_context(pooled_context);
+   }
+
+   /* free the element-scoped memory of the parse */
+   rdfa_free_arena(context->arena);
+   context->arena = NULL;
+   rdfa_free_buffer(context->plain_literal_buffer);
+   context->plain_literal_buffer = NULL;
+   rdfa_free_buffer(context->xml_literal_buffer);
+   context->xml_literal_buffer = NULL;
+
+   /* element contexts share the CURIE cache and the namespaces of the
+    * root context */
+   if(!context->shares_mappings)
+   {
+      rdfa_free_curie_cache(context->curie_cache);
+      rdfa_free_mapping(context->namespaces, (free_mapping_value_fp)rdfa_free);
+   }
+   context->curie_cache = NULL;
+   context->namespaces = NULL;
 }
 
-void rdfa_free_context(rdfacontext* context)
+/**
+ * Frees all of the memory that is owned by a context, but not the
+ * context itself.
+ *
+ * @param context the context whose members should be freed.
+ */
+static void rdfa_free_context_members(rdfacontext* context)
 {
-   free(context->base);
-   free(context->default_vocabulary);
-   free(context->parent_subject);
-   free(context->parent_object);
+   /* the element contexts on the stack share the mappings of this
+    * context, so they must be freed first */
+   rdfa_free_context_stack(context);
 
+   if(context->shares_mappings)
+   {
+      /* undo any mapping changes if parsing stopped before the element
+       * was ended */
+      rdfa_restore_mappings(context);
+   }
+   else
+   {
+      rdfa_free(context->default_vocabulary);
 #ifdef LIBRDFA_IN_RAPTOR
 #else
-   rdfa_free_mapping(context->uri_mappings, (free_mapping_value_fp)free);
+      rdfa_free_mapping(
+         context->uri_mappings, (free_mapping_value_fp)rdfa_free);
 #endif
+   }
+
+#ifndef LIBRDFA_IN_RAPTOR
+   rdfa_free(context->xmlns_preamble);
+#endif
+   rdfa_free(context->base);
+   rdfa_free(context->parent_subject);
+   rdfa_free(context->parent_object);
 
-   rdfa_free_mapping(context->term_mappings, (free_mapping_value_fp)free);
    rdfa_free_list(context->incomplete_triples);
    rdfa_free_mapping(context->list_mappings,
       (free_mapping_value_fp)rdfa_free_list);
    rdfa_free_mapping(context->local_list_mappings,
       (free_mapping_value_fp)rdfa_free_list);
-   free(context->language);
-   free(context->underscore_colon_bnode_name);
-   free(context->new_subject);
-   free(context->current_object_resource);
-   free(context->about);
-   free(context->typed_resource);
-   free(context->resource);
-   free(context->href);
-   free(context->src);
-   free(context->content);
-   free(context->datatype);
-   rdfa_free_list(context->property);
-   free(context->plain_literal);
-   free(context->xml_literal);
+   rdfa_free(context->language);
+   rdfa_free(context->new_subject);
+   rdfa_free(context->current_object_resource);
+   rdfa_free(context->about);
+   rdfa_free(context->typed_resource);
+   rdfa_free(context->resource);
+   rdfa_free(context->href);
+   rdfa_free(context->src);
+   /* the content and the property list are allocated from the arena of
+    * the parse */
+   rdfa_free(context->datatype);
 
    /* TODO: These should be moved into their own data structure */
    rdfa_free_list(context->local_incomplete_triples);
 
-   rdfa_free_context_stack(context);
-   free(context->working_buffer);
+   rdfa_free(context->working_buffer);
+}
+
+void rdfa_release_element_context(
+   rdfalist* context_stack, rdfacontext* context)
+{
+   rdfacontext* root_context = (rdfacontext*)context_stack->items[0]->data;
+   rdfamapping* list_mappings = context->list_mappings;
+   rdfamapping* local_list_mappings = context->local_list_mappings;
+   rdfalist* incomplete_triples = context->incomplete_triples;
+   rdfalist* local_incomplete_triples = context->local_incomplete_triples;
+
+   /* keep the memory of the list mappings and the incomplete triple lists
+    * so that the next element doesn't have to allocate it again */
+   if(list_mappings != NULL)
+   {
+      rdfa_clear_mapping(list_mappings, (free_mapping_value_fp)rdfa_free_list);
+   }
+   if(local_list_mappings != NULL)
+   {
+      rdfa_clear_mapping(
+         local_list_mappings, (free_mapping_value_fp)rdfa_free_list);
+   }
+   if(incomplete_triples != NULL)
+   {
+      rdfa_clear_list(incomplete_triples);
+   }
+   if(local_incomplete_triples != NULL)
+   {
+      rdfa_clear_list(local_incomplete_triples);
+   }
+   context->list_mappings = NULL;
+   context->local_list_mappings = NULL;
+   context->incomplete_triples = NULL;
+   context->local_incomplete_triples = NULL;
+
+   /* free everything else and put the context into the pool */
+   rdfa_free_context_members(context);
+   memset(context, 0, sizeof(rdfacontext));
+   context->list_mappings = list_mappings;
+   context->local_list_mappings = local_list_mappings;
+   context->incomplete_triples = incomplete_triples;
+   context->local_incomplete_triples = local_incomplete_triples;
+   context->next_pooled_context = root_context->context_pool;
+   root_context->context_pool = context;
+}
+
+/**
+ * Frees an element context and all of the memory that it owns.
+ *
+ * @param context the element context to free.
+ */
+static void rdfa_free_element_context(rdfacontext* context)
+{
+   rdfa_free_context_members(context);
+   rdfa_free(context);
+}
+
+void rdfa_free_context(rdfacontext* context)
+{
+   /* the members were allocated with the allocator of the context, the
+    * context itself with the standard allocator */
+   const rdfaallocator* previous_allocator =
+      rdfa_use_allocator(&context->allocator);
+   rdfa_free_context_members(context);
+   rdfa_use_allocator(previous_allocator);
    free(context);
 }
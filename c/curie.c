@@ -33,9 +33,11 @@
 #endif
 #include <stdio.h>
 #include <ctype.h>
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>
+#endif
 #include "rdfa_utils.h"
 #include "rdfa.h"
-#include "strtok_r.h"
 
 /* The base XHTML vocab URL is used to resolve URIs that are reserved
  * words. Any reserved listed above is appended to the URL below to
@@ -43,329 +45,405 @@
 #define XHTML_VOCAB_URI "http://www.w3.org/1999/xhtml/vocab#"
 #define XHTML_VOCAB_URI_SIZE 35
 
+/* the kind of cache entries for the tokens of @rel and @rev lists, which
+ * are resolved as XHTML terms first; other entries use the CURIE parse
+ * mode as their kind */
+#define CURIE_CACHE_RELREV_TERM 0x100
+
+/* the number of locks that guard the entries of a shared CURIE cache,
+ * each lock guards every SHARED_CURIE_CACHE_LOCKS-th entry */
+#define SHARED_CURIE_CACHE_LOCKS 16
+
 /**
- * Gets the type of CURIE that is passed to it.
+ * A shared CURIE cache entry remembers what a token resolved to with the
+ * mappings that have a given fingerprint. The token and the IRI are kept
+ * in a single allocation.
+ */
+typedef struct rdfasharedcurieentry
+{
+   char* token;
+   size_t token_length;
+   const char* iri;
+   unsigned int hash;
+   int kind;
+   int rdfa_version;
+   int host_language;
+   rdfafingerprint fingerprint;
+} rdfasharedcurieentry;
+
+/**
+ * The shared CURIE cache is a direct-mapped table like the CURIE cache of
+ * a parse. Its memory doesn't belong to any parse, so it is allocated with
+ * the standard allocator.
+ */
+struct rdfasharedcuriecache
+{
+   rdfasharedcurieentry* entries;
+   size_t size;
+#ifdef HAVE_PTHREAD_H
+   pthread_mutex_t locks[SHARED_CURIE_CACHE_LOCKS];
+#endif
+};
+
+/**
+ * Checks if a view is the same as a given string.
  *
- * @param uri the uri to check.
+ * @param view the view to check.
+ * @param str the NUL-terminated string to compare with.
  *
- * @return either CURIE_TYPE_SAFE, CURIE_TYPE_URI or CURIE_TYPE_INVALID.
+ * @return 1 if the view and the string are the same, 0 otherwise.
  */
-static curie_t rdfa_get_curie_type(const char* uri)
+static int rdfa_view_equals(rdfaview view, const char* str)
 {
-   curie_t rval = CURIE_TYPE_INVALID;
-   
-   if(uri != NULL)
-   {
-      size_t uri_length = strlen(uri);
+   return strlen(str) == view.length &&
+      memcmp(view.data, str, view.length) == 0;
+}
 
-      if((uri[0] == '[') && (uri[uri_length - 1] == ']'))
-      {
-         /* a safe curie starts with [ and ends with ] */
-         rval = CURIE_TYPE_SAFE;
-      }
-      else if(strstr(uri, ":") != NULL)
+/**
+ * Checks if a view contains a given string.
+ *
+ * @param view the view to search.
+ * @param str the NUL-terminated string to search for.
+ *
+ * @return 1 if the string is found in the view, 0 otherwise.
+ */
+static int rdfa_view_contains(rdfaview view, const char* str)
+{
+   size_t length = strlen(str);
+   const char* ptr = view.data;
+   const char* end = view.data + view.length;
+
+   while((size_t)(end - ptr) >= length)
+   {
+      ptr = (const char*)memchr(ptr, str[0], (end - ptr) - length + 1);
+      if(ptr == NULL)
       {
-         /* at this point, it is unknown whether or not the CURIE is
-          * an IRI or an unsafe CURIE */
-         rval = CURIE_TYPE_IRI_OR_UNSAFE;
+         break;
       }
-      else
+      if(memcmp(ptr, str, length) == 0)
       {
-         /* if none of the above match, then the CURIE is probably a
-          * relative IRI */
-         rval = CURIE_TYPE_IRI_OR_UNSAFE;
+         return 1;
       }
+      ptr++;
    }
 
-   return rval;
+   return 0;
 }
 
-char* rdfa_resolve_uri(rdfacontext* context, const char* uri)
+/**
+ * Gets the type of CURIE that is passed to it.
+ *
+ * @param uri the uri to check.
+ *
+ * @return either CURIE_TYPE_SAFE or CURIE_TYPE_IRI_OR_UNSAFE.
+ */
+static curie_t rdfa_get_curie_type(rdfaview uri)
 {
-   char* rval = NULL;
-   char* path_start = NULL;
-   size_t base_length = strlen(context->base);
-   
-   if(strlen(uri) < 1)
-   {
-      /* if a blank URI is given, use the base context */
-      rval = rdfa_replace_string(rval, context->base);
-   }
-   else if(strstr(uri, ":") != NULL)
-   {
-      /* if a IRI is given, don't concatenate */
-      rval = rdfa_replace_string(rval, uri);
-   }
-   else if(uri[0] == '#' || uri[0] == '?')
+   curie_t rval = CURIE_TYPE_IRI_OR_UNSAFE;
+
+   if((uri.length > 0) && (uri.data[0] == '[') &&
+      (uri.data[uri.length - 1] == ']'))
    {
-      /* if a fragment ID or start of a query parameter is given,
-       * concatenate it with the base URI */
-      rval = rdfa_join_string(context->base, uri);
+      /* a safe curie starts with [ and ends with ] */
+      rval = CURIE_TYPE_SAFE;
    }
-   else if(uri[0] == '/')
-   {
-      /* if a relative URI is given, but it starts with a '/', use the
-       * host part concatenated to the given URI */
-      char* tmp = NULL;
-      char* end_index = NULL;
 
-      /* initialize the working-set data */
-      tmp = rdfa_replace_string(tmp, context->base);
-      end_index = strchr(tmp, '/');
+   /* if the CURIE isn't safe, it is unknown at this point whether or not
+    * it is an IRI, an unsafe CURIE or a relative IRI */
 
+   return rval;
+}
 
-      /* find the final '/' character after the host part of the context base. */
-      if(end_index != NULL)
-      {
-	 end_index = strchr(end_index + 1, '/');
-	
-	 if(end_index != NULL)
-	 {
-	    end_index = strchr(end_index + 1, '/');
-         }
-      }
-
-      /* if the '/' character after the host part was found, copy the host
-       * part and append the given URI to the URI, otherwise, append the
-       * host part and the URI part as-is, ensuring that a '/' exists at the
-       * end of the host part. */
-      if(end_index != NULL)
-      {
-         char* rval_copy;
-
-	 *end_index = '\0';
-	 
-	 /* if the '/' character after the host part was found, copy the host
-	  * part and append the given URI to the URI. */
-	 rval_copy = rdfa_replace_string(rval, tmp);
-	 rval = rdfa_join_string(rval_copy, uri);
-         free(rval_copy);
-      }
-      else
-      {
-	 /* append the host part and the URI part as-is, ensuring that a
-	  * '/' exists at the end of the host part. */
- 	 size_t tlen = strlen(tmp) - 1;
-         char* rval_copy;
-
-	 rval_copy = rdfa_replace_string(rval, tmp);
-
-	 if(rval_copy[tlen] == '/')
-	 {
-	    rval_copy[tlen] = '\0';
-	 }
-	 rval = rdfa_join_string(rval_copy, uri);
-         free(rval_copy);
-      }
+/**
+ * Removes the dot-segments from the path of an IRI with a scheme, in
+ * place. The path never grows, so every character is written at or
+ * before the position that it is read from.
+ *
+ * @param iri the NUL-terminated IRI.
+ * @param length the length of the IRI.
+ *
+ * @return the length of the IRI without its dot-segments.
+ */
+static size_t rdfa_remove_dot_segments(char* iri, size_t length)
+{
+   char* sptr;
+   char* dptr;
+   char* dfence;
 
-      free(tmp);
+   /* Find the start of a scheme-based URL path */
+   sptr = strstr(iri, "://");
+   if(sptr == NULL || strstr(sptr, "/.") == NULL)
+   {
+      return length;
    }
-   else
+   sptr = strchr(sptr + 3, '/');
+   if(sptr == NULL)
+   {
+      return length;
+   }
+   dptr = sptr;
+   dfence = sptr;
+
+   /* Process the path portion of the IRI */
+   while(sptr[0] != '?' && sptr[0] != '\0')
    {
-      if((char)context->base[base_length - 1] == '/')
+      if(sptr[0] == '.' && sptr[1] == '.' && sptr[2] == '/')
       {
-         /* if the base URI already ends in /, concatenate */
-         rval = rdfa_join_string(context->base, uri);
+         /* A.  If the input buffer begins with a prefix of "../",
+          * then remove that prefix from the input buffer; otherwise,
+          */
+         sptr += 3;
       }
-      else
+      else if(sptr[0] == '.' && sptr[1] == '/')
       {
-         /* if we have a relative URI, chop off the name of the file
-          * and replace it with the relative pathname */
-         char* end_index = strrchr(context->base, '/');
-
-         if(end_index != NULL)
-         {
-            char* tmpstr = NULL;
-            char* end_index2;
-
-            tmpstr = rdfa_replace_string(tmpstr, context->base);
-            end_index2 = strrchr(tmpstr, '/');
-            if(end_index2 != NULL) {
-              end_index2++;
-              *end_index2 = '\0';
-            }
-
-            rval = rdfa_join_string(tmpstr, uri);
-            free(tmpstr);
-         }
+         /* A.  If the input buffer begins with a prefix of "./",
+          * then remove that prefix from the input buffer; otherwise,
+          */
+         sptr += 2;
       }
-   }
-
-   /* It is possible that rval may be NULL here in OOM scenarios */
-   if(!rval)
-     return NULL;
-
-   /* Find the start of a scheme-based URL path */
-   path_start = (char*)strstr(rval, "://");
-   if(path_start != NULL)
-   {
-      if(strstr(path_start, "/.") != NULL)
+      else if(sptr[0] == '/' && sptr[1] == '.' && sptr[2] == '/')
       {
-         path_start += 3;
-         path_start = strstr(path_start, "/");
+         /* B.  if the input buffer begins with a prefix of "/./",
+          * then replace that prefix with "/" in the input buffer;
+          * otherwise,
+          */
+         sptr += 2;
       }
-      else
+      else if(sptr[0] == '/' && sptr[1] == '.' && sptr[2] == '\0')
       {
-         path_start = NULL;
+         /* B.  if the input buffer begins with a prefix of "/.",
+          * where "." is a complete path segment, then replace that
+          * prefix with "/" in the input buffer; otherwise,
+          */
+         sptr += 1;
+         *sptr = '/';
       }
-   }
-
-   /* remove any dot-segments that remain in the URL for URLs w/ schemes */
-   if(path_start != NULL)
-   {
-      size_t rlen = strlen(rval) + 1;
-      size_t hlen = path_start - rval;
-      char* src = (char*)malloc(rlen + 4);
-      char* sptr = src + hlen;
-      char* dest = (char*)malloc(rlen + 1);
-      char* dptr = dest + hlen;
-      char* dfence = dptr;
-
-      memset(src, 0, rlen + 4);
-      strcpy(src, rval);
-      strncpy(dest, rval, hlen);
-
-      /* Process the path portion of the IRI */
-      while(sptr[0] != '?' && sptr[0] != '\0')
+      else if(sptr[0] == '/' && sptr[1] == '.' && sptr[2] == '.' &&
+         ((sptr[3] == '/') || (sptr[3] == '\0')))
       {
-         if(sptr[0] == '.' && sptr[1] == '.' && sptr[2] == '/')
+         /* C.  if the input buffer begins with a prefix of "/../",
+          * then replace that prefix with "/" in the input buffer and
+          * remove the last segment and its preceding "/" (if any) from
+          * the output buffer; otherwise,
+          */
+         if(sptr[3] == '/')
          {
-            /* A.  If the input buffer begins with a prefix of "../",
-             * then remove that prefix from the input buffer; otherwise,
-             */
             sptr += 3;
          }
-         else if(sptr[0] == '.' && sptr[1] == '/')
-         {
-            /* A.  If the input buffer begins with a prefix of "./",
-             * then remove that prefix from the input buffer; otherwise,
-             */
-            sptr += 2;
-         }
-         else if(sptr[0] == '/' && sptr[1] == '.' && sptr[2] == '/')
+         else
          {
-            /* B.  if the input buffer begins with a prefix of "/./",
-             * then replace that prefix with "/" in the input buffer;
-             * otherwise,
-             */
             sptr += 2;
-         }
-         else if(sptr[0] == '/' && sptr[1] == '.' && sptr[2] == '\0')
-         {
-            /* B.  if the input buffer begins with a prefix of "/.",
-             * where "." is a complete path segment, then replace that
-             * prefix with "/" in the input buffer; otherwise,
-             */
-            sptr += 1;
             *sptr = '/';
          }
-         else if(sptr[0] == '/' && sptr[1] == '.' && sptr[2] == '.' &&
-            ((sptr[3] == '/') || (sptr[3] == '\0')))
-         {
-            /* C.  if the input buffer begins with a prefix of "/../",
-             * then replace that prefix with "/" in the input buffer and
-             * remove the last segment and its preceding "/" (if any) from
-             * the output buffer; otherwise,
-             */
-            if(sptr[3] == '/')
-            {
-               sptr += 3;
-            }
-            else if(sptr[3] == '\0')
-            {
-               sptr += 2;
-               *sptr = '/';
-            }
 
-            /* remove the last segment and the preceding '/' */
-            if(dptr > dfence)
-            {
-               dptr--;
-               if(dptr[0] == '/')
-               {
-                  dptr--;
-               }
-            }
-            while(dptr >= dfence && dptr[0] != '/')
+         /* remove the last segment and the preceding '/' */
+         if(dptr > dfence)
+         {
+            dptr--;
+            if(dptr[0] == '/')
             {
                dptr--;
             }
-            if(dptr >= dfence)
-            {
-               dptr[0] = '\0';
-            }
-            else
-            {
-               dptr = dfence;
-               dptr[0] = '\0';
-            }
-         }
-         else if(sptr[0] == '.' && sptr[1] == '\0')
-         {
-            /* D. if the input buffer consists only of ".", then remove
-             * that from the input buffer; otherwise,
-             */
-            sptr++;
-
          }
-         else if(sptr[0] == '.' && sptr[1] == '.' && sptr[1] == '\0')
+         while(dptr >= dfence && dptr[0] != '/')
          {
-            /* D. if the input buffer consists only of "..", then remove
-             * that from the input buffer; otherwise,
-             */
-            sptr += 2;
+            dptr--;
          }
-         else
+         if(dptr < dfence)
          {
-            /* Copy the path segment */
-            do
-            {
-               *dptr++ = *sptr++;
-               *dptr = '\0';
-            } while(sptr[0] != '/' && sptr[0] != '?' && sptr[0] != '\0');
+            dptr = dfence;
          }
       }
-
-      /* Copy the remaining query parameters */
-      if(sptr[0] == '?')
+      else if(sptr[0] == '.' && sptr[1] == '\0')
       {
-         strcpy(dptr, sptr);
+         /* D. if the input buffer consists only of ".", then remove
+          * that from the input buffer; otherwise,
+          */
+         sptr++;
+      }
+      else if(sptr[0] == '.' && sptr[1] == '.' && sptr[2] == '\0')
+      {
+         /* D. if the input buffer consists only of "..", then remove
+          * that from the input buffer; otherwise,
+          */
+         sptr += 2;
       }
       else
       {
-         dptr[0] = '\0';
+         /* Copy the path segment */
+         do
+         {
+            *dptr++ = *sptr++;
+         } while(sptr[0] != '/' && sptr[0] != '?' && sptr[0] != '\0');
       }
+   }
 
-      free(rval);
-      free(src);
-      rval = dest;
+   /* Copy the remaining query parameters */
+   length -= sptr - iri;
+   memmove(dptr, sptr, length + 1);
+
+   return (dptr - iri) + length;
+}
+
+size_t rdfa_resolve_uri_into(rdfacontext* context, rdfaview uri,
+   char* buffer, size_t buffer_size)
+{
+   const rdfabaseparts* parts = &context->base_parts;
+   size_t base_length;
+   size_t length;
+
+   /* values that are resolved against the base aren't shared with the
+    * parses of other documents */
+   if(context->curie_cache != NULL)
+   {
+      context->curie_cache->uses_base = 1;
+   }
+
+   if(uri.length < 1)
+   {
+      /* if a blank URI is given, use the base context */
+      base_length = parts->length;
+   }
+   else if(memchr(uri.data, ':', uri.length) != NULL)
+   {
+      /* if a IRI is given, don't concatenate */
+      base_length = 0;
+   }
+   else if(uri.data[0] == '#' || uri.data[0] == '?')
+   {
+      /* if a fragment ID or start of a query parameter is given,
+       * concatenate it with the base URI */
+      base_length = parts->length;
+   }
+   else if(uri.data[0] == '/')
+   {
+      /* if a relative URI is given, but it starts with a '/', use the
+       * host part concatenated to the given URI */
+      base_length = parts->authority_end;
+   }
+   else if(parts->directory_end > 0)
+   {
+      /* if we have a relative URI, chop off the name of the file
+       * and replace it with the relative pathname */
+      base_length = parts->directory_end;
+   }
+   else
+   {
+      return RDFA_UNRESOLVED_IRI;
+   }
+
+   /* the dot-segments are removed in place, so the IRI is never longer
+    * than the joined base and uri */
+   length = base_length + uri.length;
+   if(length >= buffer_size)
+   {
+      return length;
+   }
+
+   memcpy(buffer, context->base, base_length);
+   memcpy(buffer + base_length, uri.data, uri.length);
+   buffer[length] = '\0';
+
+   /* remove any dot-segments that remain in the URL for URLs w/ schemes */
+   return rdfa_remove_dot_segments(buffer, length);
+}
+
+/**
+ * Resolves a given uri that is passed as a view by appending it to the
+ * context's base parameter.
+ *
+ * @param context the current processing context.
+ * @param uri the URI part to process.
+ *
+ * @return the fully qualified IRI. The memory returned from this
+ *         function MUST be freed.
+ */
+static char* rdfa_resolve_uri_view(rdfacontext* context, rdfaview uri)
+{
+   char* rval;
+   size_t length = rdfa_resolve_uri_into(context, uri, NULL, 0);
+
+   if(length == RDFA_UNRESOLVED_IRI)
+   {
+      return NULL;
+   }
+
+   /* It is possible that rval may be NULL here in OOM scenarios */
+   rval = (char*)rdfa_malloc(length + 1);
+   if(rval != NULL)
+   {
+      rdfa_resolve_uri_into(context, uri, rval, length + 1);
    }
 
    return rval;
 }
 
+char* rdfa_resolve_uri(rdfacontext* context, const char* uri)
+{
+   rdfaview view;
+
+   view.data = uri;
+   view.length = strlen(uri);
+
+   return rdfa_resolve_uri_view(context, view);
+}
+
 char* rdfa_resolve_curie(
    rdfacontext* context, const char* uri, curieparse_t mode)
 {
-   char* rval = NULL;
-   curie_t ctype = rdfa_get_curie_type(uri);
+   rdfaview view;
 
    if(!uri)
       return NULL;
 
-   if(ctype == CURIE_TYPE_INVALID)
+   view.data = uri;
+   view.length = strlen(uri);
+
+   return rdfa_resolve_curie_view(context, view, mode);
+}
+
+/**
+ * Marks the resolution that is in progress as one that must not be
+ * memoized, because it reported a warning or used the context's blank
+ * node.
+ *
+ * @param context the current processing context.
+ */
+static void rdfa_disable_curie_caching(rdfacontext* context)
+{
+   if(context->curie_cache != NULL)
    {
-      rval = NULL;
+      context->curie_cache->side_effects = 1;
    }
-   else if((ctype == CURIE_TYPE_IRI_OR_UNSAFE) &&
-           ((mode == CURIE_PARSE_HREF_SRC) ||
-            (context->rdfa_version == RDFA_VERSION_1_0 &&
-               mode == CURIE_PARSE_ABOUT_RESOURCE)))
+}
+
+/**
+ * Resolves a given uri that is passed as a view depending on whether or
+ * not it is a fully qualified IRI or a CURIE, without the CURIE cache.
+ *
+ * @param context the current processing context.
+ * @param uri the URI part to process.
+ * @param mode the CURIE processing mode to use when parsing the CURIE.
+ *
+ * @return the fully qualified IRI. The memory returned from this
+ *         function MUST be freed.
+ */
+static char* rdfa_resolve_curie_token(
+   rdfacontext* context, rdfaview uri, curieparse_t mode)
+{
+   char* rval = NULL;
+   curie_t ctype = rdfa_get_curie_type(uri);
+   int has_colon = (memchr(uri.data, ':', uri.length) != NULL);
+
+   if((ctype == CURIE_TYPE_IRI_OR_UNSAFE) &&
+      ((mode == CURIE_PARSE_HREF_SRC) ||
+         (context->rdfa_version == RDFA_VERSION_1_0 &&
+            mode == CURIE_PARSE_ABOUT_RESOURCE)))
    {
       /* If we are parsing something that can take either a CURIE or a
        * URI, and the type is either IRI or UNSAFE, assume that it is
        * an IRI */
-      rval = rdfa_resolve_uri(context, uri);
+      rval = rdfa_resolve_uri_view(context, uri);
    }
 
    /*
@@ -374,22 +452,23 @@ char* rdfa_resolve_curie(
    if(ctype == CURIE_TYPE_IRI_OR_UNSAFE && mode == CURIE_PARSE_PROPERTY)
    {
       const char* term_iri;
-      term_iri = (const char*)rdfa_get_mapping(context->term_mappings, uri);
+      term_iri = rdfa_get_term_mapping_view(context, uri, 0);
       if(term_iri != NULL)
       {
-         rval = strdup(term_iri);
+         rval = rdfa_strdup(term_iri);
       }
-      else if(context->default_vocabulary == NULL && strstr(uri, ":") == NULL)
+      else if(context->default_vocabulary == NULL && !has_colon)
       {
          /* Generate the processor warning if this is a missing term */
-#define FORMAT_1 "The use of the '%s' term was unrecognized by the RDFa processor because it is not a valid term for the current Host Language."
+#define FORMAT_1 "The use of the '%.*s' term was unrecognized by the RDFa processor because it is not a valid term for the current Host Language."
 
+         rdfa_disable_curie_caching(context);
 #ifdef LIBRDFA_IN_RAPTOR
          raptor_parser_warning((raptor_parser*)context->callback_data, 
-                               FORMAT_1, uri);
+                               FORMAT_1, (int)uri.length, uri.data);
 #else
          char msg[1024];
-         snprintf(msg, 1024, FORMAT_1, uri);
+         snprintf(msg, 1024, FORMAT_1, (int)uri.length, uri.data);
 
          rdfa_processor_triples(context, RDFA_PROCESSOR_WARNING, msg);
 #endif
@@ -408,53 +487,46 @@ char* rdfa_resolve_curie(
            (context->rdfa_version == RDFA_VERSION_1_1 &&
               mode == CURIE_PARSE_ABOUT_RESOURCE)))))
    {
-      char* working_copy = NULL;
-      char* wcptr = NULL;
-      char* prefix = NULL;
-      char* curie_reference = NULL;
+      rdfaview rest = uri;
+      rdfaview prefix;
+      rdfaview curie_reference;
+      int has_prefix = 0;
+      int has_reference = 0;
       const char* expanded_prefix = NULL;
 
-      working_copy = (char*)malloc(strlen(uri) + 1);
-      strcpy(working_copy, uri);/*rdfa_replace_string(working_copy, uri);*/
+      /* the prefix and the reference are found in the same way as with
+       * strtok_r(), but as views into the CURIE */
 
       /* if this is a safe CURIE, chop off the beginning and the end */
       if(ctype == CURIE_TYPE_SAFE)
       {
-         prefix = strtok_r(working_copy, "[:]", &wcptr);
-         if(wcptr)
-            curie_reference = strtok_r(NULL, "[]", &wcptr);
+         has_prefix = rdfa_next_view_token(&rest, "[:]", &prefix);
+         has_reference =
+            rdfa_next_view_token(&rest, "[]", &curie_reference);
       }
       else if(ctype == CURIE_TYPE_IRI_OR_UNSAFE)
       {
-         prefix = strtok_r(working_copy, ":", &wcptr);
-         if(wcptr)
-            curie_reference = strtok_r(NULL, "", &wcptr);
+         has_prefix = rdfa_next_view_token(&rest, ":", &prefix);
+         has_reference = rdfa_next_view_token(&rest, "", &curie_reference);
       }
 
       /* fully resolve the prefix and get its length */
 
       /* if a colon was found, but no prefix, use the XHTML vocabulary URI
        * as the expanded prefix */
-      if((uri[0] == ':') || (strcmp(uri, "[:]") == 0))
+      if((uri.length > 0 && uri.data[0] == ':') ||
+         rdfa_view_equals(uri, "[:]"))
       {
          expanded_prefix = XHTML_VOCAB_URI;
          curie_reference = prefix;
-         prefix = NULL;
+         has_reference = has_prefix;
+         has_prefix = 0;
       }
-      else if(uri[0] == ':')
-      {
-         /* FIXME: This looks like a bug - don't know why this code is
-          * in here. I think it's for the case where ":next" is
-          * specified, but the code's not checking that -- manu */
-         expanded_prefix = context->base;
-         curie_reference = prefix;
-         prefix = NULL;
-      }
-      else if(prefix != NULL)
+      else if(has_prefix)
       {
          if((mode != CURIE_PARSE_PROPERTY) &&
             (mode != CURIE_PARSE_RELREV) &&
-            strcmp(prefix, "_") == 0)
+            rdfa_view_equals(prefix, "_"))
          {
             /* if the prefix specifies this as a blank node, then we
              * use the blank node prefix */
@@ -464,7 +536,7 @@ char* rdfa_resolve_curie(
          {
             /* if the prefix was defined, get it from the set of URI mappings. */
 #ifdef LIBRDFA_IN_RAPTOR
-            if(!strcmp(prefix, "xml"))
+            if(rdfa_view_equals(prefix, "xml"))
             {
                expanded_prefix = RAPTOR_GOOD_CAST(const char*, raptor_xml_namespace_uri);
             }
@@ -473,8 +545,8 @@ char* rdfa_resolve_curie(
                raptor_namespace *nspace;
                raptor_uri* ns_uri;
                nspace = raptor_namespaces_find_namespace(&context->sax2->namespaces,
-                                                         (const unsigned char*)prefix,
-                                                         (int)strlen(prefix));
+                                                         (const unsigned char*)prefix.data,
+                                                         (int)prefix.length);
                if(nspace) {
                   ns_uri = raptor_namespace_get_uri(nspace);
                   if(ns_uri)
@@ -482,20 +554,20 @@ char* rdfa_resolve_curie(
                }
             }
 #else
-            expanded_prefix =
-               rdfa_get_mapping(context->uri_mappings, prefix);
+            expanded_prefix = rdfa_get_uri_mapping_view(context, prefix);
 
             /* Generate the processor warning if the prefix was not found */
-            if(expanded_prefix == NULL && strstr(uri, ":") != NULL &&
-               strstr(uri, "://") == NULL)
+            if(expanded_prefix == NULL && has_colon &&
+               !rdfa_view_contains(uri, "://"))
             {
-#define FORMAT_2 "The '%s' prefix was not found. You may want to check that it is declared before it is used, or that it is a valid prefix string."
+#define FORMAT_2 "The '%.*s' prefix was not found. You may want to check that it is declared before it is used, or that it is a valid prefix string."
+               rdfa_disable_curie_caching(context);
 #ifdef LIBRDFA_IN_RAPTOR
               raptor_parser_warning((raptor_parser*)context->callback_data, 
-                                    FORMAT_2, prefix);
+                                    FORMAT_2, (int)prefix.length, prefix.data);
 #else
               char msg[1024];
-              snprintf(msg, 1024, FORMAT_2, prefix);
+              snprintf(msg, 1024, FORMAT_2, (int)prefix.length, prefix.data);
 
                rdfa_processor_triples(context, RDFA_PROCESSOR_WARNING, msg);
 #endif
@@ -504,61 +576,74 @@ char* rdfa_resolve_curie(
          }
       }
 
-      if((expanded_prefix != NULL) && (curie_reference != NULL))
+      if((expanded_prefix != NULL) && has_reference)
       {
          /* if the expanded prefix and the reference exist, generate the
           * full IRI. */
          if(strcmp(expanded_prefix, "_") == 0)
          {
-            rval = rdfa_join_string("_:", curie_reference);
+            rval = rdfa_n_join_string("_:", 2,
+               curie_reference.data, curie_reference.length);
          }
          else
          {
-            rval = rdfa_join_string(expanded_prefix, curie_reference);
+            rval = rdfa_n_join_string(expanded_prefix, strlen(expanded_prefix),
+               curie_reference.data, curie_reference.length);
          }
       }
       else if((expanded_prefix != NULL) && (expanded_prefix[0] != '_') && 
-         (curie_reference == NULL))
+         !has_reference)
       {
          /* if the expanded prefix exists, but the reference is null,
           * generate the CURIE because a reference-less CURIE is still
           * valid */
- 	 rval = rdfa_join_string(expanded_prefix, "");
+ 	 rval = rdfa_strdup(expanded_prefix);
       }
-
-      free(working_copy);
    }
 
    if(rval == NULL)
    {
       /* if we're NULL at this point, the CURIE might be the special
        * unnamed bnode specified by _: */
-      if((strcmp(uri, "[_:]") == 0) || (strcmp(uri, "_:") == 0))
+      if(rdfa_view_equals(uri, "[_:]") || rdfa_view_equals(uri, "_:"))
       {
-         if(context->underscore_colon_bnode_name == NULL)
+         rdfa_disable_curie_caching(context);
+         if(context->underscore_colon_bnode == RDFA_NO_BNODE)
+         {
+            context->underscore_colon_bnode = context->bnode_count++;
+         }
+         context->resolved_bnode = context->underscore_colon_bnode;
+
+         /* the attributes that carry a resource keep the bnode as its
+          * number, only the CURIE lists need its name */
+         if(mode != CURIE_PARSE_ABOUT_RESOURCE && mode != CURIE_PARSE_HREF_SRC)
          {
-            context->underscore_colon_bnode_name = rdfa_create_bnode(context);
+            char name[RDFA_BNODE_NAME_SIZE];
+
+            rval = rdfa_strdup(
+               rdfa_format_bnode(context->underscore_colon_bnode, name));
          }
-         rval = rdfa_replace_string(rval, context->underscore_colon_bnode_name);
       }
       /* if we're NULL at this point and the IRI isn't [], then this might be
        * an IRI */
       else if(context->rdfa_version == RDFA_VERSION_1_1 &&
-         (strcmp(uri, "[]") != 0))
+         !rdfa_view_equals(uri, "[]"))
       {
          if((context->default_vocabulary != NULL) &&
             ((mode == CURIE_PARSE_PROPERTY) || (mode == CURIE_PARSE_RELREV) ||
                (mode == CURIE_PARSE_INSTANCEOF_DATATYPE)) &&
-            (strstr(uri, ":") == NULL))
+            !has_colon)
          {
-            rval = rdfa_join_string(context->default_vocabulary, uri);
+            rval = rdfa_n_join_string(context->default_vocabulary,
+               strlen(context->default_vocabulary), uri.data, uri.length);
          }
          else if(((mode == CURIE_PARSE_PROPERTY) ||
             (mode == CURIE_PARSE_ABOUT_RESOURCE) ||
             (mode == CURIE_PARSE_INSTANCEOF_DATATYPE)) &&
-            (strstr(uri, "_:") == NULL) && (strstr(uri, "[_:") == NULL))
+            !rdfa_view_contains(uri, "_:"))
          {
-            rval = rdfa_resolve_uri(context, uri);
+            /* "[_:" contains "_:" so it doesn't need to be checked */
+            rval = rdfa_resolve_uri_view(context, uri);
          }
       }
    }
@@ -571,9 +656,10 @@ char* rdfa_resolve_curie(
 }
 
 /**
- * Resolves a given uri depending on whether or not it is a fully
- * qualified IRI, a CURIE, or a short-form XHTML reserved word for
- * @rel or @rev as defined in the XHTML+RDFa Syntax Document.
+ * Resolves a given uri that is passed as a view depending on whether or
+ * not it is a fully qualified IRI, a CURIE, or a short-form XHTML
+ * reserved word for @rel or @rev as defined in the XHTML+RDFa Syntax
+ * Document.
  *
  * @param context the current processing context.
  * @param uri the URI part to process.
@@ -582,15 +668,17 @@ char* rdfa_resolve_curie(
  *         due to the given URI not being a short-form XHTML reserved
  *         word. The memory returned from this function MUST be freed.
  */
-char* rdfa_resolve_relrev_curie(rdfacontext* context, const char* uri)
+static char* rdfa_resolve_relrev_curie_view(
+   rdfacontext* context, rdfaview uri)
 {
    char* rval = NULL;
-   const char* resource = uri;
+   rdfaview resource = uri;
 
    /* check to make sure the URI doesn't have an empty prefix */
-   if(uri[0] == ':')
+   if(uri.length > 0 && uri.data[0] == ':')
    {
-      resource++;
+      resource.data++;
+      resource.length--;
    }
 
    /* override reserved words if there is a default vocab defined
@@ -598,34 +686,25 @@ char* rdfa_resolve_relrev_curie(rdfacontext* context, const char* uri)
     * in RDFa 1.1 */
    if(context->default_vocabulary != NULL)
    {
-      rval = rdfa_resolve_curie(context, uri, CURIE_PARSE_RELREV);
+      rval = rdfa_resolve_curie_token(context, uri, CURIE_PARSE_RELREV);
    }
    else if(context->host_language == HOST_LANGUAGE_XHTML1)
    {
       /* search all of the XHTML @rel/@rev reserved words for a
        * case-insensitive match against the given URI */
-      char* term = strdup(resource);
-      char* ptr = NULL;
-
-      for(ptr = term; *ptr; ptr++)
-      {
-         *ptr = tolower(*ptr);
-      }
-
-      rval = (char*)rdfa_get_mapping(context->term_mappings, term);
+      rval = (char*)rdfa_get_term_mapping_view(context, resource, 1);
       if(rval != NULL)
       {
-         rval = strdup(rval);
+         rval = rdfa_strdup(rval);
       }
-      free(term);
    }
    else
    {
       /* Search the term mappings for a match */
-      rval = (char*)rdfa_get_mapping(context->term_mappings, resource);
+      rval = (char*)rdfa_get_term_mapping_view(context, resource, 0);
       if(rval != NULL)
       {
-         rval = strdup(rval);
+         rval = rdfa_strdup(rval);
       }
    }
 
@@ -633,58 +712,558 @@ char* rdfa_resolve_relrev_curie(rdfacontext* context, const char* uri)
     * attempt to resolve the value as a standard CURIE */
    if(rval == NULL)
    {
-      rval = rdfa_resolve_curie(context, uri, CURIE_PARSE_RELREV);
+      rval = rdfa_resolve_curie_token(context, uri, CURIE_PARSE_RELREV);
    }
 
    /* if a CURIE wasn't found, attempt to resolve the value as an IRI */
    if(rval == NULL && (context->rdfa_version == RDFA_VERSION_1_1))
    {
-      rval = rdfa_resolve_uri(context, uri);
+      rval = rdfa_resolve_uri_view(context, uri);
    }
    
    return rval;
 }
 
-rdfalist* rdfa_resolve_curie_list(
-   rdfacontext* rdfa_context, const char* uris, curieparse_t mode)
+rdfacuriecache* rdfa_create_curie_cache(size_t size)
 {
-   rdfalist* rval = rdfa_create_list(3);
-   char* working_uris = NULL;
-   char* uptr = NULL;
-   char* ctoken = NULL;
-   working_uris = rdfa_replace_string(working_uris, uris);
+   rdfacuriecache* cache =
+      (rdfacuriecache*)rdfa_malloc(sizeof(rdfacuriecache));
 
-   /* go through each item in the list of CURIEs and resolve each */
-   ctoken = strtok_r(working_uris, RDFA_WHITESPACE, &uptr);
-   
-   while(ctoken != NULL)
+   cache->entries =
+      (rdfacuriecacheentry*)rdfa_malloc(sizeof(rdfacuriecacheentry) * size);
+   memset(cache->entries, 0, sizeof(rdfacuriecacheentry) * size);
+   cache->size = size;
+   cache->last_mapping_version = 0;
+   cache->side_effects = 0;
+   cache->uses_base = 0;
+
+   return cache;
+}
+
+void rdfa_clear_curie_cache(rdfacuriecache* cache)
+{
+   size_t i;
+
+   if(cache == NULL)
    {
-      char* resolved_curie = NULL;
+      return;
+   }
 
-      if((mode == CURIE_PARSE_INSTANCEOF_DATATYPE) ||
-         (mode == CURIE_PARSE_ABOUT_RESOURCE) ||
-         (mode == CURIE_PARSE_PROPERTY))
+   for(i = 0; i < cache->size; i++)
+   {
+      rdfa_free(cache->entries[i].token);
+   }
+   memset(cache->entries, 0, sizeof(rdfacuriecacheentry) * cache->size);
+}
+
+void rdfa_free_curie_cache(rdfacuriecache* cache)
+{
+   if(cache != NULL)
+   {
+      rdfa_clear_curie_cache(cache);
+      rdfa_free(cache->entries);
+      rdfa_free(cache);
+   }
+}
+
+void rdfa_update_mapping_version(rdfacontext* context)
+{
+   if(context->curie_cache != NULL)
+   {
+      context->mapping_version = ++context->curie_cache->last_mapping_version;
+   }
+}
+
+/**
+ * Hashes a token and the kind of its resolution for the CURIE cache.
+ *
+ * @param token the token to hash.
+ * @param kind the CURIE parse mode or CURIE_CACHE_RELREV_TERM.
+ *
+ * @return the hash of the token and kind.
+ */
+static unsigned int rdfa_hash_curie(rdfaview token, int kind)
+{
+   unsigned int hash = 2166136261u ^ (unsigned int)kind;
+   size_t i;
+
+   for(i = 0; i < token.length; i++)
+   {
+      hash ^= (unsigned char)token.data[i];
+      hash *= 16777619u;
+   }
+
+   return hash;
+}
+
+rdfasharedcuriecache* rdfa_create_shared_curie_cache(size_t size)
+{
+   rdfasharedcuriecache* rval;
+   size_t entries = 1;
+#ifdef HAVE_PTHREAD_H
+   int i;
+#endif
+
+   while(entries < size)
+   {
+      entries <<= 1;
+   }
+
+   rval = (rdfasharedcuriecache*)malloc(sizeof(rdfasharedcuriecache));
+   if(!rval)
+      return NULL;
+
+   rval->entries = (rdfasharedcurieentry*)calloc(
+      entries, sizeof(rdfasharedcurieentry));
+   if(!rval->entries)
+   {
+      free(rval);
+      return NULL;
+   }
+   rval->size = entries;
+#ifdef HAVE_PTHREAD_H
+   for(i = 0; i < SHARED_CURIE_CACHE_LOCKS; i++)
+   {
+      pthread_mutex_init(&rval->locks[i], NULL);
+   }
+#endif
+
+   return rval;
+}
+
+void rdfa_free_shared_curie_cache(rdfasharedcuriecache* cache)
+{
+   size_t i;
+
+   if(cache == NULL)
+   {
+      return;
+   }
+
+   for(i = 0; i < cache->size; i++)
+   {
+      free(cache->entries[i].token);
+   }
+#ifdef HAVE_PTHREAD_H
+   for(i = 0; i < SHARED_CURIE_CACHE_LOCKS; i++)
+   {
+      pthread_mutex_destroy(&cache->locks[i]);
+   }
+#endif
+   free(cache->entries);
+   free(cache);
+}
+
+/**
+ * Locks or unlocks the entry in the given slot of a shared CURIE cache.
+ *
+ * @param cache the shared CURIE cache.
+ * @param slot the slot of the entry.
+ * @param lock 1 to lock the entry, 0 to unlock it.
+ */
+static void rdfa_lock_shared_curie(
+   rdfasharedcuriecache* cache, size_t slot, int lock)
+{
+#ifdef HAVE_PTHREAD_H
+   pthread_mutex_t* mutex = &cache->locks[slot % SHARED_CURIE_CACHE_LOCKS];
+
+   if(lock)
+   {
+      pthread_mutex_lock(mutex);
+   }
+   else
+   {
+      pthread_mutex_unlock(mutex);
+   }
+#endif
+}
+
+/**
+ * Looks up a token in the shared CURIE cache of a context.
+ *
+ * @param context the current processing context.
+ * @param token the token to look up.
+ * @param kind the CURIE parse mode or CURIE_CACHE_RELREV_TERM.
+ * @param hash the hash of the token and kind.
+ * @param iri set to a copy of the IRI that the token resolves to, or NULL
+ *            if it doesn't resolve, when the token is found.
+ *
+ * @return 1 if the token was found, 0 otherwise.
+ */
+static int rdfa_get_shared_curie(rdfacontext* context, rdfaview token,
+   int kind, unsigned int hash, char** iri)
+{
+   rdfasharedcuriecache* cache = context->shared_curie_cache;
+   size_t slot = hash & (cache->size - 1);
+   rdfasharedcurieentry* entry = &cache->entries[slot];
+   int rval = 0;
+
+   rdfa_lock_shared_curie(cache, slot, 1);
+   if(entry->token != NULL && entry->hash == hash && entry->kind == kind &&
+      entry->fingerprint.hash1 == context->mapping_fingerprint.hash1 &&
+      entry->fingerprint.hash2 == context->mapping_fingerprint.hash2 &&
+      entry->rdfa_version == context->rdfa_version &&
+      entry->host_language == context->host_language &&
+      entry->token_length == token.length &&
+      memcmp(entry->token, token.data, token.length) == 0)
+   {
+      *iri = (entry->iri != NULL) ? rdfa_strdup(entry->iri) : NULL;
+      rval = 1;
+   }
+   rdfa_lock_shared_curie(cache, slot, 0);
+
+   return rval;
+}
+
+/**
+ * Stores what a token resolved to in the shared CURIE cache of a context.
+ *
+ * @param context the current processing context.
+ * @param token the token that was resolved.
+ * @param kind the CURIE parse mode or CURIE_CACHE_RELREV_TERM.
+ * @param hash the hash of the token and kind.
+ * @param iri the IRI that the token resolved to, or NULL.
+ */
+static void rdfa_put_shared_curie(rdfacontext* context, rdfaview token,
+   int kind, unsigned int hash, const char* iri)
+{
+   rdfasharedcuriecache* cache = context->shared_curie_cache;
+   size_t slot = hash & (cache->size - 1);
+   rdfasharedcurieentry* entry = &cache->entries[slot];
+   size_t iri_length = (iri != NULL) ? strlen(iri) + 1 : 0;
+   char* text = (char*)malloc(token.length + 1 + iri_length);
+   char* old_text;
+
+   if(!text)
+      return;
+
+   /* the entry is copied outside of the lock */
+   memcpy(text, token.data, token.length);
+   text[token.length] = '\0';
+   if(iri != NULL)
+   {
+      memcpy(text + token.length + 1, iri, iri_length);
+   }
+
+   rdfa_lock_shared_curie(cache, slot, 1);
+   old_text = entry->token;
+   entry->token = text;
+   entry->token_length = token.length;
+   entry->iri = (iri != NULL) ? text + token.length + 1 : NULL;
+   entry->hash = hash;
+   entry->kind = kind;
+   entry->rdfa_version = context->rdfa_version;
+   entry->host_language = context->host_language;
+   entry->fingerprint = context->mapping_fingerprint;
+   rdfa_lock_shared_curie(cache, slot, 0);
+
+   free(old_text);
+}
+
+/**
+ * Finds a token in the CURIE cache, if it was resolved in the same way
+ * with the same URI mappings and default vocabulary before.
+ *
+ * @param context the current processing context.
+ * @param token the token to find.
+ * @param kind the CURIE parse mode or CURIE_CACHE_RELREV_TERM.
+ * @param hash set to the hash of the token.
+ *
+ * @return the cache entry of the token, or NULL if it isn't cached.
+ */
+static rdfacuriecacheentry* rdfa_find_memoized(
+   rdfacontext* context, rdfaview token, int kind, unsigned int* hash)
+{
+   rdfacuriecache* cache = context->curie_cache;
+   rdfacuriecacheentry* entry;
+
+   *hash = rdfa_hash_curie(token, kind);
+   entry = &cache->entries[*hash & (cache->size - 1)];
+   if(entry->token != NULL && entry->hash == *hash && entry->kind == kind &&
+      entry->mapping_version == context->mapping_version &&
+      entry->rdfa_version == context->rdfa_version &&
+      entry->token_length == token.length &&
+      memcmp(entry->token, token.data, token.length) == 0)
+   {
+      return entry;
+   }
+
+   return NULL;
+}
+
+/**
+ * Resolves a token that isn't in the CURIE cache. The result is taken
+ * from the shared CURIE cache or resolved, and remembered unless
+ * resolving it had side effects. Only values that don't depend on the
+ * base are shared.
+ *
+ * @param context the current processing context.
+ * @param token the token to resolve.
+ * @param kind the CURIE parse mode or CURIE_CACHE_RELREV_TERM.
+ * @param hash the hash of the token.
+ *
+ * @return the fully qualified IRI, or NULL if the token doesn't resolve.
+ *         The memory returned from this function MUST be freed.
+ */
+static char* rdfa_memoize(
+   rdfacontext* context, rdfaview token, int kind, unsigned int hash)
+{
+   rdfacuriecache* cache = context->curie_cache;
+   rdfacuriecacheentry* entry = &cache->entries[hash & (cache->size - 1)];
+   char* rval;
+
+   cache->side_effects = 0;
+   cache->uses_base = 0;
+   if(context->shared_curie_cache == NULL ||
+      !rdfa_get_shared_curie(context, token, kind, hash, &rval))
+   {
+      rval = (kind == CURIE_CACHE_RELREV_TERM) ?
+         rdfa_resolve_relrev_curie_view(context, token) :
+         rdfa_resolve_curie_token(context, token, (curieparse_t)kind);
+
+      if(context->shared_curie_cache != NULL &&
+         !cache->side_effects && !cache->uses_base)
+      {
+         rdfa_put_shared_curie(context, token, kind, hash, rval);
+      }
+   }
+
+   if(!cache->side_effects)
+   {
+      size_t iri_length = (rval != NULL) ? strlen(rval) + 1 : 0;
+
+      /* replace the entry that is in the slot */
+      rdfa_free(entry->token);
+      entry->token = (char*)rdfa_malloc(token.length + 1 + iri_length);
+      memcpy(entry->token, token.data, token.length);
+      entry->token[token.length] = '\0';
+      entry->iri = NULL;
+      if(rval != NULL)
       {
-         resolved_curie =
-            rdfa_resolve_curie(rdfa_context, ctoken, mode);
+         memcpy(entry->token + token.length + 1, rval, iri_length);
+         entry->iri = entry->token + token.length + 1;
       }
-      else if(mode == CURIE_PARSE_RELREV)
+      entry->token_length = token.length;
+      entry->hash = hash;
+      entry->kind = kind;
+      entry->rdfa_version = context->rdfa_version;
+      entry->mapping_version = context->mapping_version;
+   }
+
+   return rval;
+}
+
+/**
+ * Resolves a token through the CURIE cache, see rdfa_find_memoized() and
+ * rdfa_memoize().
+ *
+ * @param context the current processing context.
+ * @param token the token to resolve.
+ * @param kind the CURIE parse mode or CURIE_CACHE_RELREV_TERM.
+ *
+ * @return the fully qualified IRI, or NULL if the token doesn't resolve.
+ *         The memory returned from this function MUST be freed.
+ */
+static char* rdfa_resolve_memoized(
+   rdfacontext* context, rdfaview token, int kind)
+{
+   rdfacuriecacheentry* entry;
+   unsigned int hash;
+
+   if(context->curie_cache == NULL)
+   {
+      return (kind == CURIE_CACHE_RELREV_TERM) ?
+         rdfa_resolve_relrev_curie_view(context, token) :
+         rdfa_resolve_curie_token(context, token, (curieparse_t)kind);
+   }
+
+   entry = rdfa_find_memoized(context, token, kind, &hash);
+   if(entry != NULL)
+   {
+      return (entry->iri != NULL) ? rdfa_strdup(entry->iri) : NULL;
+   }
+
+   return rdfa_memoize(context, token, kind, hash);
+}
+
+/**
+ * Resolves a token of a CURIE list without copying an IRI that is in
+ * the CURIE cache.
+ *
+ * @param context the current processing context.
+ * @param token the token to resolve.
+ * @param mode the CURIE parsing mode of the list.
+ * @param resolved set to the IRI if it had to be resolved, which MUST be
+ *                 freed, or to NULL.
+ *
+ * @return the fully qualified IRI, which is owned by the CURIE cache or
+ *         is *resolved, or NULL if the token doesn't resolve. An IRI
+ *         that is owned by the cache is only valid until the next token
+ *         is resolved.
+ */
+static const char* rdfa_resolve_list_token(rdfacontext* context,
+   rdfaview token, curieparse_t mode, char** resolved)
+{
+   rdfacuriecacheentry* entry;
+   unsigned int hash;
+   int kind;
+
+   *resolved = NULL;
+   if((mode == CURIE_PARSE_INSTANCEOF_DATATYPE) ||
+      (mode == CURIE_PARSE_ABOUT_RESOURCE) ||
+      (mode == CURIE_PARSE_PROPERTY))
+   {
+      kind = (int)mode;
+   }
+   else if(mode == CURIE_PARSE_RELREV)
+   {
+      kind = CURIE_CACHE_RELREV_TERM;
+   }
+   else
+   {
+      return NULL;
+   }
+
+   if(context->curie_cache != NULL)
+   {
+      entry = rdfa_find_memoized(context, token, kind, &hash);
+      if(entry != NULL)
       {
-         resolved_curie =
-            rdfa_resolve_relrev_curie(rdfa_context, ctoken);
+         return entry->iri;
       }
+   }
+
+   *resolved = rdfa_resolve_memoized(context, token, kind);
+
+   return *resolved;
+}
+
+char* rdfa_resolve_curie_view(
+   rdfacontext* context, rdfaview uri, curieparse_t mode)
+{
+   return rdfa_resolve_memoized(context, uri, (int)mode);
+}
+
+char* rdfa_resolve_resource_view(
+   rdfacontext* context, rdfaview uri, curieparse_t mode, size_t* bnode)
+{
+   char* rval;
+
+   /* the resolution of _: leaves its number behind, the other values
+    * aren't bnodes that the parser created */
+   context->resolved_bnode = RDFA_NO_BNODE;
+   rval = rdfa_resolve_memoized(context, uri, (int)mode);
+   *bnode = context->resolved_bnode;
+
+   return rval;
+}
+
+/**
+ * Resolves a given uri depending on whether or not it is a fully
+ * qualified IRI, a CURIE, or a short-form XHTML reserved word for
+ * @rel or @rev as defined in the XHTML+RDFa Syntax Document.
+ *
+ * @param context the current processing context.
+ * @param uri the URI part to process.
+ *
+ * @return the fully qualified IRI, or NULL if the conversion failed
+ *         due to the given URI not being a short-form XHTML reserved
+ *         word. The memory returned from this function MUST be freed.
+ */
+char* rdfa_resolve_relrev_curie(rdfacontext* context, const char* uri)
+{
+   rdfaview view;
+
+   view.data = uri;
+   view.length = strlen(uri);
+
+   return rdfa_resolve_memoized(context, view, CURIE_CACHE_RELREV_TERM);
+}
+
+rdfalist* rdfa_resolve_curie_list(
+   rdfacontext* rdfa_context, const char* uris, curieparse_t mode)
+{
+   rdfaview view;
+
+   view.data = uris;
+   view.length = strlen(uris);
+
+   return rdfa_resolve_curie_list_view(rdfa_context, view, mode);
+}
+
+rdfalist* rdfa_resolve_curie_list_view(
+   rdfacontext* rdfa_context, rdfaview uris, curieparse_t mode)
+{
+   rdfalist* rval = rdfa_create_list(3);
+   rdfaview ctoken;
+
+   /* go through each item in the list of CURIEs and resolve each, the
+    * items are views into the list so nothing is copied */
+   while(rdfa_next_whitespace_token(&uris, &ctoken))
+   {
+      char* resolved = NULL;
+      const char* iri =
+         rdfa_resolve_list_token(rdfa_context, ctoken, mode, &resolved);
 
       /* add the CURIE if it was a valid one */
-      if(resolved_curie != NULL)
+      if(iri != NULL)
       {
-         rdfa_add_item(rval, resolved_curie, RDFALIST_FLAG_TEXT);
-         free(resolved_curie);
+         rdfa_add_item(rval, (void*)iri, RDFALIST_FLAG_TEXT);
       }
-      
-      ctoken = strtok_r(NULL, RDFA_WHITESPACE, &uptr);
+      rdfa_free(resolved);
+   }
+
+   return rval;
+}
+
+rdfalist* rdfa_resolve_curie_list_into(rdfacontext* rdfa_context,
+   rdfaview uris, curieparse_t mode, rdfaarena* arena)
+{
+   rdfalist* rval;
+   rdfalistitem* items;
+   rdfaview rest = uris;
+   rdfaview ctoken;
+   size_t num_tokens = 0;
+
+   /* the list can't grow once it is allocated, so it is made large
+    * enough for every token */
+   while(rdfa_next_whitespace_token(&rest, &ctoken))
+   {
+      num_tokens++;
+   }
+   rval = (rdfalist*)rdfa_arena_alloc(arena, sizeof(rdfalist));
+   rval->items = (rdfalistitem**)rdfa_arena_alloc(
+      arena, sizeof(rdfalistitem*) * num_tokens);
+   items = (rdfalistitem*)rdfa_arena_alloc(
+      arena, sizeof(rdfalistitem) * num_tokens);
+   rval->num_items = 0;
+   rval->max_items = num_tokens;
+   rval->user_data = 0;
+
+   while(rdfa_next_whitespace_token(&uris, &ctoken))
+   {
+      char* resolved = NULL;
+      const char* iri;
+
+      rdfa_context->resolved_bnode = RDFA_NO_BNODE;
+      iri = rdfa_resolve_list_token(rdfa_context, ctoken, mode, &resolved);
+
+      /* add the CURIE if it was a valid one, only the CURIEs that
+       * weren't cached have been allocated on the heap */
+      if(iri != NULL)
+      {
+         rdfalistitem* item = &items[rval->num_items];
+
+         item->flags = RDFALIST_FLAG_TEXT;
+         if(rdfa_context->resolved_bnode != RDFA_NO_BNODE)
+         {
+            item->flags |= RDFALIST_FLAG_UNDERSCORE_COLON_BNODE;
+         }
+         item->data = rdfa_arena_strndup(arena, iri, strlen(iri));
+         rval->items[rval->num_items++] = item;
+      }
+      rdfa_free(resolved);
    }
-   
-   free(working_uris);
 
    return rval;
 }
@@ -27,6 +27,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "rdfa_utils.h"
 #include "rdfa.h"
 
 /**
@@ -57,16 +58,54 @@ char* rdfa_iri_get_base(const char* iri)
    {
       /* there was no iquery or ifragment in the input string, so there is
        * no need to reformat the string */
-      rval = strdup(iri);
+      rval = rdfa_strdup(iri);
    }
    else
    {
       /* the output string should be concatenated */
       unsigned int length = (unsigned int)(eindex - iri);
-      rval = (char*)malloc(length + 1);
+      rval = (char*)rdfa_malloc(length + 1);
       rval = strncpy(rval, iri, length);
       rval[length] = '\0';
    }
 
    return rval;
 }
+
+void rdfa_update_base(rdfacontext* context, const char* base)
+{
+   rdfabaseparts* parts = &context->base_parts;
+   const char* end_index;
+
+   context->base = rdfa_replace_string(context->base, base);
+   parts->length = strlen(base);
+
+   /* the path starts at the '/' after the scheme and the authority, if
+    * the base has no path, an absolute path is appended to the whole base
+    * without any '/' at its end */
+   end_index = strchr(base, '/');
+   if(end_index != NULL)
+   {
+      end_index = strchr(end_index + 1, '/');
+      if(end_index != NULL)
+      {
+         end_index = strchr(end_index + 1, '/');
+      }
+   }
+   if(end_index != NULL)
+   {
+      parts->authority_end = end_index - base;
+   }
+   else
+   {
+      parts->authority_end = parts->length;
+      if(parts->authority_end > 0 && base[parts->authority_end - 1] == '/')
+      {
+         parts->authority_end--;
+      }
+   }
+
+   /* a relative path replaces the name of the file */
+   end_index = strrchr(base, '/');
+   parts->directory_end = (end_index != NULL) ? end_index - base + 1 : 0;
+}
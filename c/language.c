@@ -48,7 +48,7 @@ void rdfa_update_language(rdfacontext* context, const char* lang)
       else
       {
          /* if a blank language was specified, clear the language context */
-         free(context->language);
+         rdfa_free(context->language);
          context->language = NULL;
       }
    }
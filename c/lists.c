@@ -33,26 +33,31 @@
 #include "rdfa.h"
 
 void rdfa_establish_new_inlist_triples(rdfacontext* context,
-   rdfalist* predicates, const char* object, rdfresource_t object_type)
+   rdfalist* predicates, const char* object, size_t object_bnode,
+   rdfresource_t object_type)
 {
    int i = 0;
+   char name[RDFA_BNODE_NAME_SIZE];
+   const char* subject = rdfa_resource_name(
+      context->new_subject, context->new_subject_bnode, name);
+
    for(i = 0; i < (int)predicates->num_items; i++)
    {
       const char* predicate = (const char*)predicates->items[i]->data;
       char* resolved_predicate = rdfa_resolve_relrev_curie(context, predicate);
       rdftriple* triple;
       /* ensure the list mapping exists */
-      rdfa_create_list_mapping(
-         context, context->local_list_mappings,
-         context->new_subject, resolved_predicate);
+      rdfa_create_list_mapping(context, context->local_list_mappings,
+         subject, context->new_subject_bnode, resolved_predicate);
 
       /* add an incomplete triple for each list mapping */
-      triple = rdfa_create_triple(context->new_subject, resolved_predicate,
-         object, object_type, context->datatype, context->language);
+      triple = rdfa_create_resource_triple(context->new_subject,
+         context->new_subject_bnode, resolved_predicate, object,
+         object_bnode, object_type, context->datatype, context->language);
       rdfa_append_to_list_mapping(context->local_list_mappings,
-         context->new_subject, resolved_predicate, triple);
+         subject, resolved_predicate, triple);
 
-      free(resolved_predicate);
+      rdfa_free(resolved_predicate);
    }
 
 #if defined(DEBUG) && DEBUG > 0
@@ -66,22 +71,25 @@ void rdfa_save_incomplete_list_triples(
    rdfacontext* context, const rdfalist* rel)
 {
    unsigned int i;
+   char name[RDFA_BNODE_NAME_SIZE];
+   const char* subject = rdfa_resource_name(
+      context->new_subject, context->new_subject_bnode, name);
+
    for(i = 0; i < rel->num_items; i++)
    {
       const char* curie = (const char*)rel->items[i]->data;
       char* resolved_curie = rdfa_resolve_relrev_curie(context, curie);
 
       /* ensure the list mapping exists */
-      rdfa_create_list_mapping(
-         context, context->local_list_mappings,
-         context->new_subject, resolved_curie);
+      rdfa_create_list_mapping(context, context->local_list_mappings,
+         subject, context->new_subject_bnode, resolved_curie);
 
       /* get the list name */
       rdfa_add_item(
          context->local_incomplete_triples, resolved_curie,
          (liflag_t)(RDFALIST_FLAG_DIR_NONE | RDFALIST_FLAG_TEXT));
 
-      free(resolved_curie);
+      rdfa_free(resolved_curie);
    }
 
 #if defined(DEBUG) && DEBUG > 0
@@ -98,11 +106,13 @@ void rdfa_complete_list_triples(rdfacontext* context)
    int i;
    rdfalist* list;
    rdftriple* triple;
-   void** mptr = context->local_list_mappings;
+   size_t mindex = 0;
    char* key = NULL;
-   void** kptr = NULL;
    void* value = NULL;
    unsigned int list_depth = 0;
+   char name[RDFA_BNODE_NAME_SIZE];
+   const char* subject = rdfa_resource_name(
+      context->new_subject, context->new_subject_bnode, name);
 
 #if defined(DEBUG) && DEBUG > 0
    printf("local_list_mappings: ");
@@ -110,13 +120,11 @@ void rdfa_complete_list_triples(rdfacontext* context)
          (print_mapping_value_fp)rdfa_print_triple_list);
 #endif
 
-   while(*mptr != NULL)
+   while(rdfa_next_mapping(
+      context->local_list_mappings, &mindex, &key, &value))
    {
-      kptr = mptr;
-      rdfa_next_mapping(mptr++, &key, &value);
       list = (rdfalist*)value;
       list_depth = list->user_data;
-      mptr++;
 #if defined(DEBUG) && DEBUG > 0
       printf("LIST TRIPLES for key (%u/%u): KEY(%s)\n",
              context->depth, list_depth, key);
@@ -124,8 +132,7 @@ void rdfa_complete_list_triples(rdfacontext* context)
 
       if((context->depth < (int)list_depth) &&
          (rdfa_get_list_mapping(
-            context->list_mappings, context->new_subject, key) == NULL) &&
-         (strcmp(key, RDFA_MAPPING_DELETED_KEY) != 0))
+            context->list_mappings, subject, key) == NULL))
       {
          char* predicate = strstr(key, " ") + 1;
          triple = (rdftriple*)list->items[0]->data;
@@ -135,21 +142,22 @@ void rdfa_complete_list_triples(rdfacontext* context)
             rdfa_free_triple(triple);
 
             /* the list is empty, generate an empty list triple */
-            triple = rdfa_create_triple(context->new_subject, predicate,
+            rdfa_generate_default_graph_triple(context,
+               context->new_subject, context->new_subject_bnode, predicate,
                "http://www.w3.org/1999/02/22-rdf-syntax-ns#nil",
-               RDF_TYPE_IRI, NULL, NULL);
-            context->default_graph_triple_callback(
-               triple, context->callback_data);
+               RDFA_NO_BNODE, RDF_TYPE_IRI, NULL, NULL);
          }
          else
          {
-            char* bnode = NULL;
-            char* subject;
-            char* tmp = NULL;
-            bnode = rdfa_replace_string(bnode, triple->subject);
+            /* the first item of the list links the subject to the bnode
+             * of the list */
+            rdftriple* head = triple;
+            size_t bnode = head->object_bnode;
             for(i = 1; i < (int)list->num_items; i++)
             {
-               char* next = NULL;
+               size_t next = RDFA_NO_BNODE;
+               const char* next_iri = NULL;
+               char bnode_name[RDFA_BNODE_NAME_SIZE];
                triple = (rdftriple*)list->items[i]->data;
                /* Create a new 'bnode' array containing newly created bnodes,
                 * one for each item in the list
@@ -162,16 +170,16 @@ void rdfa_complete_list_triples(rdfacontext* context)
                 *   http://www.w3.org/1999/02/22-rdf-syntax-ns#first
                 * object
                 *   full IRI or literal */
-               triple->subject =
-                  rdfa_replace_string(triple->subject, bnode);
+               triple->subject = rdfa_replace_string(
+                  triple->subject, rdfa_format_bnode(bnode, bnode_name));
+               triple->subject_bnode = bnode;
                triple->predicate =
                   rdfa_replace_string(triple->predicate,
                      "http://www.w3.org/1999/02/22-rdf-syntax-ns#first");
-               context->default_graph_triple_callback(
-                  triple, context->callback_data);
+               rdfa_emit_default_graph_triple(context, triple);
 
                /* Free the list item */
-               free(list->items[i]);
+               rdfa_free(list->items[i]);
                list->items[i] = NULL;
 
                /* For each item in the 'bnode' array the following triple is
@@ -190,17 +198,13 @@ void rdfa_complete_list_triples(rdfacontext* context)
                }
                else
                {
-                  next = strdup((char*)"http://www.w3.org/1999/02/22-rdf-syntax-ns#nil");
+                  next_iri = "http://www.w3.org/1999/02/22-rdf-syntax-ns#nil";
                }
 
-               triple = rdfa_create_triple(bnode,
+               rdfa_generate_default_graph_triple(context, NULL, bnode,
                   "http://www.w3.org/1999/02/22-rdf-syntax-ns#rest",
-                  next, RDF_TYPE_IRI, NULL, NULL);
-               context->default_graph_triple_callback(
-                  triple, context->callback_data);
+                  next_iri, next, RDF_TYPE_IRI, NULL, NULL);
 
-               /* Free the bnode, setting 'next' appropriately */
-               free(bnode);
                bnode = next;
             }
 
@@ -210,34 +214,21 @@ void rdfa_complete_list_triples(rdfacontext* context)
              * predicate
              *   full IRI of the local list mapping associated with this list
              * object
-             *   first item of the 'bnode' array */
-            subject = strdup(key);
-            if(subject)
-              tmp = strstr(subject, " ");
-
-            if(tmp) {
-              tmp[0] = '\0';
-              triple = (rdftriple*)list->items[0]->data;
-              triple->subject =
-                rdfa_replace_string(triple->subject, subject);
-              triple->predicate =
-                rdfa_replace_string(triple->predicate, predicate);
-              context->default_graph_triple_callback(
-                triple, context->callback_data);
-            }
-            if(subject)
-              free(subject);
-            if(bnode)
-              free(bnode);
+             *   first item of the 'bnode' array
+             *
+             * NOTE: rdfa_create_list_mapping() has already set up the
+             * first list item as this triple. */
+            rdfa_emit_default_graph_triple(context, head);
          }
 
          /* Free the first list item and empty the list */
-         free(list->items[0]);
+         rdfa_free(list->items[0]);
          list->items[0] = NULL;
          list->num_items = 0;
 
          /* clear the entry from the mapping */
-         *kptr = rdfa_replace_string((char*)*kptr, RDFA_MAPPING_DELETED_KEY);
+         rdfa_delete_mapping(context->local_list_mappings, key,
+            (free_mapping_value_fp)rdfa_free_list);
       }
    }
 }
@@ -30,6 +30,415 @@
 #include "rdfa_utils.h"
 #include "rdfa.h"
 
+#ifndef LIBRDFA_IN_RAPTOR
+const char* rdfa_get_uri_mapping_view(rdfacontext* context, rdfaview prefix)
+{
+   const char* rval =
+      (const char*)rdfa_get_mapping_view(context->uri_mappings, prefix);
+
+   if(rval == NULL && context->initial_uri_mappings != NULL)
+   {
+      rval = (const char*)rdfa_get_mapping_view(
+         context->initial_uri_mappings, prefix);
+   }
+
+   return rval;
+}
+
+int rdfa_has_uri_mapping(rdfacontext* context, const char* prefix)
+{
+   return rdfa_has_mapping(context->uri_mappings, prefix) ||
+      (context->initial_uri_mappings != NULL &&
+         rdfa_has_mapping(context->initial_uri_mappings, prefix));
+}
+
+int rdfa_next_uri_mapping(
+   rdfacontext* context, size_t* position, char** key, void** value)
+{
+   rdfamapping* initial = context->initial_uri_mappings;
+   size_t num_initial = (initial != NULL) ? initial->num_entries : 0;
+   size_t document_position;
+   int rval;
+
+   /* the mappings of the initial context are never deleted from */
+   if(*position < num_initial)
+   {
+      const void* document_value;
+
+      *key = initial->entries[*position].key;
+      *value = initial->entries[*position].value;
+      document_value = rdfa_get_mapping(context->uri_mappings, *key);
+      if(document_value != NULL)
+      {
+         *value = (void*)document_value;
+      }
+      (*position)++;
+
+      return 1;
+   }
+
+   /* skip the prefixes of the initial context that the document gave
+    * other IRIs, they were already returned */
+   document_position = *position - num_initial;
+   do
+   {
+      rval = rdfa_next_mapping(
+         context->uri_mappings, &document_position, key, value);
+   }
+   while(rval && num_initial > 0 && rdfa_has_mapping(initial, *key));
+   *position = document_position + num_initial;
+
+   return rval;
+}
+
+/**
+ * Updates a prefix in the URI mappings. Element contexts share the URI
+ * mappings of the root context, so the value that the prefix had before
+ * the current element changed it is saved in the context's undo log.
+ * Only the first change to a prefix on an element is saved.
+ *
+ * @param context the current element context.
+ * @param prefix the prefix to update.
+ * @param value the IRI that the prefix should map to.
+ *
+ * @return the entry of the prefix in the URI mappings.
+ */
+static const rdfamappingentry* rdfa_update_scoped_uri_mapping(
+   rdfacontext* context, rdfaview prefix, rdfaview value)
+{
+   const rdfamappingentry* rval;
+
+   if(context->shares_mappings)
+   {
+      if(context->uri_mappings_undo == NULL)
+      {
+         context->uri_mappings_undo =
+            rdfa_create_mapping(MAX_URI_MAPPINGS_UNDO);
+      }
+
+      /* prefixes of the initial context are restored by deleting them
+       * from the mappings of the document again */
+      if(!rdfa_has_mapping_view(context->uri_mappings_undo, prefix))
+      {
+         const char* old_value = (const char*)rdfa_get_mapping_view(
+            context->uri_mappings, prefix);
+
+         rdfa_update_mapping_view(context->uri_mappings_undo, prefix,
+            old_value, (update_mapping_value_fp)rdfa_replace_string);
+      }
+   }
+
+   if(context->shared_curie_cache != NULL)
+   {
+      rdfa_update_mapping_fingerprint(context, RDFA_FINGERPRINT_URI_MAPPING,
+         prefix.data, prefix.length,
+         rdfa_get_uri_mapping_view(context, prefix), 0);
+   }
+
+   rval = rdfa_update_mapping_view(context->uri_mappings, prefix, &value,
+      (update_mapping_value_fp)rdfa_replace_view);
+   rdfa_update_mapping_version(context);
+   rdfa_update_mapping_fingerprint(context, RDFA_FINGERPRINT_URI_MAPPING,
+      rval->key, prefix.length, (const char*)rval->value, 1);
+
+   /* the element now has a prefix scope of its own, the xmlns
+    * declarations of the scope are serialized again when needed */
+   context->prefix_scope = context;
+   rdfa_free(context->xmlns_preamble);
+   context->xmlns_preamble = NULL;
+
+   return rval;
+}
+
+/**
+ * Appends the xmlns declaration of a single URI mapping to a string, in
+ * the form that is used in XML literals.
+ *
+ * @param dest the string to append to, which must be large enough.
+ * @param prefix the prefix of the mapping.
+ * @param iri the IRI that the prefix maps to.
+ *
+ * @return the end of the appended declaration.
+ */
+static char* rdfa_append_xmlns_declaration(
+   char* dest, const char* prefix, const char* iri)
+{
+   size_t length;
+
+   memcpy(dest, " xmlns", 6);
+   dest += 6;
+   if(strcmp(prefix, XMLNS_DEFAULT_MAPPING) != 0)
+   {
+      length = strlen(prefix);
+      *dest++ = ':';
+      memcpy(dest, prefix, length);
+      dest += length;
+   }
+   *dest++ = '=';
+   *dest++ = '"';
+   length = strlen(iri);
+   memcpy(dest, iri, length);
+   dest += length;
+   *dest++ = '"';
+
+   return dest;
+}
+
+/**
+ * Checks if any of the strings in the attribute array of an element is
+ * the same as a prefix in the URI mappings. The xmlns declarations of
+ * such prefixes are left out of the element's start tag in XML literals.
+ *
+ * @param context the current element context.
+ * @param attributes the attributes of the element.
+ *
+ * @return 1 if a string matches a prefix, 0 otherwise.
+ */
+static int rdfa_attributes_match_prefixes(
+   rdfacontext* context, const char** attributes)
+{
+   size_t max_length = context->prefix_scope->xmlns_max_prefix_length;
+   const char** attrs = attributes;
+
+   /* check the same strings that the element's xmlns declarations are
+    * checked against in start_element(), no prefix is longer than the
+    * longest one so longer strings don't need to be looked up */
+   while(*attrs != NULL)
+   {
+      const char* attr = *attrs++;
+      size_t length = 0;
+
+      while(length <= max_length && attr[length] != '\0')
+      {
+         length++;
+      }
+
+      if(length <= max_length && rdfa_has_uri_mapping(context, attr))
+      {
+         return 1;
+      }
+   }
+
+   return 0;
+}
+
+const char* rdfa_get_xmlns_preamble(
+   rdfacontext* context, const char** attributes, size_t* length)
+{
+   rdfacontext* scope = context->prefix_scope;
+
+   if(scope->xmlns_preamble == NULL)
+   {
+      char* key = NULL;
+      void* value = NULL;
+      size_t mindex = 0;
+      size_t preamble_length = 0;
+      char* end;
+
+      /* measure the declarations, then write them in a single buffer */
+      scope->xmlns_max_prefix_length = 0;
+      while(rdfa_next_uri_mapping(context, &mindex, &key, &value))
+      {
+         size_t prefix_length = strlen(key);
+
+         if(prefix_length > scope->xmlns_max_prefix_length)
+         {
+            scope->xmlns_max_prefix_length = prefix_length;
+         }
+         preamble_length +=
+            strlen(" xmlns:=\"\"") + prefix_length + strlen((char*)value);
+      }
+
+      scope->xmlns_preamble = (char*)rdfa_malloc(preamble_length + 1);
+      end = scope->xmlns_preamble;
+      mindex = 0;
+      while(rdfa_next_uri_mapping(context, &mindex, &key, &value))
+      {
+         end = rdfa_append_xmlns_declaration(end, key, (const char*)value);
+      }
+      *end = '\0';
+      scope->xmlns_preamble_length = end - scope->xmlns_preamble;
+   }
+
+   if(attributes != NULL &&
+      rdfa_attributes_match_prefixes(context, attributes))
+   {
+      return NULL;
+   }
+
+   *length = scope->xmlns_preamble_length;
+
+   return scope->xmlns_preamble;
+}
+#endif
+
+void rdfa_update_default_vocabulary(rdfacontext* context, const char* vocab)
+{
+   rdfa_update_mapping_fingerprint(context, RDFA_FINGERPRINT_VOCABULARY,
+      "", 0, context->default_vocabulary, 0);
+
+   if(context->shares_mappings && !context->default_vocabulary_changed)
+   {
+      /* the vocabulary is borrowed from the parent context, keep it
+       * around so it can be restored once the element ends */
+      context->default_vocabulary_undo = context->default_vocabulary;
+      context->default_vocabulary_changed = 1;
+   }
+   else
+   {
+      rdfa_free(context->default_vocabulary);
+   }
+
+   context->default_vocabulary = NULL;
+   if(vocab != NULL)
+   {
+      context->default_vocabulary = rdfa_strdup(vocab);
+   }
+   rdfa_update_mapping_version(context);
+   rdfa_update_mapping_fingerprint(context, RDFA_FINGERPRINT_VOCABULARY,
+      "", 0, context->default_vocabulary, 1);
+}
+
+/**
+ * Hashes a mapping for the mapping fingerprint. The two hashes are
+ * FNV-1a hashes with different offsets, with their bits spread out so
+ * that the sums of the hashes of similar mappings don't collide.
+ *
+ * @param type the kind of mapping.
+ * @param key the key of the mapping.
+ * @param key_length the length of the key.
+ * @param value the value of the mapping.
+ * @param offset the offset of the hash.
+ *
+ * @return the hash of the mapping.
+ */
+static unsigned long rdfa_hash_fingerprint_mapping(int type,
+   const char* key, size_t key_length, const char* value,
+   unsigned long offset)
+{
+   unsigned long hash = (offset ^ (unsigned long)type) * 16777619UL;
+   size_t i;
+
+   for(i = 0; i < key_length; i++)
+   {
+      hash = (hash ^ (unsigned char)key[i]) * 16777619UL;
+   }
+   /* the key ends with a NUL, which keeps keys and values apart */
+   hash *= 16777619UL;
+   for(i = 0; value[i] != '\0'; i++)
+   {
+      hash = (hash ^ (unsigned char)value[i]) * 16777619UL;
+   }
+
+   hash ^= hash >> 15;
+   hash *= 0x2c1b3c6dUL;
+   hash ^= hash >> 12;
+   hash *= 0x297a2d39UL;
+   hash ^= hash >> 15;
+
+   return hash;
+}
+
+void rdfa_update_mapping_fingerprint(rdfacontext* context, int type,
+   const char* key, size_t key_length, const char* value, int add)
+{
+   unsigned long hash1;
+   unsigned long hash2;
+
+   if(context->shared_curie_cache == NULL || value == NULL)
+   {
+      return;
+   }
+
+   hash1 = rdfa_hash_fingerprint_mapping(
+      type, key, key_length, value, 2166136261UL);
+   hash2 = rdfa_hash_fingerprint_mapping(
+      type, key, key_length, value, 3735928559UL);
+   if(add)
+   {
+      context->mapping_fingerprint.hash1 += hash1;
+      context->mapping_fingerprint.hash2 += hash2;
+   }
+   else
+   {
+      context->mapping_fingerprint.hash1 -= hash1;
+      context->mapping_fingerprint.hash2 -= hash2;
+   }
+}
+
+void rdfa_init_mapping_fingerprint(rdfacontext* context)
+{
+   char* key = NULL;
+   void* value = NULL;
+   size_t mindex = 0;
+   char initial_terms[2] = { '0', '\0' };
+
+   context->mapping_fingerprint.hash1 = 0;
+   context->mapping_fingerprint.hash2 = 0;
+
+#ifndef LIBRDFA_IN_RAPTOR
+   while(rdfa_next_uri_mapping(context, &mindex, &key, &value))
+   {
+      rdfa_update_mapping_fingerprint(context, RDFA_FINGERPRINT_URI_MAPPING,
+         key, strlen(key), (const char*)value, 1);
+   }
+   mindex = 0;
+#endif
+   while(rdfa_next_mapping(context->term_mappings, &mindex, &key, &value))
+   {
+      rdfa_update_mapping_fingerprint(context, RDFA_FINGERPRINT_TERM_MAPPING,
+         key, strlen(key), (const char*)value, 1);
+   }
+   /* the initial terms are fixed, so the initial contexts that they come
+    * from tell them apart */
+   initial_terms[0] = (char)('0' + context->initial_terms);
+   rdfa_update_mapping_fingerprint(context, RDFA_FINGERPRINT_TERM_MAPPING,
+      "", 0, initial_terms, 1);
+   rdfa_update_mapping_fingerprint(context, RDFA_FINGERPRINT_VOCABULARY,
+      "", 0, context->default_vocabulary, 1);
+}
+
+void rdfa_restore_mappings(rdfacontext* context)
+{
+#ifndef LIBRDFA_IN_RAPTOR
+   if(context->uri_mappings_undo != NULL)
+   {
+      char* key = NULL;
+      void* value = NULL;
+      size_t mindex = 0;
+
+      while(rdfa_next_mapping(
+         context->uri_mappings_undo, &mindex, &key, &value))
+      {
+         if(value != NULL)
+         {
+            /* put the saved value back into the shared mapping */
+            rdfa_update_mapping(context->uri_mappings, key, value,
+               (update_mapping_value_fp)rdfa_replace_string);
+         }
+         else
+         {
+            /* the prefix didn't exist before the element declared it */
+            rdfa_delete_mapping(context->uri_mappings, key,
+               (free_mapping_value_fp)rdfa_free);
+         }
+      }
+
+      rdfa_free_mapping(
+         context->uri_mappings_undo, (free_mapping_value_fp)rdfa_free);
+      context->uri_mappings_undo = NULL;
+   }
+#endif
+
+   if(context->default_vocabulary_changed)
+   {
+      rdfa_free(context->default_vocabulary);
+      context->default_vocabulary = context->default_vocabulary_undo;
+      context->default_vocabulary_undo = NULL;
+      context->default_vocabulary_changed = 0;
+   }
+}
+
 /**
  * Attempts to update the uri mappings in the given context using the
  * given attribute/value pair.
@@ -40,9 +449,28 @@
 void rdfa_update_uri_mappings(
    rdfacontext* context, const char* attr, const char* value)
 {
+   rdfaview prefix;
+   rdfaview iri;
+
+   prefix.data = attr;
+   prefix.length = (attr != NULL) ? strlen(attr) : 0;
+   iri.data = value;
+   iri.length = (value != NULL) ? strlen(value) : 0;
+
+   rdfa_update_uri_mappings_view(context, prefix, iri);
+}
+
+void rdfa_update_uri_mappings_view(
+   rdfacontext* context, rdfaview prefix, rdfaview iri)
+{
+   unsigned char first = (prefix.length > 0) ? prefix.data[0] : '\0';
 #ifdef LIBRDFA_IN_RAPTOR
   raptor_namespace_stack* nstack;
+  char* value;
   nstack = &context->sax2->namespaces;
+  value = (iri.data != NULL) ? rdfa_strndup(iri.data, iri.length) : NULL;
+#else
+   rdfaview default_prefix;
 #endif
 
    /* * the [current element] is parsed for [URI mappings] and these
@@ -58,7 +486,7 @@ void rdfa_update_uri_mappings(
     * follow best practice for using namespaces, which includes not
     * using relative paths. */
 
-   if(attr == NULL)
+   if(prefix.data == NULL)
    {
 #ifdef LIBRDFA_IN_RAPTOR
       raptor_namespaces_start_namespace_full(nstack,
@@ -66,12 +494,12 @@ void rdfa_update_uri_mappings(
                                              (const unsigned char*)value,
                                              0);
 #else
-      rdfa_update_mapping(
-         context->uri_mappings, XMLNS_DEFAULT_MAPPING, value,
-         (update_mapping_value_fp)rdfa_replace_string);
+      default_prefix.data = XMLNS_DEFAULT_MAPPING;
+      default_prefix.length = strlen(XMLNS_DEFAULT_MAPPING);
+      rdfa_update_scoped_uri_mapping(context, default_prefix, iri);
 #endif
    }
-   else if(strcmp(attr, "_") == 0)
+   else if(prefix.length == 1 && first == '_')
    {
 #define FORMAT_1 "The underscore character must not be declared as a prefix " \
          "because it conflicts with the prefix for blank node identifiers. " \
@@ -85,21 +513,26 @@ void rdfa_update_uri_mappings(
          FORMAT_1);
 #endif
    }
-   else if(attr[0] == ':' || attr[0] == '_' ||
-      (attr[0] >= 'A' && attr[0] <= 'Z') ||
-      (attr[0] >= 'a' && attr[0] <= 'z') ||
-      ((unsigned char)attr[0] >= 0xc0 && (unsigned char)attr[0] <= 0xd6) ||
-      ((unsigned char)attr[0] >= 0xd8 && (unsigned char)attr[0] <= 0xf6) || (unsigned char)attr[0] >= 0xf8)
+   else if(first == ':' || first == '_' ||
+      (first >= 'A' && first <= 'Z') ||
+      (first >= 'a' && first <= 'z') ||
+      (first >= 0xc0 && first <= 0xd6) ||
+      (first >= 0xd8 && first <= 0xf6) || first >= 0xf8)
    {
 #ifdef LIBRDFA_IN_RAPTOR
+     char* attr = rdfa_strndup(prefix.data, prefix.length);
      raptor_namespaces_start_namespace_full(nstack,
                                             (const unsigned char*)attr,
                                             (const unsigned char*)value,
                                             0);
+     rdfa_free(attr);
 #else
-      rdfa_generate_namespace_triple(context, attr, value);
-      rdfa_update_mapping(context->uri_mappings, attr, value,
-         (update_mapping_value_fp)rdfa_replace_string);
+      /* the namespace triple is made from the strings that the mapping
+       * keeps, so the views don't have to be copied here */
+      const rdfamappingentry* entry =
+         rdfa_update_scoped_uri_mapping(context, prefix, iri);
+      rdfa_generate_namespace_triple(
+         context, entry->key, (const char*)entry->value);
 #endif
    }
    else
@@ -112,14 +545,14 @@ void rdfa_update_uri_mappings(
        */
 
       /* Generate the processor warning if this is an invalid prefix */
-#define FORMAT_2 "The declaration of the '%s' prefix is invalid " \
+#define FORMAT_2 "The declaration of the '%.*s' prefix is invalid " \
          "because it starts with an invalid character. Please see " \
          "http://www.w3.org/TR/REC-xml/#NT-NameStartChar for a " \
          "full explanation of valid first characters for declaring " \
          "prefixes."
 #ifdef LIBRDFA_IN_RAPTOR
       raptor_parser_warning((raptor_parser*)context->callback_data, 
-                            FORMAT_2, attr);
+                            FORMAT_2, (int)prefix.length, prefix.data);
 #else
       char msg[1024];
       snprintf(msg, 1024, FORMAT_1);
@@ -127,6 +560,10 @@ void rdfa_update_uri_mappings(
 #endif
    }
 
+#ifdef LIBRDFA_IN_RAPTOR
+   rdfa_free(value);
+#endif
+
 #ifdef LIBRDFA_IN_RAPTOR
 #else
    /* print the current mapping */
@@ -50,11 +50,142 @@
 #include <libxml/SAX2.h>
 #include "rdfa_utils.h"
 #include "rdfa.h"
-#include "strtok_r.h"
 
 #define READ_BUFFER_SIZE 4096
+#define ARENA_BLOCK_SIZE 4096
+#define LITERAL_BUFFER_SIZE 4096
+#define CURIE_CACHE_SIZE 1024
 #define RDFA_DOCTYPE_STRING_LENGTH 103
 
+/**
+ * The attribute type is the kind of attribute that start_element()
+ * processes. Attributes that are not used by RDFa have the type
+ * RDFA_ATTR_OTHER.
+ */
+typedef enum
+{
+   RDFA_ATTR_OTHER = 0,
+   RDFA_ATTR_ABOUT,
+   RDFA_ATTR_SRC,
+   RDFA_ATTR_TYPEOF,
+   RDFA_ATTR_REL,
+   RDFA_ATTR_REV,
+   RDFA_ATTR_PROPERTY,
+   RDFA_ATTR_RESOURCE,
+   RDFA_ATTR_HREF,
+   RDFA_ATTR_CONTENT,
+   RDFA_ATTR_DATATYPE,
+   RDFA_ATTR_LANG,
+   RDFA_ATTR_VERSION,
+   RDFA_ATTR_VOCAB,
+   RDFA_ATTR_PREFIX,
+   RDFA_ATTR_INLIST
+} rdfaattr_t;
+
+/* the bit of an attribute type in the set of types on an element */
+#define RDFA_ATTR_BIT(type) (1u << (type))
+
+/* a perfect hash of the RDFa attribute names, no two of them have the
+ * same length, first and last character in this combination */
+#define RDFA_ATTR_HASH_SIZE 31
+#define RDFA_ATTR_HASH(name, length) \
+   ((2 * (length) + (unsigned char)(name)[0] + \
+      (unsigned char)(name)[(length) - 1]) % RDFA_ATTR_HASH_SIZE)
+
+/**
+ * The RDFa attribute names, in the slots given by RDFA_ATTR_HASH().
+ */
+static const struct
+{
+   const char* name;
+   rdfaattr_t type;
+} g_rdfa_attributes[RDFA_ATTR_HASH_SIZE] =
+{
+   { "datatype", RDFA_ATTR_DATATYPE },
+   { "property", RDFA_ATTR_PROPERTY },
+   { "lang", RDFA_ATTR_LANG },
+   { "src", RDFA_ATTR_SRC },
+   { NULL, RDFA_ATTR_OTHER },
+   { NULL, RDFA_ATTR_OTHER },
+   { "about", RDFA_ATTR_ABOUT },
+   { NULL, RDFA_ATTR_OTHER },
+   { NULL, RDFA_ATTR_OTHER },
+   { "vocab", RDFA_ATTR_VOCAB },
+   { NULL, RDFA_ATTR_OTHER },
+   { "rel", RDFA_ATTR_REL },
+   { "content", RDFA_ATTR_CONTENT },
+   { "typeof", RDFA_ATTR_TYPEOF },
+   { "resource", RDFA_ATTR_RESOURCE },
+   { NULL, RDFA_ATTR_OTHER },
+   { "inlist", RDFA_ATTR_INLIST },
+   { NULL, RDFA_ATTR_OTHER },
+   { NULL, RDFA_ATTR_OTHER },
+   { NULL, RDFA_ATTR_OTHER },
+   { NULL, RDFA_ATTR_OTHER },
+   { "rev", RDFA_ATTR_REV },
+   { NULL, RDFA_ATTR_OTHER },
+   { NULL, RDFA_ATTR_OTHER },
+   { NULL, RDFA_ATTR_OTHER },
+   { "version", RDFA_ATTR_VERSION },
+   { NULL, RDFA_ATTR_OTHER },
+   { "prefix", RDFA_ATTR_PREFIX },
+   { "href", RDFA_ATTR_HREF },
+   { NULL, RDFA_ATTR_OTHER },
+   { NULL, RDFA_ATTR_OTHER }
+};
+
+/**
+ * Gets the type of an attribute from its local name with a single
+ * lookup in the perfect hash of the RDFa attribute names.
+ *
+ * @param attr the local name of the attribute.
+ *
+ * @return the type of the attribute.
+ */
+static rdfaattr_t rdfa_attribute_type(const char* attr)
+{
+   size_t length = strlen(attr);
+   const char* name;
+
+   if(length == 0)
+   {
+      return RDFA_ATTR_OTHER;
+   }
+
+   name = g_rdfa_attributes[RDFA_ATTR_HASH(attr, length)].name;
+   if(name == NULL || strcmp(attr, name) != 0)
+   {
+      return RDFA_ATTR_OTHER;
+   }
+
+   return g_rdfa_attributes[RDFA_ATTR_HASH(attr, length)].type;
+}
+
+/**
+ * The strings that the beginning of a document is sniffed for, indexed by
+ * RDFA_SNIFF_*. They are all searched for in one pass over the document.
+ */
+static const char* const g_rdfa_sniff_strings[] =
+{
+   "-//W3C//DTD XHTML+RDFa 1.0//EN",
+   "-//W3C//DTD XHTML+RDFa 1.1//EN",
+   "<html",
+   "</head>",
+   "</HEAD>",
+   "<base ",
+   "<BASE "
+};
+
+#define RDFA_SNIFF_XHTML_RDFA_1_0 0
+#define RDFA_SNIFF_XHTML_RDFA_1_1 1
+#define RDFA_SNIFF_HTML 2
+#define RDFA_SNIFF_HEAD_END 3
+#define RDFA_SNIFF_HEAD_END_UPPER 4
+#define RDFA_SNIFF_BASE 5
+#define RDFA_SNIFF_BASE_UPPER 6
+#define RDFA_NUM_SNIFF_STRINGS \
+   (sizeof(g_rdfa_sniff_strings) / sizeof(g_rdfa_sniff_strings[0]))
+
 /**
  * Read the head of the XHTML document and determines the base IRI for
  * the document.
@@ -70,7 +201,8 @@ static size_t rdfa_init_base(
    rdfacontext* context, char** working_buffer, size_t* working_buffer_size,
    char* temp_buffer, size_t bytes_read)
 {
-   char* head_end = NULL;
+   const char* found[RDFA_NUM_SNIFF_STRINGS];
+   const char* head_end = NULL;
    size_t offset = context->wb_position;
    size_t needed_size = 0;
 
@@ -90,7 +222,7 @@ static size_t rdfa_init_base(
 
       *working_buffer_size += temp_buffer_size;
       /* +1 for NUL at end, to allow strstr() etc. to work */
-      *working_buffer = (char*)realloc(*working_buffer, *working_buffer_size + 1);
+      *working_buffer = (char*)rdfa_realloc(*working_buffer, *working_buffer_size + 1);
    }
 
    /* append to the working buffer */
@@ -99,17 +231,19 @@ static size_t rdfa_init_base(
    *(*working_buffer + offset + bytes_read) = '\0';
 
    /* Sniff the beginning of the document for any document information */
-   if(strstr(*working_buffer, "-//W3C//DTD XHTML+RDFa 1.0//EN") != NULL)
+   rdfa_find_strings(*working_buffer, offset + bytes_read,
+      g_rdfa_sniff_strings, RDFA_NUM_SNIFF_STRINGS, found);
+   if(found[RDFA_SNIFF_XHTML_RDFA_1_0] != NULL)
    {
       context->host_language = HOST_LANGUAGE_XHTML1;
       context->rdfa_version = RDFA_VERSION_1_0;
    }
-   else if(strstr(*working_buffer, "-//W3C//DTD XHTML+RDFa 1.1//EN") != NULL)
+   else if(found[RDFA_SNIFF_XHTML_RDFA_1_1] != NULL)
    {
       context->host_language = HOST_LANGUAGE_XHTML1;
       context->rdfa_version = RDFA_VERSION_1_1;
    }
-   else if(strstr(*working_buffer, "<html") != NULL)
+   else if(found[RDFA_SNIFF_HTML] != NULL)
    {
       context->host_language = HOST_LANGUAGE_HTML;
       context->rdfa_version = RDFA_VERSION_1_1;
@@ -129,9 +263,9 @@ static size_t rdfa_init_base(
 #endif
 
    /* search for the end of </head> in */
-   head_end = strstr(*working_buffer, "</head>");
+   head_end = found[RDFA_SNIFF_HEAD_END];
    if(head_end == NULL)
-      head_end = strstr(*working_buffer, "</HEAD>");
+      head_end = found[RDFA_SNIFF_HEAD_END_UPPER];
 
    context->wb_position += bytes_read;
 
@@ -141,25 +275,25 @@ static size_t rdfa_init_base(
    /* if </head> was found, search for <base and extract the base URI */
    if(head_end != NULL)
    {
-      char* base_start = strstr(*working_buffer, "<base ");
-      char* href_start = NULL;
+      const char* base_start = found[RDFA_SNIFF_BASE];
+      const char* href_start = NULL;
       if(base_start == NULL)
-         base_start = strstr(*working_buffer, "<BASE ");
+         base_start = found[RDFA_SNIFF_BASE_UPPER];
       if(base_start != NULL)
         href_start = strstr(base_start, "href=");
       
       if(href_start != NULL)
       {
          char sep = href_start[5];
-         char* uri_start = href_start + 6;
-         char* uri_end = strchr(uri_start, sep);
+         const char* uri_start = href_start + 6;
+         const char* uri_end = strchr(uri_start, sep);
 
          if(uri_end != NULL)
          {
             if(*uri_start != sep)
             {
                size_t uri_size = uri_end - uri_start;
-               char* temp_uri = (char*)malloc(sizeof(char) * uri_size + 1);
+               char* temp_uri = (char*)rdfa_malloc(sizeof(char) * uri_size + 1);
 	       char* cleaned_base;
                strncpy(temp_uri, uri_start, uri_size);
                temp_uri[uri_size] = '\0';
@@ -172,12 +306,12 @@ static size_t rdfa_init_base(
                context->current_object_resource =
                   rdfa_replace_string(
                      context->current_object_resource, cleaned_base);
+               context->current_object_resource_bnode = RDFA_NO_BNODE;
 
 	       /* clean up the base context */
-               context->base =
-                  rdfa_replace_string(context->base, cleaned_base);
-               free(cleaned_base);
-               free(temp_uri);
+               rdfa_update_base(context, cleaned_base);
+               rdfa_free(cleaned_base);
+               rdfa_free(temp_uri);
             }
          }
       }
@@ -212,26 +346,25 @@ static void start_element(void *parser_context, const char* name,
    rdfacontext* root_context = (rdfacontext*)parser_context;
    rdfalist* context_stack = (rdfalist*)root_context->context_stack;
    rdfacontext* context = rdfa_create_new_element_context(context_stack);
+   rdfabuffer* xml_buffer = root_context->xml_literal_buffer;
    char* xml_lang = NULL;
-   const char* about_curie = NULL;
    char* about = NULL;
-   const char* src_curie = NULL;
    char* src = NULL;
-   const char* type_of_curie = NULL;
    rdfalist* type_of = NULL;
-   const char* rel_curie = NULL;
    rdfalist* rel = NULL;
-   const char* rev_curie = NULL;
    rdfalist* rev = NULL;
-   const char* property_curie = NULL;
    rdfalist* property = NULL;
-   const char* resource_curie = NULL;
    char* resource = NULL;
-   const char* href_curie = NULL;
    char* href = NULL;
    char* content = NULL;
-   const char* datatype_curie = NULL;
    char* datatype = NULL;
+   int has_resource_attribute;
+   unsigned char* attribute_types = NULL;
+   unsigned int attribute_bits = 0;
+#ifndef LIBRDFA_IN_RAPTOR
+   const char* xmlns_preamble;
+   size_t xmlns_preamble_length;
+#endif
 
 #ifdef LIBRDFA_IN_RAPTOR
    if(1) {
@@ -243,6 +376,10 @@ static void start_element(void *parser_context, const char* name,
 
    rdfa_push_item(context_stack, context, RDFALIST_FLAG_CONTEXT);
 
+   /* everything allocated from the arena from here on is released when
+    * the element ends */
+   rdfa_arena_mark(root_context->arena, &context->arena_mark);
+
 #if defined(DEBUG) && DEBUG > 0
    if(1) {
       int i;
@@ -287,22 +424,60 @@ static void start_element(void *parser_context, const char* name,
    }
 #endif
 
-   /* start the XML Literal text */
-   if(context->xml_literal == NULL)
+   /* find the type of every attribute in a single pass, the processing
+    * steps below only look at the attributes of the types they handle */
+   if(attributes != NULL && nb_attributes > 0)
+   {
+      int ai;
+
+      attribute_types =
+         (unsigned char*)rdfa_arena_alloc(root_context->arena, nb_attributes);
+      for(ai = 0; ai < nb_attributes; ai++)
+      {
+         rdfaattr_t type = rdfa_attribute_type(attributes[ai * 5]);
+
+         attribute_types[ai] = (unsigned char)type;
+         attribute_bits |= RDFA_ATTR_BIT(type);
+      }
+   }
+
+   /* the literals of an element are only used if it or one of its
+    * ancestors has @property, so only build them in that case */
+   if(attribute_bits & RDFA_ATTR_BIT(RDFA_ATTR_PROPERTY))
    {
-      context->xml_literal = rdfa_replace_string(context->xml_literal, "<");
-      context->xml_literal_size = 1;
+      context->capture_literals = 1;
    }
-   else
+
+   /* start the XML Literal text, the literals of the element start at
+    * the current end of the literal buffers */
+   if(context->capture_literals)
    {
-      context->xml_literal = rdfa_n_append_string(
-         context->xml_literal, &context->xml_literal_size, "<", 1);
+      context->plain_literal_start = root_context->plain_literal_buffer->length;
+      context->xml_literal_start = xml_buffer->length;
+      rdfa_buffer_append(xml_buffer, "<", 1);
+      rdfa_buffer_append(xml_buffer, name, strlen(name));
    }
-   context->xml_literal = rdfa_n_append_string(
-      context->xml_literal, &context->xml_literal_size,
-      name, strlen(name));
 
-   if(!context->xml_literal_namespaces_defined)
+   if(!context->xml_literal_namespaces_defined && !context->capture_literals)
+   {
+      /* nothing is written, but the XML Literal state has to be kept
+       * for the descendants that do build literals */
+      context->xml_literal_xml_lang_defined = 0;
+      context->xml_literal_namespaces_defined = 1;
+   }
+#ifndef LIBRDFA_IN_RAPTOR
+   else if(!context->xml_literal_namespaces_defined &&
+      (xmlns_preamble = rdfa_get_xmlns_preamble(
+         context, attributes, &xmlns_preamble_length)) != NULL)
+   {
+      /* the declarations of all URI mappings are the same for every
+       * element in the prefix scope, so they are copied in one go */
+      rdfa_buffer_append(xml_buffer, xmlns_preamble, xmlns_preamble_length);
+      context->xml_literal_xml_lang_defined = 0;
+      context->xml_literal_namespaces_defined = 1;
+   }
+#endif
+   else if(!context->xml_literal_namespaces_defined)
    {
       /* append namespaces to XML Literal */
 #ifdef LIBRDFA_IN_RAPTOR
@@ -311,7 +486,7 @@ static void start_element(void *parser_context, const char* name,
       raptor_namespace** ns_list = NULL;
       size_t ns_size;
 #else
-      void** umap = context->uri_mappings;
+      size_t umap_index = 0;
 #endif
       const char* umap_key = NULL;
       void* umap_value = NULL;
@@ -327,7 +502,8 @@ static void start_element(void *parser_context, const char* name,
 
       while(ns_size > 0)
 #else
-      while(*umap != NULL)
+      while(rdfa_next_uri_mapping(context, &umap_index,
+         (char**)&umap_key, &umap_value))
 #endif
       {
          unsigned char insert_xmlns_definition = 1;
@@ -341,9 +517,6 @@ static void start_element(void *parser_context, const char* name,
          if(!umap_key)
            umap_key=(const char*)XMLNS_DEFAULT_MAPPING;
          umap_value = (char*)raptor_uri_as_string(raptor_namespace_get_uri(ns));
-#else
-         rdfa_next_mapping(umap++, &umap_key, &umap_value);
-         umap++;
 #endif
 
          /* check to make sure that the namespace isn't already
@@ -369,29 +542,21 @@ static void start_element(void *parser_context, const char* name,
          if(insert_xmlns_definition)
          {
             /* append the namespace attribute to the XML Literal */
-            context->xml_literal = rdfa_n_append_string(
-               context->xml_literal, &context->xml_literal_size,
-               " xmlns", strlen(" xmlns"));
+            rdfa_buffer_append(xml_buffer, " xmlns", strlen(" xmlns"));
 
             /* check to see if we're dumping the standard XHTML namespace or
              * a user-defined XML namespace */
             if(strcmp(umap_key, XMLNS_DEFAULT_MAPPING) != 0)
             {
-               context->xml_literal = rdfa_n_append_string(
-                  context->xml_literal, &context->xml_literal_size, ":", 1);
-               context->xml_literal = rdfa_n_append_string(
-                  context->xml_literal, &context->xml_literal_size,
-                  umap_key, strlen(umap_key));
+               rdfa_buffer_append(xml_buffer, ":", 1);
+               rdfa_buffer_append(xml_buffer, umap_key, strlen(umap_key));
             }
 
             /* append the namespace value */
-            context->xml_literal = rdfa_n_append_string(
-               context->xml_literal, &context->xml_literal_size, "=\"", 2);
-            context->xml_literal = rdfa_n_append_string(
-               context->xml_literal, &context->xml_literal_size,
+            rdfa_buffer_append(xml_buffer, "=\"", 2);
+            rdfa_buffer_append(xml_buffer,
                (const char*)umap_value, strlen((char*)umap_value));
-            context->xml_literal = rdfa_n_append_string(
-               context->xml_literal, &context->xml_literal_size, "\"", 1);
+            rdfa_buffer_append(xml_buffer, "\"", 1);
          }
 
       } /* end while umap not NULL */
@@ -431,7 +596,7 @@ static void start_element(void *parser_context, const char* name,
             /* convert the namespace string to lowercase */
             unsigned int i;
             size_t ns_length = strlen(ns);
-            lcns = (char*)malloc(ns_length + 1);
+            lcns = (char*)rdfa_malloc(ns_length + 1);
             for(i = 0; i <= ns_length; i++)
             {
                lcns[i] = tolower(ns[i]);
@@ -443,32 +608,29 @@ static void start_element(void *parser_context, const char* name,
 
          if(lcns != NULL)
          {
-            free(lcns);
+            rdfa_free(lcns);
          }
       }
    }
 #endif
 
    /* detect the RDFa version of the document, if specified */
-   if(attributes != NULL)
+   if(attribute_bits & RDFA_ATTR_BIT(RDFA_ATTR_VERSION))
    {
       int ci;
 
       /* search for a version attribute */
       for(ci = 0; ci < nb_attributes * 5; ci += 5)
       {
-         const char* attr;
          char* value;
          size_t value_length = 0;
 
-         attr = attributes[ci];
-         value_length = attributes[ci + 4] - attributes[ci + 3] + 1;
+         value_length = attributes[ci + 4] - attributes[ci + 3];
 
-         if(strcmp(attr, "version") == 0)
+         if(attribute_types[ci / 5] == RDFA_ATTR_VERSION)
          {
-            /* append the attribute-value pair to the XML literal */
-            value = (char*)malloc(value_length + 1);
-            snprintf(value, value_length, "%s", attributes[ci + 3]);
+            value = rdfa_arena_strndup(root_context->arena,
+               attributes[ci + 3], value_length);
             if(strstr(value, "RDFa 1.0") != NULL)
             {
                context->rdfa_version = RDFA_VERSION_1_0;
@@ -477,8 +639,6 @@ static void start_element(void *parser_context, const char* name,
             {
                context->rdfa_version = RDFA_VERSION_1_1;
             }
-
-            free(value);
          }
       }
    }
@@ -488,7 +648,11 @@ static void start_element(void *parser_context, const char* name,
    {
        /* Raptor handles xml:lang itself but not 'lang' */
        xml_lang = (char*)raptor_sax2_inscope_xml_language(context->sax2);
-       xml_lang = rdfa_replace_string(NULL, xml_lang);
+       if(xml_lang != NULL)
+       {
+          xml_lang = rdfa_arena_strndup(
+             root_context->arena, xml_lang, strlen(xml_lang));
+       }
    }
 #endif
 
@@ -498,240 +662,222 @@ static void start_element(void *parser_context, const char* name,
    {
       int ci;
 
-      if(context->rdfa_version == RDFA_VERSION_1_1)
+      if(context->rdfa_version == RDFA_VERSION_1_1 &&
+         (attribute_bits & (RDFA_ATTR_BIT(RDFA_ATTR_VOCAB) |
+            RDFA_ATTR_BIT(RDFA_ATTR_PREFIX) | RDFA_ATTR_BIT(RDFA_ATTR_INLIST))))
       {
          /* process all vocab and prefix attributes */
          for(ci = 0; ci < nb_attributes * 5; ci += 5)
          {
-            const char* attr;
-            char* value;
-            size_t value_length = 0;
+            rdfaattr_t type = (rdfaattr_t)attribute_types[ci / 5];
+            rdfaview value;
 
-            attr = attributes[ci];
-            value_length = attributes[ci + 4] - attributes[ci + 3] + 1;
+            if(type != RDFA_ATTR_VOCAB && type != RDFA_ATTR_PREFIX &&
+               type != RDFA_ATTR_INLIST)
+            {
+               continue;
+            }
 
-            /* append the attribute-value pair to the XML literal */
-            value = (char*)malloc(value_length + 1);
-            snprintf(value, value_length, "%s", attributes[ci + 3]);
+            value.data = attributes[ci + 3];
+            value.length = attributes[ci + 4] - attributes[ci + 3];
 
             /* 2. Next the current element is examined for any change to the
              * default vocabulary via @vocab. */
-            if(strcmp(attr, "vocab") == 0)
+            if(type == RDFA_ATTR_VOCAB)
             {
-               if(strlen(value) < 1)
+               if(value.length < 1)
                {
                   /* If the value is empty, then the local default vocabulary
                    * must be reset to the Host Language defined default
                    * (if any). */
-                  free(context->default_vocabulary);
-                  context->default_vocabulary = NULL;
+                  rdfa_update_default_vocabulary(context, NULL);
                }
                else
                {
                   char* resolved_uri;
-                  rdftriple* triple;
 
                   /* If @vocab is present and contains a value, the local
                    * default vocabulary is updated according to the
                    * section on CURIE and IRI Processing. */
-                  resolved_uri = rdfa_resolve_uri(context, value);
-                  context->default_vocabulary = rdfa_replace_string(
-                     context->default_vocabulary, resolved_uri);
+                  resolved_uri = rdfa_resolve_uri(context,
+                     rdfa_arena_strndup(
+                        root_context->arena, value.data, value.length));
+                  rdfa_update_default_vocabulary(context, resolved_uri);
 
                   /* The value of @vocab is used to generate a triple */
-                  triple = rdfa_create_triple(
-                     context->base, "http://www.w3.org/ns/rdfa#usesVocabulary",
-                     resolved_uri, RDF_TYPE_IRI, NULL, NULL);
-                  context->default_graph_triple_callback(
-                     triple, context->callback_data);
+                  rdfa_generate_default_graph_triple(context,
+                     context->base, RDFA_NO_BNODE,
+                     "http://www.w3.org/ns/rdfa#usesVocabulary",
+                     resolved_uri, RDFA_NO_BNODE, RDF_TYPE_IRI, NULL, NULL);
 
-                  free(resolved_uri);
+                  rdfa_free(resolved_uri);
                }
             }
-            else if(strcmp(attr, "prefix") == 0)
+            else if(type == RDFA_ATTR_PREFIX)
             {
-               /* Mappings are defined via @prefix. */
-               char* working_string = NULL;
-               char* atprefix = NULL;
-               char* iri = NULL;
-               char* saveptr = NULL;
-
-               working_string = rdfa_replace_string(working_string, value);
+               /* Mappings are defined via @prefix. The prefixes and IRIs
+                * are views into the attribute value that go straight into
+                * the URI mappings. */
+               rdfaview rest = value;
+               rdfaview atprefix;
+               rdfaview iri;
 
                /* Values in this attribute are evaluated from beginning to
                 * end (e.g., left to right in typical documents). */
-               atprefix = strtok_r(working_string, ":", &saveptr);
-               while(atprefix != NULL)
+               while(rdfa_next_view_token(&rest, ":", &atprefix))
                {
-                  /* find the prefix and IRI mappings while skipping whitespace */
-                  while((*saveptr == ' ' || *saveptr == '\n' ||
-                     *saveptr == '\r' || *saveptr == '\t' || *saveptr == '\f' ||
-                     *saveptr == '\v') && *saveptr != '\0')
+                  /* find the IRI while skipping whitespace */
+                  if(!rdfa_next_whitespace_token(&rest, &iri))
                   {
-                     saveptr++;
+                     iri.data = NULL;
+                     iri.length = 0;
                   }
-                  iri = strtok_r(NULL, RDFA_WHITESPACE, &saveptr);
 
                   /* update the prefix mappings */
-                  rdfa_update_uri_mappings(context, atprefix, iri);
+                  rdfa_update_uri_mappings_view(context, atprefix, iri);
 
-                  if(!saveptr)
-                      break;
-
-                  while((*saveptr == ' ' || *saveptr == '\n' ||
-                     *saveptr == '\r' || *saveptr == '\t' || *saveptr == '\f' ||
-                     *saveptr == '\v') && *saveptr != '\0')
+                  /* skip the whitespace in front of the next prefix */
+                  while(rest.length > 0 &&
+                     strchr(RDFA_WHITESPACE, rest.data[0]) != NULL)
                   {
-                     saveptr++;
+                     rest.data++;
+                     rest.length--;
                   }
-
-                  /* get the next prefix to process */
-                  atprefix = strtok_r(NULL, ":", &saveptr);
                }
-
-               free(working_string);
             }
-            else if(strcmp(attr, "inlist") == 0)
+            else if(type == RDFA_ATTR_INLIST)
             {
                context->inlist_present = 1;
             }
-            free(value);
          }
       }
 
       /* resolve all of the other RDFa values */
       for(ci = 0; ci < nb_attributes * 5; ci += 5)
       {
+         rdfaattr_t type = (rdfaattr_t)attribute_types[ci / 5];
          const char* attr;
-         char* value;
-         char* attrns;
-         char* literal_text;
-         size_t value_length = 0;
+         const char* attrns;
+         rdfaview value;
 
          attr = attributes[ci];
-         attrns = (char*)attributes[ci + 1];
-         value_length = attributes[ci + 4] - attributes[ci + 3] + 1;
+         attrns = attributes[ci + 1];
+         value.data = attributes[ci + 3];
+         value.length = attributes[ci + 4] - attributes[ci + 3];
 
          /* append the attribute-value pair to the XML literal */
-         value = (char*)malloc(value_length + 1);
-         literal_text = (char*)malloc(strlen(attr) + value_length + 5);
-         snprintf(value, value_length, "%s", attributes[ci + 3]);
-
-         sprintf(literal_text, " %s=\"%s\"", attr, value);
-         context->xml_literal = rdfa_n_append_string(
-            context->xml_literal, &context->xml_literal_size,
-            literal_text, strlen(literal_text));
-         free(literal_text);
+         if(context->capture_literals)
+         {
+            rdfa_buffer_append(xml_buffer, " ", 1);
+            rdfa_buffer_append(xml_buffer, attr, strlen(attr));
+            rdfa_buffer_append(xml_buffer, "=\"", 2);
+            rdfa_buffer_append(xml_buffer, value.data, value.length);
+            rdfa_buffer_append(xml_buffer, "\"", 1);
+         }
 
          /* if xml:lang is defined, ensure that it is not overwritten */
-         if(attrns != NULL && strcmp(attrns, "xml") == 0 &&
-            strcmp(attr, "lang") == 0)
+         if(type == RDFA_ATTR_LANG && attrns != NULL &&
+            strcmp(attrns, "xml") == 0)
          {
             context->xml_literal_xml_lang_defined = 1;
          }
 
-         /* process all of the RDFa attributes */
-         if(strcmp(attr, "about") == 0)
+         /* process all of the RDFa attributes, the values are resolved
+          * straight from the parser's buffer and only the ones that are
+          * kept after the element has been started are copied */
+         if(type == RDFA_ATTR_ABOUT)
          {
-            about_curie = value;
-            about = rdfa_resolve_curie(
-               context, about_curie, CURIE_PARSE_ABOUT_RESOURCE);
+            about = rdfa_resolve_resource_view(context, value,
+               CURIE_PARSE_ABOUT_RESOURCE, &context->about_bnode);
          }
-         else if(strcmp(attr, "src") == 0)
+         else if(type == RDFA_ATTR_SRC)
          {
-            src_curie = value;
-            src = rdfa_resolve_curie(context, src_curie, CURIE_PARSE_HREF_SRC);
+            src = rdfa_resolve_resource_view(context, value,
+               CURIE_PARSE_HREF_SRC, &context->src_bnode);
          }
-         else if(strcmp(attr, "typeof") == 0)
+         else if(type == RDFA_ATTR_TYPEOF)
          {
-            type_of_curie = value;
-            type_of = rdfa_resolve_curie_list(
-               context, type_of_curie,
-               CURIE_PARSE_INSTANCEOF_DATATYPE);
+            type_of = rdfa_resolve_curie_list_into(context, value,
+               CURIE_PARSE_INSTANCEOF_DATATYPE, root_context->arena);
          }
-         else if(strcmp(attr, "rel") == 0)
+         else if(type == RDFA_ATTR_REL)
          {
             context->rel_present = 1;
-            rel_curie = value;
-            rel = rdfa_resolve_curie_list(
-               context, rel_curie, CURIE_PARSE_RELREV);
+            rel = rdfa_resolve_curie_list_into(context, value,
+               CURIE_PARSE_RELREV, root_context->arena);
          }
-         else if(strcmp(attr, "rev") == 0)
+         else if(type == RDFA_ATTR_REV)
          {
             context->rev_present = 1;
-            rev_curie = value;
-            rev = rdfa_resolve_curie_list(
-               context, rev_curie, CURIE_PARSE_RELREV);
+            rev = rdfa_resolve_curie_list_into(context, value,
+               CURIE_PARSE_RELREV, root_context->arena);
          }
-         else if(strcmp(attr, "property") == 0)
+         else if(type == RDFA_ATTR_PROPERTY)
          {
-            property_curie = value;
-            property =
-               rdfa_resolve_curie_list(
-                  context, property_curie, CURIE_PARSE_PROPERTY);
+            property = rdfa_resolve_curie_list_into(context, value,
+               CURIE_PARSE_PROPERTY, root_context->arena);
          }
-         else if(strcmp(attr, "resource") == 0)
+         else if(type == RDFA_ATTR_RESOURCE)
          {
-            resource_curie = value;
-            resource = rdfa_resolve_curie(
-               context, resource_curie, CURIE_PARSE_ABOUT_RESOURCE);
+            resource = rdfa_resolve_resource_view(context, value,
+               CURIE_PARSE_ABOUT_RESOURCE, &context->resource_bnode);
          }
-         else if(strcmp(attr, "href") == 0)
+         else if(type == RDFA_ATTR_HREF)
          {
-            href_curie = value;
-            href =
-               rdfa_resolve_curie(context, href_curie, CURIE_PARSE_HREF_SRC);
+            href = rdfa_resolve_resource_view(context, value,
+               CURIE_PARSE_HREF_SRC, &context->href_bnode);
          }
-         else if(strcmp(attr, "content") == 0)
+         else if(type == RDFA_ATTR_CONTENT)
          {
-            content = rdfa_replace_string(content, value);
+            content = rdfa_arena_strndup(
+               root_context->arena, value.data, value.length);
          }
-         else if(strcmp(attr, "datatype") == 0)
+         else if(type == RDFA_ATTR_DATATYPE)
          {
-            datatype_curie = value;
-
-            if(strlen(datatype_curie) == 0)
+            if(value.length == 0)
             {
                datatype = rdfa_replace_string(datatype, "");
             }
             else
             {
-               datatype = rdfa_resolve_curie(context, datatype_curie,
-                  CURIE_PARSE_INSTANCEOF_DATATYPE);
+               datatype = rdfa_resolve_curie_view(
+                  context, value, CURIE_PARSE_INSTANCEOF_DATATYPE);
             }
          }
-         else if((attrns == NULL && strcmp(attr, "lang") == 0) ||
-            (attrns != NULL && strcmp(attrns, "xml") == 0 &&
-               strcmp(attr, "lang") == 0))
+         else if(type == RDFA_ATTR_LANG &&
+            (attrns == NULL || strcmp(attrns, "xml") == 0))
          {
-            xml_lang = rdfa_replace_string(xml_lang, value);
+            xml_lang = rdfa_arena_strndup(
+               root_context->arena, value.data, value.length);
          }
-
-         free(value);
       }
    }
 
+   /* an attribute that is _: doesn't have an IRI, only a bnode number */
+   has_resource_attribute =
+      RDFA_RESOURCE_IS_SET(about, context->about_bnode) ||
+      RDFA_RESOURCE_IS_SET(resource, context->resource_bnode) ||
+      RDFA_RESOURCE_IS_SET(href, context->href_bnode) ||
+      RDFA_RESOURCE_IS_SET(src, context->src_bnode);
+
    /* The root element has an implicit @about declaration */
-   if(context->depth == 1 && about == NULL && resource == NULL &&
-      href == NULL && src == NULL)
+   if(context->depth == 1 && !has_resource_attribute)
    {
-      about_curie = "";
-      about = rdfa_resolve_curie(
-         context, about_curie, CURIE_PARSE_ABOUT_RESOURCE);
+      about = rdfa_resolve_curie(context, "", CURIE_PARSE_ABOUT_RESOURCE);
    }
 
    /* The HEAD and BODY element in XHTML and HTML has an implicit
     * about="" on it.
     */
-   if(about == NULL && resource == NULL && href == NULL && src == NULL &&
-      (context->parent_subject == NULL || type_of != NULL) &&
+   if(!has_resource_attribute && about == NULL &&
+      (!RDFA_RESOURCE_IS_SET(
+         context->parent_subject, context->parent_subject_bnode) ||
+         type_of != NULL) &&
       ((context->host_language == HOST_LANGUAGE_XHTML1 ||
       context->host_language == HOST_LANGUAGE_HTML) &&
       (strcasecmp(name, "head") == 0 || strcasecmp(name, "body") == 0)))
    {
-      about_curie = "";
-      about = rdfa_resolve_curie(
-         context, about_curie, CURIE_PARSE_ABOUT_RESOURCE);
+      about = rdfa_resolve_curie(context, "", CURIE_PARSE_ABOUT_RESOURCE);
    }
 
    /* check to see if we should append an xml:lang to the XML Literal
@@ -740,22 +886,25 @@ static void start_element(void *parser_context, const char* name,
    if((xml_lang == NULL) && (context->language != NULL) &&
       !context->xml_literal_xml_lang_defined)
    {
-      context->xml_literal = rdfa_n_append_string(
-         context->xml_literal, &context->xml_literal_size,
-         " xml:lang=\"", strlen(" xml:lang=\""));
-      context->xml_literal = rdfa_n_append_string(
-         context->xml_literal, &context->xml_literal_size,
-         context->language, strlen(context->language));
-      context->xml_literal = rdfa_n_append_string(
-         context->xml_literal, &context->xml_literal_size, "\"", 1);
+      if(context->capture_literals)
+      {
+         rdfa_buffer_append(
+            xml_buffer, " xml:lang=\"", strlen(" xml:lang=\""));
+         rdfa_buffer_append(
+            xml_buffer, context->language, strlen(context->language));
+         rdfa_buffer_append(xml_buffer, "\"", 1);
+      }
 
       /* ensure that the lang isn't set in a subtree (unless it's overwritten) */
       context->xml_literal_xml_lang_defined = 1;
    }
 
    /* close the XML Literal value */
-   context->xml_literal = rdfa_n_append_string(
-      context->xml_literal, &context->xml_literal_size, ">", 1);
+   if(context->capture_literals)
+   {
+      rdfa_buffer_append(xml_buffer, ">", 1);
+      context->xml_literal_content_start = xml_buffer->length;
+   }
 
    /* 3. The [current element] is also parsed for any language
     *    information, and [language] is set in the [current
@@ -821,9 +970,8 @@ static void start_element(void *parser_context, const char* name,
 
    /* TODO: This isn't part of the processing model, it needs to be
     * included and is a correction for the last item in step #4. */
-   if((about == NULL) && (src == NULL) && (type_of == NULL) &&
+   if(!has_resource_attribute && (about == NULL) && (type_of == NULL) &&
       (rel == NULL) && (rev == NULL) && (property == NULL) &&
-      (resource == NULL) && (href == NULL) &&
       (context->default_vocabulary == NULL) && (prefix == NULL))
    {
       context->skip_element = 1;
@@ -866,10 +1014,13 @@ static void start_element(void *parser_context, const char* name,
       }
    }
 
-   if(context->new_subject != NULL)
+   if(RDFA_RESOURCE_IS_SET(context->new_subject, context->new_subject_bnode))
    {
 #if defined(DEBUG) && DEBUG > 0
-     printf("DEBUG: new_subject = %s\n", context->new_subject);
+     char name[RDFA_BNODE_NAME_SIZE];
+
+     printf("DEBUG: new_subject = %s\n", rdfa_resource_name(
+        context->new_subject, context->new_subject_bnode, name));
 #endif
 
       /* RDFa 1.0: 6. If in any of the previous steps a [new subject] was set
@@ -888,7 +1039,8 @@ static void start_element(void *parser_context, const char* name,
        * [new subject] value, i.e., [new subject] remains null. */
    }
 
-   if(context->current_object_resource != NULL)
+   if(RDFA_RESOURCE_IS_SET(context->current_object_resource,
+      context->current_object_resource_bnode))
    {
       /* If the element contains both the @inlist and the @rel attributes:
        * the @rel may contain one or more resources, obtained according to
@@ -911,7 +1063,8 @@ static void start_element(void *parser_context, const char* name,
             }
          }
          rdfa_establish_new_inlist_triples(
-            context, rel, context->current_object_resource, object_type);
+            context, rel, context->current_object_resource,
+            context->current_object_resource_bnode, object_type);
       }
 
       /* 7. If in any of the previous steps a [current object  resource]
@@ -919,13 +1072,15 @@ static void start_element(void *parser_context, const char* name,
       rdfa_complete_relrev_triples(context, rel, rev);
    }
 
-   if((context->current_object_resource == NULL) &&
+   if(!RDFA_RESOURCE_IS_SET(context->current_object_resource,
+         context->current_object_resource_bnode) &&
       context->rdfa_version == RDFA_VERSION_1_1  && (rel != NULL) &&
       context->inlist_present)
    {
       rdfa_save_incomplete_list_triples(context, rel);
    }
-   else if((context->current_object_resource == NULL) &&
+   else if(!RDFA_RESOURCE_IS_SET(context->current_object_resource,
+         context->current_object_resource_bnode) &&
       ((rel != NULL) || (rev != NULL)))
    {
       /* 8. If however [current object resource] was set to null, but
@@ -943,86 +1098,81 @@ static void start_element(void *parser_context, const char* name,
       context->xml_literal_namespaces_defined = 0;
    }
 
-   /* save these for processing steps #9 and #10 */
-   context->about = rdfa_replace_string(context->about, about);
-   context->resource = rdfa_replace_string(context->resource, resource);
-   context->href = rdfa_replace_string(context->href, href);
-   context->src = rdfa_replace_string(context->src, src);
-   context->content = rdfa_replace_string(context->content, content);
-   context->datatype = rdfa_replace_string(context->datatype, datatype);
+   /* save these for processing steps #9 and #10, the context takes
+    * ownership of the resolved CURIEs and the content and the property
+    * list are allocated from the arena */
+   context->about = about;
+   context->resource = resource;
+   context->href = href;
+   context->src = src;
+   context->content = content;
+   context->datatype = datatype;
    context->property = property;
 
-   /* free the resolved CURIEs */
-   free(about);
-   free(src);
-   rdfa_free_list(type_of);
-   rdfa_free_list(rel);
-   rdfa_free_list(rev);
-   free(xml_lang);
-   free(content);
-   free(resource);
-   free(href);
-   free(datatype);
+   /* pass the property value to the literal chunk handler as it is parsed
+    * if possible, the element then only needs to build literals if its
+    * parent does */
+   if(rdfa_can_stream_current_property_value(context))
+   {
+      rdfacontext* parent_context = (rdfacontext*)
+         context_stack->items[context_stack->num_items - 2]->data;
+
+      context->outer_streaming_context = context->streaming_context;
+      context->streaming_context = context;
+      if(!parent_context->capture_literals)
+      {
+         rdfa_buffer_truncate(
+            root_context->plain_literal_buffer, context->plain_literal_start);
+         rdfa_buffer_truncate(xml_buffer, context->xml_literal_start);
+         context->capture_literals = 0;
+      }
+   }
+
 }
 
 static void character_data(
       void *parser_context, const xmlChar *s, int len)
 {
    /*xmlParserCtxtPtr parser = (xmlParserCtxtPtr)parser_context;*/
-   rdfalist* context_stack =
-      (rdfalist*)((rdfacontext*)parser_context)->context_stack;
+   rdfacontext* root_context = (rdfacontext*)parser_context;
+   rdfalist* context_stack = (rdfalist*)root_context->context_stack;
    rdfacontext* context = (rdfacontext*)
       context_stack->items[context_stack->num_items - 1]->data;
+   rdfacontext* streaming_context = context->streaming_context;
 
-   char *buffer = (char*)malloc(len + 1);
-   memset(buffer, 0, len + 1);
-   memcpy(buffer, s, len);
-
-   /* append the text to the current context's plain literal */
-   if(context->plain_literal == NULL)
+   /* pass the text to every open element that streams its property value */
+   while(streaming_context != NULL)
    {
-      context->plain_literal =
-         rdfa_replace_string(context->plain_literal, buffer);
-      context->plain_literal_size = len;
-   }
-   else
-   {
-      context->plain_literal = rdfa_n_append_string(
-         context->plain_literal,
-         &context->plain_literal_size, buffer, len);
+      rdfa_stream_current_property_value(
+         streaming_context, (const char*)s, len);
+      streaming_context = streaming_context->outer_streaming_context;
    }
 
-   /* append the text to the current context's XML literal */
-   if(context->xml_literal == NULL)
+   /* the text is only needed if it can end up in a literal */
+   if(!context->capture_literals)
    {
-      context->xml_literal =
-         rdfa_replace_string(context->xml_literal, buffer);
-      context->xml_literal_size = len;
+      return;
    }
-   else
-   {
-      context->xml_literal = rdfa_n_append_string(
-         context->xml_literal, &context->xml_literal_size, buffer, len);
-  }
-
-   /*printf("plain_literal: %s\n", context->plain_literal);*/
-   /*printf("xml_literal: %s\n", context->xml_literal);*/
 
-   free(buffer);
+   /* append the text to the current context's plain and XML literals
+    * straight from the parser's buffer */
+   rdfa_buffer_append(root_context->plain_literal_buffer, (const char*)s, len);
+   rdfa_buffer_append(root_context->xml_literal_buffer, (const char*)s, len);
+   context->plain_literal_present = 1;
 }
 
 static void end_element(void* parser_context, const char* name,
    const char* prefix,const xmlChar* URI)
 {
    /*xmlParserCtxtPtr parser = (xmlParserCtxtPtr)parser_context;*/
-   rdfalist* context_stack =
-      (rdfalist*)((rdfacontext*)parser_context)->context_stack;
+   rdfacontext* root_context = (rdfacontext*)parser_context;
+   rdfalist* context_stack = (rdfalist*)root_context->context_stack;
    rdfacontext* context = (rdfacontext*)rdfa_pop_item(context_stack);
    rdfacontext* parent_context = (rdfacontext*)
       context_stack->items[context_stack->num_items - 1]->data;
-
-   /* append the text to the current context's XML literal */
-   char* buffer = (char*)malloc(strlen(name) + 4);
+   rdfaarenamark arena_mark = context->arena_mark;
+   rdfabuffer* plain_buffer = root_context->plain_literal_buffer;
+   rdfabuffer* xml_buffer = root_context->xml_literal_buffer;
 
 #if defined(DEBUG) && DEBUG > 0
    printf("DEBUG: </%s>\n", name);
@@ -1031,59 +1181,34 @@ static void end_element(void* parser_context, const char* name,
          (print_mapping_value_fp)rdfa_print_triple_list);
 #endif
 
-   sprintf(buffer, "</%s>", name);
-   if(context->xml_literal == NULL)
-   {
-      context->xml_literal =
-         rdfa_replace_string(context->xml_literal, buffer);
-      context->xml_literal_size = strlen(buffer);
-   }
-   else
-   {
-      context->xml_literal = rdfa_n_append_string(
-         context->xml_literal, &context->xml_literal_size,
-         buffer, strlen(buffer));
-   }
-   free(buffer);
-
    /* 9. The next step of the iteration is to establish any
     * [current object literal]; */
 
    /* generate the complete object literal triples */
-   if(context->property != NULL)
+   if(context->streaming_context == context)
    {
-      /* save the current xml literal */
-      char* saved_xml_literal = context->xml_literal;
-      char* content_start = NULL;
-      char* content_end = NULL;
-
-      /* ensure to mark only the inner-content of the XML node for
-       * processing the object literal. */
-      buffer = NULL;
+      /* the value has already been passed on, so just finish it */
+      rdfa_stream_current_property_value(context, NULL, 0);
+   }
+   else if(context->property != NULL)
+   {
+      /* the literals are the inner content of the element, which runs to
+       * the end of the literal buffers since the end tag hasn't been
+       * written yet */
+      context->xml_literal =
+         xml_buffer->data + context->xml_literal_content_start;
 
-      if(context->xml_literal != NULL)
+      /* the plain literal is an empty string if the XML Literal is */
+      if(xml_buffer->length == context->xml_literal_content_start)
       {
-         /* get the data between the first tag and the last tag */
-         content_start = strchr(context->xml_literal, '>');
-         content_end = strrchr(context->xml_literal, '<');
-
-         if((content_start != NULL) && (content_end != NULL))
-         {
-            /* set content end to null terminator */
-            context->xml_literal = ++content_start;
-            *content_end = '\0';
-         }
+         context->plain_literal_present = 1;
       }
-
-      /* update the plain literal if the XML Literal is an empty string */
-      if(context->xml_literal != NULL && strlen(context->xml_literal) == 0)
+      if(context->plain_literal_present)
       {
          context->plain_literal =
-            rdfa_replace_string(context->plain_literal, "");
+            plain_buffer->data + context->plain_literal_start;
       }
 
-      /* process data between first tag and last tag
-       * this needs the xml literal to be null terminated */
       if(context->rdfa_version == RDFA_VERSION_1_0)
       {
          rdfa_complete_object_literal_triples(context);
@@ -1093,83 +1218,52 @@ static void end_element(void* parser_context, const char* name,
          rdfa_complete_current_property_value_triples(context);
       }
 
-      if(content_end != NULL)
+      context->xml_literal = NULL;
+      context->plain_literal = NULL;
+   }
+
+   if(context->capture_literals)
+   {
+      if(parent_context != NULL && parent_context->capture_literals)
       {
-         /* set content end back */
-         *content_end = '<';
+         /* the literals of this element are part of the parent's
+          * literals, so finish them with the end tag */
+         rdfa_buffer_append(xml_buffer, "</", 2);
+         rdfa_buffer_append(xml_buffer, name, strlen(name));
+         rdfa_buffer_append(xml_buffer, ">", 1);
+         if(context->plain_literal_present)
+         {
+            parent_context->plain_literal_present = 1;
+         }
       }
-
-      if(saved_xml_literal != NULL)
+      else
       {
-         /* restore xml literal */
-         context->xml_literal = saved_xml_literal;
+         /* nothing needs the literals of this element any more */
+         rdfa_buffer_truncate(plain_buffer, context->plain_literal_start);
+         rdfa_buffer_truncate(xml_buffer, context->xml_literal_start);
       }
    }
 
-   /*printf(context->plain_literal);*/
-
    if(parent_context != NULL) {
-       /* append the XML literal and plain text literals to the parent
-        * literals */
-       if(context->xml_literal != NULL)
-       {
-          if(parent_context->xml_literal == NULL)
-          {
-             parent_context->xml_literal =
-                rdfa_replace_string(
-                   parent_context->xml_literal, context->xml_literal);
-             parent_context->xml_literal_size = context->xml_literal_size;
-          }
-          else
-          {
-             parent_context->xml_literal =
-                rdfa_n_append_string(
-                   parent_context->xml_literal,
-                   &parent_context->xml_literal_size,
-                   context->xml_literal, context->xml_literal_size);
-          }
-
-          /* if there is an XML literal, there is probably a plain literal */
-          if(context->plain_literal != NULL)
-          {
-             if(parent_context->plain_literal == NULL)
-             {
-                parent_context->plain_literal =
-                   rdfa_replace_string(
-                      parent_context->plain_literal, context->plain_literal);
-                parent_context->plain_literal_size =
-                   context->plain_literal_size;
-             }
-             else
-             {
-                parent_context->plain_literal =
-                   rdfa_n_append_string(
-                      parent_context->plain_literal,
-                      &parent_context->plain_literal_size,
-                      context->plain_literal,
-                      context->plain_literal_size);
-             }
-          }
-       }
-
        /* preserve the bnode count by copying it to the parent_context */
        parent_context->bnode_count = context->bnode_count;
-       parent_context->underscore_colon_bnode_name = \
-          rdfa_replace_string(parent_context->underscore_colon_bnode_name,
-                              context->underscore_colon_bnode_name);
+       parent_context->underscore_colon_bnode =
+          context->underscore_colon_bnode;
    }
 
    /* 10. If the [ skip element ] flag is 'false', and [ new subject ]
     * was set to a non-null value, then any [ incomplete triple ]s
     * within the current context should be completed: */
-   if((context->skip_element == 0) && (context->new_subject != NULL))
+   if((context->skip_element == 0) && RDFA_RESOURCE_IS_SET(
+      context->new_subject, context->new_subject_bnode))
    {
       rdfa_complete_incomplete_triples(context);
    }
 
    /* 14. Once all the child elements have been traversed, list triples are
     * generated, if necessary. */
-   if(context->rdfa_version == RDFA_VERSION_1_1 && (context->new_subject != NULL))
+   if(context->rdfa_version == RDFA_VERSION_1_1 && RDFA_RESOURCE_IS_SET(
+      context->new_subject, context->new_subject_bnode))
    {
       rdfa_complete_list_triples(context);
 
@@ -1179,7 +1273,7 @@ static void end_element(void* parser_context, const char* name,
          rdfa_free_mapping(parent_context->local_list_mappings,
             (free_mapping_value_fp)rdfa_free_list);
          parent_context->local_list_mappings = rdfa_copy_mapping(
-            (void**)context->local_list_mappings,
+            context->local_list_mappings,
             (copy_mapping_value_fp)rdfa_replace_list);
 
 #if defined(DEBUG) && DEBUG > 0
@@ -1193,8 +1287,15 @@ static void end_element(void* parser_context, const char* name,
       }
    }
 
-   /* free the context */
-   rdfa_free_context(context);
+   /* undo the prefix and vocabulary changes made by this element */
+   rdfa_restore_mappings(context);
+
+   /* release the context so that it can be re-used by the next element */
+   rdfa_release_element_context(context_stack, context);
+
+   /* release everything that was allocated from the arena while the
+    * element was being processed */
+   rdfa_arena_rewind(root_context->arena, &arena_mark);
 
 #if defined(DEBUG) && DEBUG > 0
    printf("-------------------------------------------------------------\n");
@@ -1218,6 +1319,71 @@ void rdfa_set_buffer_filler(rdfacontext* context, buffer_filler_fp bf)
    context->buffer_filler_callback = bf;
 }
 
+void rdfa_set_literal_chunk_handler(
+   rdfacontext* context, literal_chunk_handler_fp lch)
+{
+   context->literal_chunk_callback = lch;
+}
+
+void rdfa_set_borrowed_triple_handler(
+   rdfacontext* context, borrowed_triple_handler_fp bth)
+{
+   context->borrowed_triple_callback = bth;
+}
+
+void rdfa_set_compact_triple_handler(rdfacontext* context,
+   namespace_handler_fp nh, compact_triple_handler_fp cth)
+{
+   context->namespace_callback = nh;
+   context->compact_triple_callback = cth;
+}
+
+void rdfa_set_allocator(
+   rdfacontext* context, memory_alloc_fp alloc_func,
+   memory_realloc_fp realloc_func, memory_free_fp free_func, void* user_data)
+{
+   rdfaallocator old_allocator = context->allocator;
+   const rdfaallocator* previous_allocator;
+   char* base = NULL;
+
+   /* an allocator that is only partly given would free memory that it
+    * didn't allocate, so it falls back to the standard allocator */
+   if(alloc_func == NULL || realloc_func == NULL || free_func == NULL)
+   {
+      alloc_func = NULL;
+      realloc_func = NULL;
+      free_func = NULL;
+      user_data = NULL;
+   }
+   context->allocator.alloc_callback = alloc_func;
+   context->allocator.realloc_callback = realloc_func;
+   context->allocator.free_callback = free_func;
+   context->allocator.callback_data = user_data;
+
+   /* the base was copied with the old allocator, so move it over to the
+    * new one */
+   previous_allocator = rdfa_use_allocator(&context->allocator);
+   if(context->base != NULL)
+   {
+      base = rdfa_strdup(context->base);
+   }
+   rdfa_use_allocator(&old_allocator);
+   rdfa_free(context->base);
+   context->base = base;
+   rdfa_use_allocator(previous_allocator);
+}
+
+void rdfa_set_shared_curie_cache(
+   rdfacontext* context, rdfasharedcuriecache* cache)
+{
+#ifdef LIBRDFA_IN_RAPTOR
+   /* Raptor keeps the URI mappings itself, so their fingerprint can't be
+    * kept */
+#else
+   context->shared_curie_cache = cache;
+#endif
+}
+
 #ifdef LIBRDFA_IN_RAPTOR
 /* Raptor reports its errors a different way */
 #else
@@ -1272,7 +1438,7 @@ static void raptor_rdfa_start_element(void *user_data,
      * xml_element or contained objects - qnames, namespaces, uris
      * and values
      */
-    attr = (char**)malloc(sizeof(char*) * (1 + (nb_attributes * 5)));
+    attr = (char**)rdfa_malloc(sizeof(char*) * (1 + (nb_attributes * 5)));
     for(i = 0; i < nb_attributes; i++) {
       const raptor_namespace* attr_ns = attrs[i]->nspace;
       char** attri = &attr[5 * i];
@@ -1313,7 +1479,7 @@ static void raptor_rdfa_start_element(void *user_data,
                 nb_defaulted,
                 (const char**)attr);
   if(attr)
-    free(attr);
+    rdfa_free(attr);
   raptor_free_memory(localname);
 }
 
@@ -1357,14 +1523,28 @@ int rdfa_parse_start(rdfacontext* context)
 {
    /* create the buffers and expat parser */
    int rval = RDFA_PARSE_SUCCESS;
+   const rdfaallocator* previous_allocator =
+      rdfa_use_allocator(&context->allocator);
 
    context->wb_allocated = sizeof(char) * READ_BUFFER_SIZE;
    /* +1 for NUL at end, to allow strstr() etc. to work
     * malloc - only the first char needs to be NUL */
-   context->working_buffer = (char*)malloc(context->wb_allocated + 1);
+   context->working_buffer = (char*)rdfa_malloc(context->wb_allocated + 1);
    *context->working_buffer = '\0';
    context->done = 0;
    context->context_stack = rdfa_create_list(32);
+   context->arena = rdfa_create_arena(ARENA_BLOCK_SIZE);
+   context->plain_literal_buffer = rdfa_create_buffer(LITERAL_BUFFER_SIZE);
+   context->xml_literal_buffer = rdfa_create_buffer(LITERAL_BUFFER_SIZE);
+   if(context->compact_triple_callback != NULL)
+   {
+      context->namespaces = rdfa_create_mapping(MAX_NAMESPACES);
+   }
+#ifndef LIBRDFA_IN_RAPTOR
+   /* Raptor keeps the URI mappings itself, so changes to them can't be
+    * tracked for the CURIE cache */
+   context->curie_cache = rdfa_create_curie_cache(CURIE_CACHE_SIZE);
+#endif
 
    /* initialize the context stack */
    rdfa_push_item(context->context_stack, context, RDFALIST_FLAG_CONTEXT);
@@ -1397,10 +1577,12 @@ int rdfa_parse_start(rdfacontext* context)
    raptor_sax2_parse_start(context->sax2, context->base_uri);
 #endif
 
+   rdfa_use_allocator(previous_allocator);
+
    return rval;
 }
 
-int rdfa_parse_chunk(rdfacontext* context, char* data, size_t wblen, int done)
+static int parse_chunk(rdfacontext* context, char* data, size_t wblen, int done)
 {
 #ifdef LIBRDFA_IN_RAPTOR
 #else
@@ -1479,8 +1661,23 @@ int rdfa_parse_chunk(rdfacontext* context, char* data, size_t wblen, int done)
    return RDFA_PARSE_SUCCESS;
 }
 
+int rdfa_parse_chunk(rdfacontext* context, char* data, size_t wblen, int done)
+{
+   int rval;
+   const rdfaallocator* previous_allocator =
+      rdfa_use_allocator(&context->allocator);
+
+   rval = parse_chunk(context, data, wblen, done);
+   rdfa_use_allocator(previous_allocator);
+
+   return rval;
+}
+
 void rdfa_parse_end(rdfacontext* context)
 {
+   const rdfaallocator* previous_allocator =
+      rdfa_use_allocator(&context->allocator);
+
    /* free context stack */
    rdfa_free_context_stack(context);
 
@@ -1491,10 +1688,12 @@ void rdfa_parse_end(rdfacontext* context)
    raptor_free_sax2(context->sax2);
    context->sax2=NULL;
 #else
-   /* free parser */
+   /* free parser, libxml2's global state is left alone because other
+    * threads may still be parsing with it */
    xmlFreeParserCtxt(context->parser);
-   xmlCleanupParser();
 #endif
+
+   rdfa_use_allocator(previous_allocator);
 }
 
 char* rdfa_get_buffer(rdfacontext* context, size_t* blen)
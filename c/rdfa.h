@@ -111,6 +111,8 @@ extern "C"
 #define MAX_LIST_ITEMS 16
 #define MAX_TERM_MAPPINGS 64
 #define MAX_URI_MAPPINGS 128
+#define MAX_URI_MAPPINGS_UNDO 8
+#define MAX_NAMESPACES 32
 #define MAX_INCOMPLETE_TRIPLES 128
 
 /* host language definitions */
@@ -139,6 +141,44 @@ typedef enum
    RDF_TYPE_UNKNOWN
 } rdfresource_t;
 
+/**
+ * The specification for a callback that allocates memory. It is given the
+ * number of bytes to allocate and the allocator's user data.
+ */
+typedef void* (*memory_alloc_fp)(size_t, void*);
+
+/**
+ * The specification for a callback that resizes memory that was allocated
+ * by the same allocator. It is given the memory to resize, the new number
+ * of bytes and the allocator's user data.
+ */
+typedef void* (*memory_realloc_fp)(void*, size_t, void*);
+
+/**
+ * The specification for a callback that frees memory that was allocated by
+ * the same allocator. It is given the memory to free and the allocator's
+ * user data.
+ */
+typedef void (*memory_free_fp)(void*, void*);
+
+/**
+ * An allocator is the set of callbacks that librdfa uses for all of the
+ * memory that it allocates while parsing a document.
+ */
+typedef struct rdfaallocator
+{
+   memory_alloc_fp alloc_callback;
+   memory_realloc_fp realloc_callback;
+   memory_free_fp free_callback;
+   void* callback_data;
+} rdfaallocator;
+
+/**
+ * The number of a subject or an object that isn't a bnode that the
+ * parser created, such as an IRI or a bnode that the document names.
+ */
+#define RDFA_NO_BNODE ((size_t)-1)
+
 /**
  * An RDF triple is the result of an RDFa statement that contains, at
  * the very least, a subject, a predicate and an object. It is the
@@ -152,6 +192,15 @@ typedef struct rdftriple
    rdfresource_t object_type;
    char* datatype;
    char* language;
+   /* the numbers of the subject and the object if they are bnodes that
+    * the parser created, which are named _:bnode followed by the number,
+    * RDFA_NO_BNODE otherwise, even if the document names a bnode in the
+    * same way */
+   size_t subject_bnode;
+   size_t object_bnode;
+   /* the allocator that the triple was created with, NULL if it was
+    * created with the standard allocator */
+   const rdfaallocator* allocator;
 } rdftriple;
 
 /**
@@ -161,6 +210,67 @@ typedef struct rdftriple
  */
 typedef void (*triple_handler_fp)(rdftriple*, void*);
 
+/**
+ * The specification for a callback that is capable of handling triples
+ * that it doesn't take ownership of. The strings of the triple belong to
+ * the parser, so the triple is only valid during the call and must not
+ * be freed.
+ */
+typedef void (*borrowed_triple_handler_fp)(const rdftriple*, void*);
+
+/**
+ * The specification for a callback that is capable of handling literal
+ * values in chunks. It is given a triple that holds the subject,
+ * predicate, type, datatype and language of the literal, the next chunk
+ * of the literal and the length of the chunk. Once the literal is
+ * complete, it is called with a NULL chunk. The triple is only valid
+ * during the call and must not be freed.
+ */
+typedef void (*literal_chunk_handler_fp)(
+   const rdftriple*, const char*, size_t, void*);
+
+/**
+ * The namespace id of an IRI that isn't split into a namespace and a
+ * local name, such as a blank node, or of a value that isn't an IRI.
+ */
+#define RDFA_NO_NAMESPACE 0
+
+/**
+ * A triple whose IRIs are split into the id of a namespace and a local
+ * name. The namespace ids start at 1 and are announced to the namespace
+ * handler before they are first used. The values that aren't split have
+ * the namespace id RDFA_NO_NAMESPACE. The bnode numbers are those of the
+ * triple that the compact triple is made from.
+ */
+typedef struct rdfcompacttriple
+{
+   unsigned int subject_namespace;
+   const char* subject;
+   unsigned int predicate_namespace;
+   const char* predicate;
+   unsigned int object_namespace;
+   const char* object;
+   rdfresource_t object_type;
+   unsigned int datatype_namespace;
+   const char* datatype;
+   const char* language;
+   size_t subject_bnode;
+   size_t object_bnode;
+} rdfcompacttriple;
+
+/**
+ * The specification for a callback that is capable of handling compact
+ * triples. The triple is only valid during the call and must not be
+ * freed.
+ */
+typedef void (*compact_triple_handler_fp)(const rdfcompacttriple*, void*);
+
+/**
+ * The specification for a callback that is told the IRI of each
+ * namespace that compact triples refer to, together with its id.
+ */
+typedef void (*namespace_handler_fp)(unsigned int, const char*, void*);
+
 /**
  * The specification for a callback that is used to fill the input buffer
  * with data to parse.
@@ -191,6 +301,161 @@ typedef struct rdfalist
    unsigned int user_data;
 } rdfalist;
 
+/**
+ * An RDFa arena block is a chunk of memory that arena allocations are
+ * carved out of. The memory for the allocations follows the block header.
+ */
+typedef struct rdfaarenablock
+{
+   struct rdfaarenablock* next;
+   size_t size;
+   size_t used;
+} rdfaarenablock;
+
+/**
+ * An RDFa arena is a stack-disciplined allocator. Memory is handed out
+ * by bumping a pointer and is released all at once by rewinding the
+ * arena to a mark that was taken earlier. Blocks are kept for re-use
+ * when the arena is rewound.
+ */
+typedef struct rdfaarena
+{
+   rdfaarenablock* first;
+   rdfaarenablock* current;
+   size_t block_size;
+} rdfaarena;
+
+/**
+ * An RDFa arena mark records the position of an arena so that it can
+ * be rewound to that position later.
+ */
+typedef struct rdfaarenamark
+{
+   rdfaarenablock* block;
+   size_t used;
+} rdfaarenamark;
+
+/**
+ * An RDFa buffer is a growable string that is always NUL-terminated. The
+ * literals of all open elements are written to one buffer per parse and
+ * each element remembers the offset at which its literal starts.
+ */
+typedef struct rdfabuffer
+{
+   char* data;
+   size_t length;
+   size_t allocated;
+} rdfabuffer;
+
+/**
+ * An RDFa view is a string that is owned by someone else, such as an
+ * attribute value in the buffer of the XML parser. The characters of a
+ * view are not NUL-terminated and are only valid as long as the owner
+ * keeps them.
+ */
+typedef struct rdfaview
+{
+   const char* data;
+   size_t length;
+} rdfaview;
+
+/**
+ * The parts of a base IRI that relative IRIs are resolved against, as
+ * offsets into the base. A base never has a query or a fragment, so its
+ * path runs to its end.
+ */
+typedef struct rdfabaseparts
+{
+   size_t length;
+   /* the end of the scheme and the authority, where an absolute path is
+    * appended */
+   size_t authority_end;
+   /* the end of the last '/' of the path, where a relative path is
+    * appended, or 0 if the base has no '/' */
+   size_t directory_end;
+} rdfabaseparts;
+
+/**
+ * An RDFa mapping entry associates a key with a value. The hash of the
+ * key is kept with the entry so that it doesn't have to be recomputed
+ * when the mapping is searched or grows.
+ */
+typedef struct rdfamappingentry
+{
+   char* key;
+   void* value;
+   unsigned int hash;
+} rdfamappingentry;
+
+/**
+ * An RDFa mapping is used to associate strings with values, such as
+ * prefixes with IRIs or terms with IRIs. Entries are kept in the order
+ * in which they were added and are found through an open addressing
+ * hash index. The structure grows with use.
+ */
+typedef struct rdfamapping
+{
+   rdfamappingentry* entries;
+   size_t num_entries;
+   size_t num_deleted;
+   size_t max_entries;
+   size_t* index;
+   size_t index_size;
+} rdfamapping;
+
+/**
+ * An RDFa CURIE cache entry remembers what a token resolved to for one
+ * version of the URI mappings and the default vocabulary. The token and
+ * the IRI are kept in a single allocation.
+ */
+typedef struct rdfacuriecacheentry
+{
+   char* token;
+   size_t token_length;
+   const char* iri;
+   unsigned int hash;
+   int kind;
+   int rdfa_version;
+   unsigned long mapping_version;
+} rdfacuriecacheentry;
+
+/**
+ * An RDFa CURIE cache memoizes the resolution of CURIEs and IRIs during
+ * a parse. It is a direct-mapped table, a new entry replaces the entry
+ * that is in its slot. Every change to the URI mappings or the default
+ * vocabulary gets a new mapping version, entries are only used for the
+ * version that they were made with.
+ */
+typedef struct rdfacuriecache
+{
+   rdfacuriecacheentry* entries;
+   size_t size;
+   unsigned long last_mapping_version;
+   unsigned char side_effects;
+   unsigned char uses_base;
+} rdfacuriecache;
+
+/**
+ * An RDFa shared CURIE cache keeps the resolution of CURIEs across
+ * documents, so that the documents of a crawl that declare the same
+ * prefixes and vocabulary don't resolve the same CURIEs again. When
+ * librdfa is built with pthreads, a shared cache may be used by contexts
+ * in different threads at once. Its members are private to librdfa.
+ */
+typedef struct rdfasharedcuriecache rdfasharedcuriecache;
+
+/**
+ * An RDFa mapping fingerprint identifies the URI mappings, the term
+ * mappings and the default vocabulary that are in scope. Each part is a
+ * sum of the hashes of every mapping, so the fingerprint is updated as
+ * single mappings change.
+ */
+typedef struct rdfafingerprint
+{
+   unsigned long hash1;
+   unsigned long hash2;
+} rdfafingerprint;
+
 /**
  * The RDFa Parser structure is responsible for keeping track of the state of
  * the current RDFa parser. Things such as the default namespace,
@@ -200,15 +465,25 @@ typedef struct rdfacontext
 {
    unsigned char rdfa_version;
    char* base;
+   rdfabaseparts base_parts;
    char* parent_subject;
    char* parent_object;
+   /* the bnode numbers of the resources of the context, see rdftriple */
+   size_t parent_subject_bnode;
+   size_t parent_object_bnode;
    char* default_vocabulary;
 #ifndef LIBRDFA_IN_RAPTOR
-   void** uri_mappings;
+   /* the prefixes that the document declared, which hide the prefixes of
+    * the initial context with the same name */
+   rdfamapping* uri_mappings;
+   rdfamapping* initial_uri_mappings;
 #endif
-   void** term_mappings;
-   void** list_mappings;
-   void** local_list_mappings;
+   /* the terms that aren't from an initial context, which are shared and
+    * read-only, and the initial contexts whose terms are in scope */
+   rdfamapping* term_mappings;
+   unsigned char initial_terms;
+   rdfamapping* list_mappings;
+   rdfamapping* local_list_mappings;
    rdfalist* incomplete_triples;
    rdfalist* local_incomplete_triples;
    char* language;
@@ -217,35 +492,66 @@ typedef struct rdfacontext
    triple_handler_fp default_graph_triple_callback;
    buffer_filler_fp buffer_filler_callback;
    triple_handler_fp processor_graph_triple_callback;
+   literal_chunk_handler_fp literal_chunk_callback;
+   borrowed_triple_handler_fp borrowed_triple_callback;
+   compact_triple_handler_fp compact_triple_callback;
+   namespace_handler_fp namespace_callback;
 
    unsigned char recurse;
    unsigned char skip_element;
    char* new_subject;
    char* current_object_resource;
+   size_t new_subject_bnode;
+   size_t current_object_resource_bnode;
 
    char* about;
    char* typed_resource;
    char* resource;
    char* href;
    char* src;
+   size_t about_bnode;
+   size_t typed_resource_bnode;
+   size_t resource_bnode;
+   size_t href_bnode;
+   size_t src_bnode;
    char* content;
    char* datatype;
    rdfalist* property;
    unsigned char inlist_present;
    unsigned char rel_present;
    unsigned char rev_present;
+   /* the literals of the element, these point into the literal buffers
+    * of the root context and are only set while the object literal is
+    * being processed */
    char* plain_literal;
-   size_t plain_literal_size;
    char* xml_literal;
-   size_t xml_literal_size;
+   /* the offsets of the element's literals in the literal buffers, the
+    * XML literal content starts after the element's start tag */
+   size_t plain_literal_start;
+   size_t xml_literal_start;
+   size_t xml_literal_content_start;
+   /* set once the element has a plain literal, which may be empty */
+   unsigned char plain_literal_present;
 
    void* callback_data;
 
    /* parse state */
    size_t bnode_count;
-   char* underscore_colon_bnode_name;
+   /* the number of the bnode that _: refers to, or RDFA_NO_BNODE */
+   size_t underscore_colon_bnode;
+   /* the number of the bnode that the last resource or CURIE list token
+    * resolved to, or RDFA_NO_BNODE, see rdfa_resolve_resource_view() */
+   size_t resolved_bnode;
    unsigned char xml_literal_namespaces_defined;
    unsigned char xml_literal_xml_lang_defined;
+   /* set if the element or one of its open ancestors has @property, the
+    * plain and XML literals are only built when they can be used */
+   unsigned char capture_literals;
+   /* the closest open element, which may be this one, that passes its
+    * property value to the literal chunk handler, and the one outside
+    * of that element */
+   struct rdfacontext* streaming_context;
+   struct rdfacontext* outer_streaming_context;
    size_t wb_allocated;
    char* working_buffer;
    size_t wb_position;
@@ -267,6 +573,65 @@ typedef struct rdfacontext
    size_t wb_preread;
    int preread;
    int depth;
+
+   /* scoped mapping state - element contexts share the URI and term
+    * mappings of the root context and remember the values they replaced
+    * so that they can be restored when the element ends */
+   unsigned char shares_mappings;
+#ifndef LIBRDFA_IN_RAPTOR
+   rdfamapping* uri_mappings_undo;
+#endif
+   unsigned char default_vocabulary_changed;
+   char* default_vocabulary_undo;
+
+#ifndef LIBRDFA_IN_RAPTOR
+   /* the closest context, which may be this one, that changed the URI
+    * mappings - it caches the xmlns declarations of its mappings, as
+    * they are written into XML literals, and the length of its longest
+    * prefix */
+   struct rdfacontext* prefix_scope;
+   char* xmlns_preamble;
+   size_t xmlns_preamble_length;
+   size_t xmlns_max_prefix_length;
+#endif
+
+   /* the CURIE cache of the parse, which is owned by the root context,
+    * and the version of the URI mappings and the default vocabulary that
+    * are in scope for this context */
+   rdfacuriecache* curie_cache;
+   unsigned long mapping_version;
+
+   /* the CURIE cache that is shared with other parses, if any, and the
+    * fingerprint of the mappings that are in scope for this context,
+    * which is only kept up to date when there is a shared cache */
+   rdfasharedcuriecache* shared_curie_cache;
+   rdfafingerprint mapping_fingerprint;
+
+   /* the namespaces of the compact triples of the parse, which are owned
+    * by the root context, the id of a namespace is its position in the
+    * mapping plus one */
+   rdfamapping* namespaces;
+
+   /* element contexts that have ended are kept in a pool on the root
+    * context, linked through next_pooled_context, so that they and their
+    * list storage can be re-used by the next element */
+   struct rdfacontext* context_pool;
+   struct rdfacontext* next_pooled_context;
+
+   /* element-scoped memory - the root context owns the arena, every
+    * element context marks the arena when it starts and the arena is
+    * rewound to that mark when the element ends */
+   rdfaarena* arena;
+   rdfaarenamark arena_mark;
+
+   /* the plain and XML literals of the open elements that capture
+    * literals, only set on the root context */
+   rdfabuffer* plain_literal_buffer;
+   rdfabuffer* xml_literal_buffer;
+
+   /* the allocator used for all memory allocated while parsing, only
+    * set on the root context */
+   rdfaallocator allocator;
 } rdfacontext;
 
 /**
@@ -306,6 +671,99 @@ DLLEXPORT void rdfa_set_processor_graph_triple_handler(
 DLLEXPORT void rdfa_set_buffer_filler(
    rdfacontext* context, buffer_filler_fp bf);
 
+/**
+ * Sets the literal chunk handler for the application. When it is set,
+ * the RDFa 1.1 property values that are made up of the text of an
+ * element are passed to the handler in chunks as the text is parsed,
+ * instead of being passed to the default graph triple handler as
+ * complete triples. This keeps memory bounded for very large literals.
+ *
+ * @param context the base rdfa context for the application.
+ * @param lch the literal chunk handler function.
+ */
+DLLEXPORT void rdfa_set_literal_chunk_handler(
+   rdfacontext* context, literal_chunk_handler_fp lch);
+
+/**
+ * Sets the borrowed triple handler for the application. When it is set,
+ * the default graph triples are passed to it instead of to the default
+ * graph triple handler. The triples are not copied for the handler, so
+ * they are only valid during the call and must not be freed. The compact
+ * triple handler is used instead if it is set too.
+ *
+ * @param context the base rdfa context for the application.
+ * @param bth the borrowed triple handler function.
+ */
+DLLEXPORT void rdfa_set_borrowed_triple_handler(
+   rdfacontext* context, borrowed_triple_handler_fp bth);
+
+/**
+ * Sets the compact triple handler for the application. When it is set,
+ * the default graph triples are passed to it instead of to the default
+ * graph triple handler, with each IRI split after its last '#', '/' or
+ * ':' into the id of a namespace and a local name. The namespace handler
+ * is called once for each namespace, before the first triple that uses
+ * it. The handlers must be set before parsing starts.
+ *
+ * @param context the base rdfa context for the application.
+ * @param nh the namespace handler function, or NULL.
+ * @param cth the compact triple handler function.
+ */
+DLLEXPORT void rdfa_set_compact_triple_handler(rdfacontext* context,
+   namespace_handler_fp nh, compact_triple_handler_fp cth);
+
+/**
+ * Sets the allocator that is used for all of the memory that is allocated
+ * while parsing, including the triples that are passed to the triple
+ * handlers. The allocator must be set before parsing starts. The triples
+ * refer to the allocator in the context, so they must be freed before the
+ * context is freed. All three functions are required, the standard
+ * allocator is used if any of them is NULL.
+ *
+ * @param context the base rdfa context for the application.
+ * @param alloc_func the function that allocates memory.
+ * @param realloc_func the function that resizes allocated memory.
+ * @param free_func the function that frees allocated memory.
+ * @param user_data the data that is passed to each of the functions.
+ */
+DLLEXPORT void rdfa_set_allocator(
+   rdfacontext* context, memory_alloc_fp alloc_func,
+   memory_realloc_fp realloc_func, memory_free_fp free_func, void* user_data);
+
+/**
+ * Creates a CURIE cache that can be shared by many contexts, including
+ * contexts that parse in different threads. The cache keeps at most the
+ * given number of CURIEs, and its memory is allocated with the standard
+ * allocator.
+ *
+ * @param size the number of CURIEs to keep, rounded up to a power of two.
+ *
+ * @return the shared cache, or NULL if memory allocation failed.
+ */
+DLLEXPORT rdfasharedcuriecache* rdfa_create_shared_curie_cache(size_t size);
+
+/**
+ * Frees a shared CURIE cache. None of the contexts that use the cache may
+ * be parsing when it is freed.
+ *
+ * @param cache the shared cache to free.
+ */
+DLLEXPORT void rdfa_free_shared_curie_cache(rdfasharedcuriecache* cache);
+
+/**
+ * Sets the CURIE cache that is shared with other parses. CURIEs are
+ * looked up in the shared cache with a fingerprint of the prefix and term
+ * mappings and the default vocabulary, so parses with the same
+ * declarations re-use each other's work. Values that are resolved against
+ * the base IRI are not shared. The cache must be set before parsing
+ * starts and it is not used when librdfa is built into Raptor.
+ *
+ * @param context the base rdfa context for the application.
+ * @param cache the shared cache, or NULL to stop sharing.
+ */
+DLLEXPORT void rdfa_set_shared_curie_cache(
+   rdfacontext* context, rdfasharedcuriecache* cache);
+
 /**
  * Starts processing given the base rdfa context.
  *
@@ -0,0 +1,51 @@
+/**
+ * Copyright 2008-2011 Digital Bazaar, Inc.
+ *
+ * This file is part of librdfa.
+ *
+ * librdfa is Free Software, and can be licensed under any of the
+ * following three licenses:
+ *
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any
+ *      newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE-* at the top of this software distribution for more
+ * information regarding the details of each license.
+ *
+ * This file contains the hooks that the tests use to pick the kernels of
+ * the scan module. It isn't installed.
+ */
+#ifndef _RDFA_SCAN_H_
+#define _RDFA_SCAN_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* the kernels that the scan functions can use */
+#define RDFA_SCAN_KERNELS_SCALAR 0
+#define RDFA_SCAN_KERNELS_SSE2 1
+
+/**
+ * Sets the kernels that the scan functions use instead of the fastest
+ * ones that the library was compiled with. This isn't thread-safe and is
+ * meant for benchmarks and tests.
+ *
+ * @param kernels one of the RDFA_SCAN_KERNELS_* values.
+ *
+ * @return the kernels that were used before, or -1 if the given kernels
+ *         aren't supported, in which case they aren't changed.
+ */
+int rdfa_use_scan_kernels(int kernels);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
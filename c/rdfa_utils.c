@@ -29,16 +29,122 @@
 #include <stdio.h>
 #include "rdfa_utils.h"
 #include "rdfa.h"
-#include "strtok_r.h"
 
-#define RDFA_WHITESPACE_CHARACTERS " \a\b\t\n\v\f\r"
+/* the alignment of arena allocations and the size of an arena block
+ * header, rounded up to that alignment */
+#define RDFA_ARENA_ALIGNMENT (2 * sizeof(void*))
+#define RDFA_ARENA_HEADER_SIZE \
+   ((sizeof(rdfaarenablock) + RDFA_ARENA_ALIGNMENT - 1) & \
+      ~(RDFA_ARENA_ALIGNMENT - 1))
+
+/* the smallest number of entries that a mapping is created with */
+#define RDFA_MAPPING_MIN_ENTRIES 8
+
+/* the values of unused and deleted slots in a mapping's hash index */
+#define RDFA_MAPPING_SLOT_EMPTY 0
+#define RDFA_MAPPING_SLOT_DELETED ((size_t)-1)
+
+/* the allocator is tracked per thread so that parses on different threads
+ * can use different allocators */
+#if defined(_MSC_VER)
+#define RDFA_THREAD_LOCAL __declspec(thread)
+#else
+#define RDFA_THREAD_LOCAL __thread
+#endif
+
+/* the allocator that is in use, NULL for the standard allocator */
+static RDFA_THREAD_LOCAL const rdfaallocator* g_rdfa_allocator = NULL;
+
+const rdfaallocator* rdfa_use_allocator(const rdfaallocator* allocator)
+{
+   const rdfaallocator* rval = g_rdfa_allocator;
+
+   /* an allocator that is missing any of its callbacks can't be used */
+   if(allocator != NULL && (allocator->alloc_callback == NULL ||
+      allocator->realloc_callback == NULL || allocator->free_callback == NULL))
+   {
+      allocator = NULL;
+   }
+   g_rdfa_allocator = allocator;
+
+   return rval;
+}
+
+const rdfaallocator* rdfa_get_allocator(void)
+{
+   return g_rdfa_allocator;
+}
+
+void* rdfa_malloc(size_t size)
+{
+   const rdfaallocator* allocator = g_rdfa_allocator;
+
+   if(allocator == NULL)
+   {
+      return malloc(size);
+   }
+
+   return allocator->alloc_callback(size, allocator->callback_data);
+}
+
+void* rdfa_realloc(void* ptr, size_t size)
+{
+   const rdfaallocator* allocator = g_rdfa_allocator;
+
+   if(allocator == NULL)
+   {
+      return realloc(ptr, size);
+   }
+
+   return allocator->realloc_callback(ptr, size, allocator->callback_data);
+}
+
+char* rdfa_strdup(const char* str)
+{
+   size_t size = strlen(str) + 1;
+   char* rval = (char*)rdfa_malloc(size);
+
+   if(rval != NULL)
+   {
+      memcpy(rval, str, size);
+   }
+
+   return rval;
+}
+
+char* rdfa_strndup(const char* str, size_t length)
+{
+   char* rval = (char*)rdfa_malloc(length + 1);
+
+   if(rval != NULL)
+   {
+      memcpy(rval, str, length);
+      rval[length] = '\0';
+   }
+
+   return rval;
+}
+
+void rdfa_free(void* ptr)
+{
+   const rdfaallocator* allocator = g_rdfa_allocator;
+
+   if(allocator == NULL)
+   {
+      free(ptr);
+   }
+   else if(ptr != NULL)
+   {
+      allocator->free_callback(ptr, allocator->callback_data);
+   }
+}
 
 char* rdfa_join_string(const char* prefix, const char* suffix)
 {
    char* rval = NULL;
    size_t prefix_size = strlen(prefix);
    size_t suffix_size = strlen(suffix);
-   rval = (char*)malloc(prefix_size + suffix_size + 1);
+   rval = (char*)rdfa_malloc(prefix_size + suffix_size + 1);
 
    memcpy(rval, prefix, prefix_size);
    memcpy(rval+prefix_size, suffix, suffix_size + 1);
@@ -46,12 +152,86 @@ char* rdfa_join_string(const char* prefix, const char* suffix)
    return rval;
 }
 
+char* rdfa_n_join_string(const char* prefix, size_t prefix_size,
+   const char* suffix, size_t suffix_size)
+{
+   char* rval = (char*)rdfa_malloc(prefix_size + suffix_size + 1);
+
+   memcpy(rval, prefix, prefix_size);
+   memcpy(rval + prefix_size, suffix, suffix_size);
+   rval[prefix_size + suffix_size] = '\0';
+
+   return rval;
+}
+
+int rdfa_next_view_token(
+   rdfaview* rest, const char* delimiters, rdfaview* token)
+{
+   const char* ptr = rest->data;
+   const char* end = rest->data + rest->length;
+
+   /* skip the delimiters in front of the token */
+   while(ptr < end && strchr(delimiters, *ptr) != NULL)
+   {
+      ptr++;
+   }
+
+   if(ptr == end)
+   {
+      rest->data = end;
+      rest->length = 0;
+      return 0;
+   }
+
+   /* the token runs up to the next delimiter, which is consumed */
+   token->data = ptr;
+   while(ptr < end && strchr(delimiters, *ptr) == NULL)
+   {
+      ptr++;
+   }
+   token->length = ptr - token->data;
+   if(ptr < end)
+   {
+      ptr++;
+   }
+   rest->data = ptr;
+   rest->length = end - ptr;
+
+   return 1;
+}
+
+int rdfa_next_whitespace_token(rdfaview* rest, rdfaview* token)
+{
+   const char* end = rest->data + rest->length;
+   const char* ptr = rdfa_skip_whitespace(rest->data, end);
+
+   if(ptr == end)
+   {
+      rest->data = end;
+      rest->length = 0;
+      return 0;
+   }
+
+   /* the token runs up to the next whitespace, which is consumed */
+   token->data = ptr;
+   ptr = rdfa_find_whitespace(ptr, end);
+   token->length = ptr - token->data;
+   if(ptr < end)
+   {
+      ptr++;
+   }
+   rest->data = ptr;
+   rest->length = end - ptr;
+
+   return 1;
+}
+
 char* rdfa_n_append_string(
    char* old_string, size_t* string_size,
    const char* suffix, size_t suffix_size)
 {
    char* rval = NULL;
-   rval = (char*)realloc(old_string, *string_size + suffix_size + 1);
+   rval = (char*)rdfa_realloc(old_string, *string_size + suffix_size + 1);
    memcpy(rval + *string_size, suffix, suffix_size + 1);
    *string_size = *string_size + suffix_size;
    return rval;
@@ -64,72 +244,110 @@ char* rdfa_replace_string(char* old_string, const char* new_string)
    if(new_string != NULL)
    {
       /* free the memory associated with the old string */
-      free(old_string);
+      rdfa_free(old_string);
 
       /* copy the new string */
-      rval = strdup(new_string);
+      rval = rdfa_strdup(new_string);
    }
 
    return rval;
 }
 
-char* rdfa_canonicalize_string(const char* str)
+char* rdfa_replace_view(char* old_string, const rdfaview* new_view)
 {
-   char* rval = (char*)malloc(sizeof(char) * (strlen(str) + 2));
-   char* working_string = NULL;
-   char* token = NULL;
-   char* wptr = NULL;
-   char* offset = rval;
-
-   working_string = rdfa_replace_string(working_string, str);
+   char* rval = NULL;
 
-   /* split on any whitespace character that we may find */
-   token = strtok_r(working_string, RDFA_WHITESPACE_CHARACTERS, &wptr);
-   while(token != NULL)
+   if(new_view->data != NULL)
    {
-      size_t token_length = strlen(token);
-      memcpy(offset, token, token_length);
-      offset += token_length;
-      *offset++ = ' ';
-      *offset = '\0';
+      /* free the memory associated with the old string */
+      rdfa_free(old_string);
 
-      token = strtok_r(NULL, RDFA_WHITESPACE_CHARACTERS, &wptr);
+      /* copy the new string */
+      rval = rdfa_strndup(new_view->data, new_view->length);
    }
 
-   if(offset != rval)
-   {
-      offset--;
-      *offset = '\0';
-   }
+   return rval;
+}
 
-   free(working_string);
+char* rdfa_canonicalize_string(const char* str)
+{
+   size_t length = strlen(str);
+   char* rval = (char*)rdfa_malloc(sizeof(char) * (length + 1));
+
+   rdfa_collapse_whitespace(rval, str, length);
 
    return rval;
 }
 
 rdfalist* rdfa_create_list(size_t size)
 {
-   rdfalist* rval = (rdfalist*)malloc(sizeof(rdfalist));
+   rdfalist* rval = (rdfalist*)rdfa_malloc(sizeof(rdfalist));
 
    rval->max_items = size;
    rval->num_items = 0;
-   rval->items = (rdfalistitem**)malloc(
+   rval->items = (rdfalistitem**)rdfa_malloc(
       sizeof(rdfalistitem*) * rval->max_items);
 
    return rval;
 }
 
+/**
+ * Appends a deep copy of every item in a list to another list.
+ *
+ * @param list the list to append the items to.
+ * @param items the list to copy the items from.
+ */
+static void rdfa_copy_list_items(rdfalist* list, rdfalist* items)
+{
+   unsigned int i;
+
+   /* copy the data of every list member along with all of the flags
+    * for each list member. */
+   for(i = 0; i < items->num_items; i++)
+   {
+      void* data = NULL;
+
+      /* copy specific data type, text is copied by rdfa_add_item() */
+      if(items->items[i]->flags & RDFALIST_FLAG_TEXT)
+      {
+         data = items->items[i]->data;
+      }
+      else if(items->items[i]->flags & RDFALIST_FLAG_TRIPLE)
+      {
+         rdftriple* t = (rdftriple*)items->items[i]->data;
+         data = rdfa_create_triple(t->subject, t->predicate, t->object,
+            t->object_type, t->datatype, t->language);
+         rdfa_set_triple_bnodes(
+            (rdftriple*)data, t->subject_bnode, t->object_bnode);
+      }
+      else if(items->items[i]->flags & RDFALIST_FLAG_CONTEXT)
+      {
+         /* TODO: Implement the copy for context, if it is needed. */
+      }
+
+      rdfa_add_item(list, data, (liflag_t)items->items[i]->flags);
+   }
+}
+
 rdfalist* rdfa_replace_list(rdfalist* old_list, rdfalist* new_list)
 {
    rdfalist* rval = NULL;
 
    if(new_list != NULL)
    {
-      /* free the memory associated with the old list */
-      rdfa_free_list(old_list);
-
-      /* copy the new list */
-      rval = rdfa_copy_list(new_list);
+      if(old_list == NULL)
+      {
+         /* copy the new list */
+         rval = rdfa_copy_list(new_list);
+      }
+      else
+      {
+         /* re-use the memory associated with the old list */
+         rdfa_clear_list(old_list);
+         rdfa_copy_list_items(old_list, new_list);
+         old_list->user_data = new_list->user_data;
+         rval = old_list;
+      }
    }
 
    return rval;
@@ -141,45 +359,11 @@ rdfalist* rdfa_copy_list(rdfalist* list)
 
    if(list != NULL)
    {
-      unsigned int i;
       rval = rdfa_create_list(list->max_items);
 
       /* copy the base list variables over */
-      rval->num_items = list->num_items;
       rval->user_data = list->user_data;
-
-      /* copy the data of every list member along with all of the flags
-       * for each list member. */
-      for(i = 0; i < list->max_items; i++)
-      {
-         if(i < list->num_items)
-         {
-            rval->items[i] = (rdfalistitem*)malloc(sizeof(rdfalistitem));
-            rval->items[i]->data = NULL;
-            rval->items[i]->flags = list->items[i]->flags;
-
-            /* copy specific data type */
-            if(list->items[i]->flags & RDFALIST_FLAG_TEXT)
-            {
-               rval->items[i]->data = strdup((char*)list->items[i]->data);
-            }
-            else if(list->items[i]->flags & RDFALIST_FLAG_TRIPLE)
-            {
-               rdftriple* t = (rdftriple*)list->items[i]->data;
-               rval->items[i]->data =
-                  rdfa_create_triple(t->subject, t->predicate, t->object,
-                     t->object_type, t->datatype, t->language);
-            }
-            else if(list->items[i]->flags & RDFALIST_FLAG_CONTEXT)
-            {
-               /* TODO: Implement the copy for context, if it is needed. */
-            }
-         }
-         else
-         {
-            rval->items[i] = NULL;
-         }
-      }
+      rdfa_copy_list_items(rval, list);
    }
 
    return rval;
@@ -230,28 +414,180 @@ void rdfa_print_triple_list(rdfalist* list)
    }
 }
 
+void rdfa_clear_list(rdfalist* list)
+{
+   unsigned int i;
+
+   for(i = 0; i < list->num_items; i++)
+   {
+      if(list->items[i]->flags & RDFALIST_FLAG_TEXT)
+      {
+         rdfa_free(list->items[i]->data);
+      }
+      else if(list->items[i]->flags & RDFALIST_FLAG_TRIPLE)
+      {
+         rdftriple* t = (rdftriple*)list->items[i]->data;
+         rdfa_free_triple(t);
+      }
+
+      rdfa_free(list->items[i]);
+      list->items[i] = NULL;
+   }
+
+   list->num_items = 0;
+}
+
 void rdfa_free_list(rdfalist* list)
 {
    if(list != NULL)
    {
-      unsigned int i;
-      for(i = 0; i < list->num_items; i++)
+      rdfa_clear_list(list);
+      rdfa_free(list->items);
+      rdfa_free(list);
+   }
+}
+
+/**
+ * Allocates a new, empty arena block.
+ *
+ * @param size the number of bytes that the block can hold.
+ *
+ * @return the new block.
+ */
+static rdfaarenablock* rdfa_create_arena_block(size_t size)
+{
+   rdfaarenablock* block =
+      (rdfaarenablock*)rdfa_malloc(RDFA_ARENA_HEADER_SIZE + size);
+
+   block->next = NULL;
+   block->size = size;
+   block->used = 0;
+
+   return block;
+}
+
+rdfaarena* rdfa_create_arena(size_t block_size)
+{
+   rdfaarena* arena = (rdfaarena*)rdfa_malloc(sizeof(rdfaarena));
+
+   arena->block_size = block_size;
+   arena->first = rdfa_create_arena_block(block_size);
+   arena->current = arena->first;
+
+   return arena;
+}
+
+void* rdfa_arena_alloc(rdfaarena* arena, size_t size)
+{
+   rdfaarenablock* block = arena->current;
+   void* rval;
+
+   size = (size + RDFA_ARENA_ALIGNMENT - 1) & ~(RDFA_ARENA_ALIGNMENT - 1);
+
+   /* move on to the next block if the allocation doesn't fit, the blocks
+    * after the current block are unused */
+   while(block->used + size > block->size)
+   {
+      if(block->next == NULL || block->next->size < size)
       {
-         if(list->items[i]->flags & RDFALIST_FLAG_TEXT)
-         {
-            free(list->items[i]->data);
-         }
-         else if(list->items[i]->flags & RDFALIST_FLAG_TRIPLE)
-         {
-            rdftriple* t = (rdftriple*)list->items[i]->data;
-            rdfa_free_triple(t);
-         }
+         rdfaarenablock* new_block = rdfa_create_arena_block(
+            (size > arena->block_size) ? size : arena->block_size);
+         new_block->next = block->next;
+         block->next = new_block;
+      }
+
+      block = block->next;
+      block->used = 0;
+   }
+
+   rval = (char*)block + RDFA_ARENA_HEADER_SIZE + block->used;
+   block->used += size;
+   arena->current = block;
+
+   return rval;
+}
+
+char* rdfa_arena_strndup(rdfaarena* arena, const char* str, size_t length)
+{
+   char* rval = (char*)rdfa_arena_alloc(arena, length + 1);
 
-         free(list->items[i]);
+   memcpy(rval, str, length);
+   rval[length] = '\0';
+
+   return rval;
+}
+
+void rdfa_arena_mark(rdfaarena* arena, rdfaarenamark* mark)
+{
+   mark->block = arena->current;
+   mark->used = arena->current->used;
+}
+
+void rdfa_arena_rewind(rdfaarena* arena, const rdfaarenamark* mark)
+{
+   arena->current = mark->block;
+   arena->current->used = mark->used;
+}
+
+void rdfa_free_arena(rdfaarena* arena)
+{
+   if(arena != NULL)
+   {
+      rdfaarenablock* block = arena->first;
+
+      while(block != NULL)
+      {
+         rdfaarenablock* next = block->next;
+         rdfa_free(block);
+         block = next;
+      }
+
+      rdfa_free(arena);
+   }
+}
+
+rdfabuffer* rdfa_create_buffer(size_t size)
+{
+   rdfabuffer* buffer = (rdfabuffer*)rdfa_malloc(sizeof(rdfabuffer));
+
+   buffer->allocated = (size > 0) ? size : 1;
+   buffer->data = (char*)rdfa_malloc(buffer->allocated + 1);
+   buffer->data[0] = '\0';
+   buffer->length = 0;
+
+   return buffer;
+}
+
+void rdfa_buffer_append(rdfabuffer* buffer, const char* data, size_t length)
+{
+   if(buffer->length + length > buffer->allocated)
+   {
+      /* grow geometrically so that appending is amortized constant time */
+      while(buffer->length + length > buffer->allocated)
+      {
+         buffer->allocated *= 2;
       }
+      buffer->data =
+         (char*)rdfa_realloc(buffer->data, buffer->allocated + 1);
+   }
+
+   memcpy(buffer->data + buffer->length, data, length);
+   buffer->length += length;
+   buffer->data[buffer->length] = '\0';
+}
+
+void rdfa_buffer_truncate(rdfabuffer* buffer, size_t length)
+{
+   buffer->length = length;
+   buffer->data[length] = '\0';
+}
 
-      free(list->items);
-      free(list);
+void rdfa_free_buffer(rdfabuffer* buffer)
+{
+   if(buffer != NULL)
+   {
+      rdfa_free(buffer->data);
+      rdfa_free(buffer);
    }
 }
 
@@ -268,7 +604,7 @@ void* rdfa_pop_item(rdfalist* stack)
    {
       --stack->num_items;
       rval = stack->items[stack->num_items]->data;
-      free(stack->items[stack->num_items]);
+      rdfa_free(stack->items[stack->num_items]);
       stack->items[stack->num_items] = NULL;
    }
 
@@ -282,7 +618,7 @@ void rdfa_add_item(rdfalist* list, void* data, liflag_t flags)
    if(!list)
       return;
 
-   item = (rdfalistitem*)malloc(sizeof(rdfalistitem));
+   item = (rdfalistitem*)rdfa_malloc(sizeof(rdfalistitem));
 
    item->data = NULL;
 
@@ -301,7 +637,7 @@ void rdfa_add_item(rdfalist* list, void* data, liflag_t flags)
    if(list->num_items == list->max_items)
    {
       list->max_items = 1 + (list->max_items * 2);
-      list->items = (rdfalistitem**)realloc(
+      list->items = (rdfalistitem**)rdfa_realloc(
          list->items, sizeof(rdfalistitem*) * list->max_items);
    }
 
@@ -309,28 +645,206 @@ void rdfa_add_item(rdfalist* list, void* data, liflag_t flags)
    ++list->num_items;
 }
 
-void** rdfa_create_mapping(size_t elements)
+/**
+ * Calculates the FNV-1a hash of a mapping key.
+ *
+ * @param key the key to hash.
+ * @param key_length the length of the key.
+ *
+ * @return the hash of the key.
+ */
+static unsigned int rdfa_hash_mapping_key(const char* key, size_t key_length)
+{
+   unsigned int hash = 2166136261u;
+   const char* end = key + key_length;
+
+   while(key < end)
+   {
+      hash ^= (unsigned char)*key++;
+      hash *= 16777619u;
+   }
+
+   return hash;
+}
+
+/**
+ * Finds the slot in the hash index of a mapping that refers to the entry
+ * with the given key.
+ *
+ * @param mapping the mapping to search.
+ * @param key the key, which doesn't have to be NUL-terminated.
+ * @param key_length the length of the key.
+ * @param hash the hash of the key.
+ *
+ * @return the index slot for the key, or NULL if the key doesn't exist
+ *         in the mapping.
+ */
+static size_t* rdfa_find_mapping_slot(rdfamapping* mapping,
+   const char* key, size_t key_length, unsigned int hash)
+{
+   size_t mask;
+   size_t slot;
+
+   if(mapping->index == NULL)
+   {
+      return NULL;
+   }
+
+   mask = mapping->index_size - 1;
+   slot = hash & mask;
+   while(mapping->index[slot] != RDFA_MAPPING_SLOT_EMPTY)
+   {
+      if(mapping->index[slot] != RDFA_MAPPING_SLOT_DELETED)
+      {
+         rdfamappingentry* entry = &mapping->entries[mapping->index[slot] - 1];
+         if(entry->hash == hash &&
+            strncmp(entry->key, key, key_length) == 0 &&
+            entry->key[key_length] == '\0')
+         {
+            return &mapping->index[slot];
+         }
+      }
+      slot = (slot + 1) & mask;
+   }
+
+   return NULL;
+}
+
+/**
+ * Adds the entry at the given position to the hash index of a mapping.
+ *
+ * @param mapping the mapping to update.
+ * @param position the position of the entry in the mapping.
+ */
+static void rdfa_index_mapping_entry(rdfamapping* mapping, size_t position)
+{
+   size_t mask = mapping->index_size - 1;
+   size_t slot = mapping->entries[position].hash & mask;
+
+   while(mapping->index[slot] != RDFA_MAPPING_SLOT_EMPTY &&
+      mapping->index[slot] != RDFA_MAPPING_SLOT_DELETED)
+   {
+      slot = (slot + 1) & mask;
+   }
+
+   mapping->index[slot] = position + 1;
+}
+
+/**
+ * Makes room for one more entry at the end of a mapping. Deleted entries
+ * are compacted away and the mapping is grown when it is full. The hash
+ * index always has at least twice as many slots as there are entries so
+ * that searches stay short.
+ *
+ * @param mapping the mapping to update.
+ */
+static void rdfa_reserve_mapping_entry(rdfamapping* mapping)
+{
+   size_t i;
+   size_t num_live;
+
+   if(mapping->entries == NULL)
+   {
+      mapping->entries = (rdfamappingentry*)rdfa_malloc(
+         sizeof(rdfamappingentry) * mapping->max_entries);
+      mapping->index_size = 1;
+      while(mapping->index_size < mapping->max_entries * 2)
+      {
+         mapping->index_size *= 2;
+      }
+      mapping->index =
+         (size_t*)rdfa_malloc(sizeof(size_t) * mapping->index_size);
+      memset(mapping->index, 0, sizeof(size_t) * mapping->index_size);
+   }
+   else if(mapping->num_entries == mapping->max_entries)
+   {
+      /* only grow if compacting the deleted entries wouldn't free up at
+       * least half of the mapping */
+      if(mapping->num_deleted < mapping->num_entries / 2)
+      {
+         mapping->max_entries *= 2;
+         mapping->entries = (rdfamappingentry*)rdfa_realloc(mapping->entries,
+            sizeof(rdfamappingentry) * mapping->max_entries);
+         mapping->index_size *= 2;
+         rdfa_free(mapping->index);
+         mapping->index =
+            (size_t*)rdfa_malloc(sizeof(size_t) * mapping->index_size);
+      }
+
+      /* remove the deleted entries, preserving the order of the mapping */
+      num_live = 0;
+      for(i = 0; i < mapping->num_entries; i++)
+      {
+         if(mapping->entries[i].key != NULL)
+         {
+            mapping->entries[num_live++] = mapping->entries[i];
+         }
+      }
+      mapping->num_entries = num_live;
+      mapping->num_deleted = 0;
+
+      /* rebuild the hash index */
+      memset(mapping->index, 0, sizeof(size_t) * mapping->index_size);
+      for(i = 0; i < mapping->num_entries; i++)
+      {
+         rdfa_index_mapping_entry(mapping, i);
+      }
+   }
+}
+
+/**
+ * Adds a new key to the end of a mapping. The key must not already
+ * exist in the mapping.
+ *
+ * @param mapping the mapping to update.
+ * @param key the key, which doesn't have to be NUL-terminated.
+ * @param key_length the length of the key.
+ * @param hash the hash of the key.
+ *
+ * @return the new entry, with a NULL value.
+ */
+static rdfamappingentry* rdfa_add_mapping_entry(rdfamapping* mapping,
+   const char* key, size_t key_length, unsigned int hash)
+{
+   rdfamappingentry* entry;
+
+   rdfa_reserve_mapping_entry(mapping);
+   entry = &mapping->entries[mapping->num_entries];
+   entry->key = rdfa_strndup(key, key_length);
+   entry->value = NULL;
+   entry->hash = hash;
+   rdfa_index_mapping_entry(mapping, mapping->num_entries);
+   mapping->num_entries++;
+
+   return entry;
+}
+
+rdfamapping* rdfa_create_mapping(size_t elements)
 {
-   size_t mapping_size = sizeof(void*) * MAX_URI_MAPPINGS * 2;
-   void** mapping = (void**)malloc(mapping_size);
+   rdfamapping* mapping = (rdfamapping*)rdfa_malloc(sizeof(rdfamapping));
 
-   /* only initialize the mapping if it is not null. */
+   /* only initialize the mapping if it is not null. The entries and the
+    * hash index are allocated when the first key is added. */
    if(mapping != NULL)
    {
-      memset(mapping, 0, mapping_size);
+      mapping->entries = NULL;
+      mapping->num_entries = 0;
+      mapping->num_deleted = 0;
+      mapping->max_entries = (elements > RDFA_MAPPING_MIN_ENTRIES) ?
+         elements : RDFA_MAPPING_MIN_ENTRIES;
+      mapping->index = NULL;
+      mapping->index_size = 0;
    }
 
    return mapping;
 }
 
-void rdfa_create_list_mapping(
-   rdfacontext* context, void** mapping,
-   const char* subject, const char* key)
+void rdfa_create_list_mapping(rdfacontext* context, rdfamapping* mapping,
+   const char* subject, size_t subject_bnode, const char* key)
 {
    char* realkey = NULL;
    size_t str_size;
    rdfalist* value = NULL;
-   char* list_bnode;
    rdftriple* triple;
 
    /* Attempt to find the list mapping */
@@ -344,153 +858,243 @@ void rdfa_create_list_mapping(
 
       /* build the real key to use when updating the mapping */
       str_size = strlen(subject);
-      realkey = strdup(subject);
+      realkey = rdfa_strdup(subject);
       realkey = rdfa_n_append_string(realkey, &str_size, " ", 1);
       realkey = rdfa_n_append_string(realkey, &str_size, key, strlen(key));
       rdfa_update_mapping(mapping, realkey, value,
          (update_mapping_value_fp)rdfa_replace_list);
-      free(realkey);
+      rdfa_free(realkey);
       rdfa_free_list(value);
 
-      /* add the first item in the list as the bnode for the list */
-      list_bnode = rdfa_create_bnode(context);
-      triple = rdfa_create_triple(
-         list_bnode, list_bnode, list_bnode, RDF_TYPE_IRI, NULL, NULL);
+      /* add the first item in the list as the triple that links the
+       * subject to the bnode for the list */
+      triple = rdfa_create_resource_triple(subject, subject_bnode, key,
+         NULL, rdfa_create_bnode(context), RDF_TYPE_IRI, NULL, NULL);
       rdfa_append_to_list_mapping(mapping, subject, key, (void*)triple);
-      free(list_bnode);
    }
 }
 
 void rdfa_append_to_list_mapping(
-   void** mapping, const char* subject, const char* key, void* value)
+   rdfamapping* mapping, const char* subject, const char* key, void* value)
 {
    rdfalist* list = (rdfalist*)rdfa_get_list_mapping(mapping, subject, key);
    rdfa_add_item(list, value, RDFALIST_FLAG_TRIPLE);
 }
 
-void** rdfa_copy_mapping(
-   void** mapping, copy_mapping_value_fp copy_mapping_value)
+/**
+ * Appends a copy of every key and value in a mapping to another mapping
+ * that doesn't contain any of the keys.
+ *
+ * @param mapping the mapping to append the copies to.
+ * @param source the mapping to copy.
+ * @param copy_mapping_value the function used to copy each value.
+ */
+static void rdfa_copy_mapping_entries(rdfamapping* mapping,
+   rdfamapping* source, copy_mapping_value_fp copy_mapping_value)
 {
-   void** rval = (void**)calloc(MAX_URI_MAPPINGS * 2, sizeof(void*));
-   void** mptr = mapping;
-   void** rptr = rval;
+   size_t i;
 
    /* copy each element of the old mapping to the new mapping. */
-   while(*mptr != NULL)
+   for(i = 0; i < source->num_entries; i++)
    {
-      /* copy the key */
-      *rptr = rdfa_replace_string((char*)*rptr, (const char*)*mptr);
-      rptr++;
-      mptr++;
+      rdfamappingentry* entry = &source->entries[i];
 
-      /* copy the value */
-      *rptr = copy_mapping_value(*rptr, *mptr);
-      rptr++;
-      mptr++;
+      if(entry->key != NULL)
+      {
+         rdfamappingentry* copy = rdfa_add_mapping_entry(
+            mapping, entry->key, strlen(entry->key), entry->hash);
+         copy->value = copy_mapping_value(NULL, entry->value);
+      }
    }
+}
+
+rdfamapping* rdfa_copy_mapping(
+   rdfamapping* mapping, copy_mapping_value_fp copy_mapping_value)
+{
+   rdfamapping* rval =
+      rdfa_create_mapping(mapping->num_entries - mapping->num_deleted);
+
+   rdfa_copy_mapping_entries(rval, mapping, copy_mapping_value);
 
    return rval;
 }
 
-void rdfa_update_mapping(void** mapping, const char* key, const void* value,
-   update_mapping_value_fp update_mapping_value)
+rdfamapping* rdfa_replace_mapping(
+   rdfamapping* old_mapping, rdfamapping* new_mapping,
+   copy_mapping_value_fp copy_mapping_value,
+   free_mapping_value_fp free_value)
 {
-   int found = 0;
-   void** mptr = mapping;
+   rdfamapping* rval = NULL;
 
-   /* search the current mapping to see if the key exists in the mapping */
-   while(!found && (*mptr != NULL))
+   if(old_mapping == NULL)
    {
-      if(strcmp((char*)*mptr, key) == 0)
-      {
-         mptr++;
-         *mptr = update_mapping_value(*mptr, value);
-         found = 1;
-      }
-      else
-      {
-         mptr++;
-      }
-      mptr++;
+      rval = rdfa_copy_mapping(new_mapping, copy_mapping_value);
    }
+   else
+   {
+      /* re-use the memory associated with the old mapping */
+      rdfa_clear_mapping(old_mapping, free_value);
+      rdfa_copy_mapping_entries(old_mapping, new_mapping, copy_mapping_value);
+      rval = old_mapping;
+   }
+
+   return rval;
+}
+
+void rdfa_update_mapping(rdfamapping* mapping, const char* key,
+   const void* value, update_mapping_value_fp update_mapping_value)
+{
+   rdfaview view;
+
+   view.data = key;
+   view.length = strlen(key);
+
+   rdfa_update_mapping_view(mapping, view, value, update_mapping_value);
+}
 
-   /* if we made it through the entire URI mapping and the key was not
-    * found, create a new key-value pair. */
-   if(!found)
+const rdfamappingentry* rdfa_update_mapping_view(rdfamapping* mapping,
+   rdfaview key, const void* value,
+   update_mapping_value_fp update_mapping_value)
+{
+   unsigned int hash = rdfa_hash_mapping_key(key.data, key.length);
+   size_t* slot =
+      rdfa_find_mapping_slot(mapping, key.data, key.length, hash);
+   rdfamappingentry* entry;
+
+   /* if the key was not found, create a new key-value pair. */
+   if(slot != NULL)
    {
-     *mptr = rdfa_replace_string((char*)*mptr, key);
-      mptr++;
-      *mptr = update_mapping_value(*mptr, value);
+      entry = &mapping->entries[*slot - 1];
    }
+   else
+   {
+      entry = rdfa_add_mapping_entry(mapping, key.data, key.length, hash);
+   }
+
+   entry->value = update_mapping_value(entry->value, value);
+
+   return entry;
 }
 
-const void* rdfa_get_mapping(void** mapping, const char* key)
+const void* rdfa_get_mapping(rdfamapping* mapping, const char* key)
+{
+   rdfaview view;
+
+   view.data = key;
+   view.length = strlen(key);
+
+   return rdfa_get_mapping_view(mapping, view);
+}
+
+const void* rdfa_get_mapping_view(rdfamapping* mapping, rdfaview key)
 {
    const void* rval = NULL;
-   char** mptr = (char**)mapping;
+   size_t* slot = rdfa_find_mapping_slot(mapping, key.data, key.length,
+      rdfa_hash_mapping_key(key.data, key.length));
 
-   /* search the current mapping to see if the key exists in the mapping. */
-   while(*mptr != NULL)
+   if(slot != NULL)
    {
-      if(strcmp(*mptr, key) == 0)
-      {
-         mptr++;
-         rval = *mptr;
-      }
-      else
-      {
-         mptr++;
-      }
-      mptr++;
+      rval = mapping->entries[*slot - 1].value;
    }
 
    return rval;
 }
 
+int rdfa_has_mapping(rdfamapping* mapping, const char* key)
+{
+   rdfaview view;
+
+   view.data = key;
+   view.length = strlen(key);
+
+   return rdfa_has_mapping_view(mapping, view);
+}
+
+int rdfa_has_mapping_view(rdfamapping* mapping, rdfaview key)
+{
+   return rdfa_find_mapping_slot(mapping, key.data, key.length,
+      rdfa_hash_mapping_key(key.data, key.length)) != NULL;
+}
+
+void rdfa_delete_mapping(
+   rdfamapping* mapping, const char* key, free_mapping_value_fp free_value)
+{
+   size_t key_length = strlen(key);
+   size_t* slot = rdfa_find_mapping_slot(mapping, key, key_length,
+      rdfa_hash_mapping_key(key, key_length));
+
+   /* the entry is only marked as deleted so that the order of the mapping
+    * and any iteration that is in progress are preserved, deleted entries
+    * are compacted away when the mapping runs out of room */
+   if(slot != NULL)
+   {
+      rdfamappingentry* entry = &mapping->entries[*slot - 1];
+
+      rdfa_free(entry->key);
+      free_value(entry->value);
+      entry->key = NULL;
+      entry->value = NULL;
+      *slot = RDFA_MAPPING_SLOT_DELETED;
+      mapping->num_deleted++;
+   }
+}
+
 const void* rdfa_get_list_mapping(
-   void** mapping, const char* subject, const char* key)
+   rdfamapping* mapping, const char* subject, const char* key)
 {
    void* rval;
    char* realkey = NULL;
    size_t str_size = strlen(subject);
 
    /* generate the real list mapping key and retrieve it from the mapping */
-   realkey = strdup(subject);
+   realkey = rdfa_strdup(subject);
    realkey = rdfa_n_append_string(realkey, &str_size, " ", 1);
    realkey = rdfa_n_append_string(realkey, &str_size, key, strlen(key));
    rval = (void*)rdfa_get_mapping(mapping, realkey);
-   free(realkey);
+   rdfa_free(realkey);
 
    return (const void*)rval;
 }
 
-void rdfa_next_mapping(void** mapping, char** key, void** value)
+int rdfa_next_mapping(
+   rdfamapping* mapping, size_t* position, char** key, void** value)
 {
    *key = NULL;
    *value = NULL;
 
-   if(*mapping != NULL)
+   /* skip over any deleted entries */
+   while(*position < mapping->num_entries &&
+      mapping->entries[*position].key == NULL)
    {
-      *key = *(char**)mapping++;
-      *value = *mapping++;
+      (*position)++;
    }
+
+   if(*position < mapping->num_entries)
+   {
+      *key = mapping->entries[*position].key;
+      *value = mapping->entries[*position].value;
+      (*position)++;
+   }
+
+   return *key != NULL;
 }
 
-void rdfa_print_mapping(void** mapping, print_mapping_value_fp print_value)
+void rdfa_print_mapping(
+   rdfamapping* mapping, print_mapping_value_fp print_value)
 {
-   void** mptr = mapping;
+   size_t position = 0;
+   char* key;
+   void* value;
+   int more = rdfa_next_mapping(mapping, &position, &key, &value);
+
    printf("{\n");
-   while(*mptr != NULL)
+   while(more)
    {
-      char* key;
-      void* value;
-      key = (char*)*mptr++;
-      value = *mptr++;
-
       printf("   %s : ", key);
       print_value(value);
 
-      if(*mptr != NULL)
+      more = rdfa_next_mapping(mapping, &position, &key, &value);
+      if(more)
       {
          printf(",\n");
       }
@@ -507,22 +1111,38 @@ void rdfa_print_string(const char* str)
    printf("%s", str);
 }
 
-void rdfa_free_mapping(void** mapping, free_mapping_value_fp free_value)
+void rdfa_clear_mapping(
+   rdfamapping* mapping, free_mapping_value_fp free_value)
 {
-   void** mptr = mapping;
+   size_t i;
 
-   if(mapping != NULL)
+   /* free all of the keys and values in the mapping */
+   for(i = 0; i < mapping->num_entries; i++)
    {
-      /* free all of the memory in the mapping */
-      while(*mptr != NULL)
+      if(mapping->entries[i].key != NULL)
       {
-         free(*mptr);
-         mptr++;
-         free_value(*mptr);
-         mptr++;
+         rdfa_free(mapping->entries[i].key);
+         free_value(mapping->entries[i].value);
       }
+   }
+
+   mapping->num_entries = 0;
+   mapping->num_deleted = 0;
+   if(mapping->index != NULL)
+   {
+      memset(mapping->index, 0, sizeof(size_t) * mapping->index_size);
+   }
+}
 
-      free(mapping);
+void rdfa_free_mapping(rdfamapping* mapping, free_mapping_value_fp free_value)
+{
+   if(mapping != NULL)
+   {
+      /* free all of the memory in the mapping */
+      rdfa_clear_mapping(mapping, free_value);
+      rdfa_free(mapping->entries);
+      rdfa_free(mapping->index);
+      rdfa_free(mapping);
    }
 }
 
@@ -63,6 +63,8 @@ typedef enum
 typedef enum
 {
    RDFALIST_FLAG_NONE = 0,
+   /* the text is the name of the bnode that _: refers to */
+   RDFALIST_FLAG_UNDERSCORE_COLON_BNODE = (1 << 0),
    RDFALIST_FLAG_DIR_NONE = (1 << 1),
    RDFALIST_FLAG_DIR_FORWARD  = (1 << 2),
    RDFALIST_FLAG_DIR_REVERSE = (1 << 3),
@@ -79,8 +81,21 @@ typedef enum
 #define RDFA_PROCESSOR_WARNING "http://www.w3.org/ns/rdfa#Warning"
 #define RDFA_PROCESSOR_ERROR "http://www.w3.org/ns/rdfa#Error"
 
-/* key establishing a deleted mapping entry */
-#define RDFA_MAPPING_DELETED_KEY "<DELETED-KEY>"
+/* the prefix of the names of the bnodes that the parser creates, which
+ * are followed by the number of the bnode */
+#define RDFA_BNODE_PREFIX "_:bnode"
+#define RDFA_BNODE_PREFIX_LENGTH 7
+
+/* the size of a buffer that holds the name of any bnode that the parser
+ * creates, with room for every digit of its number and the NUL */
+#define RDFA_BNODE_NAME_SIZE \
+   (RDFA_BNODE_PREFIX_LENGTH + 3 * sizeof(size_t) + 1)
+
+/* checks if a resource of a context, such as the new subject, is set. A
+ * bnode that the parser created is kept as its number alone, without a
+ * name, until a string is needed. */
+#define RDFA_RESOURCE_IS_SET(iri, bnode) \
+   ((iri) != NULL || (bnode) != RDFA_NO_BNODE)
 
 /**
  * A function pointer that will be used to copy mapping values.
@@ -102,16 +117,83 @@ typedef void (*print_mapping_value_fp)(void*);
  */
 typedef void (*free_mapping_value_fp)(void*);
 
+/**
+ * Makes the given allocator the one that is used by the calling thread for
+ * all memory that librdfa allocates, until it is replaced again.
+ *
+ * @param allocator the allocator to use, or NULL to use the standard
+ *                  allocator. The standard allocator is also used if the
+ *                  allocator is missing any of its callbacks.
+ *
+ * @return the allocator that was in use before.
+ */
+const rdfaallocator* rdfa_use_allocator(const rdfaallocator* allocator);
+
+/**
+ * Gets the allocator that is used by the calling thread.
+ *
+ * @return the allocator that is in use, or NULL if the standard allocator
+ *         is in use.
+ */
+const rdfaallocator* rdfa_get_allocator(void);
+
+/**
+ * Allocates memory with the allocator that is in use.
+ *
+ * @param size the number of bytes to allocate.
+ *
+ * @return the allocated memory, or NULL if the allocation failed.
+ */
+void* rdfa_malloc(size_t size);
+
+/**
+ * Resizes memory with the allocator that is in use.
+ *
+ * @param ptr the memory to resize, which may be NULL.
+ * @param size the new number of bytes.
+ *
+ * @return the resized memory, or NULL if the allocation failed.
+ */
+void* rdfa_realloc(void* ptr, size_t size);
+
+/**
+ * Copies a string into memory that is allocated with the allocator that
+ * is in use.
+ *
+ * @param str the string to copy.
+ *
+ * @return the copy of the string, or NULL if the allocation failed.
+ */
+char* rdfa_strdup(const char* str);
+
+/**
+ * Copies the given number of characters of a string into memory that is
+ * allocated with the allocator that is in use, and NUL-terminates it.
+ *
+ * @param str the string to copy.
+ * @param length the number of characters to copy.
+ *
+ * @return the copy of the string, or NULL if the allocation failed.
+ */
+char* rdfa_strndup(const char* str, size_t length);
+
+/**
+ * Frees memory with the allocator that is in use.
+ *
+ * @param ptr the memory to free, which may be NULL.
+ */
+void rdfa_free(void* ptr);
+
 /**
  * Initializes a mapping given the number of elements the mapping is
- * expected to hold.
+ * expected to hold. The mapping grows if more elements are added.
  *
- * @param elements the maximum number of elements the mapping is
- *                 supposed to hold.
+ * @param elements the number of elements the mapping is expected to
+ *                 hold.
  *
- * @return an initialized void**, with all of the elements set to NULL.
+ * @return an initialized, empty mapping.
  */
-void** rdfa_create_mapping(size_t elements);
+rdfamapping* rdfa_create_mapping(size_t elements);
 
 /**
  * Adds a list to a mapping given a key to create. The result will be a
@@ -119,12 +201,13 @@ void** rdfa_create_mapping(size_t elements);
  *
  * @param context the current active context.
  * @param mapping the mapping to modify.
- * @param subject the current active subject.
+ * @param subject the name of the current active subject, which the list
+ *                is found by.
+ * @param subject_bnode the bnode number of the subject, or RDFA_NO_BNODE.
  * @param key the key to add to the mapping.
- * @param user_data the user-defined data to store with the list information.
  */
-void rdfa_create_list_mapping(
-   rdfacontext* context, void** mapping, const char* subject, const char* key);
+void rdfa_create_list_mapping(rdfacontext* context, rdfamapping* mapping,
+   const char* subject, size_t subject_bnode, const char* key);
 
 /**
  * Adds an item to the end of the list that is associated with the given
@@ -136,7 +219,7 @@ void rdfa_create_list_mapping(
  * @param value the value to append to the end of the list.
  */
 void rdfa_append_to_list_mapping(
-   void** mapping, const char* subject, const char* key, void* value);
+   rdfamapping* mapping, const char* subject, const char* key, void* value);
 
 /**
  * Gets the value for a given list mapping when presented with a subject
@@ -150,7 +233,7 @@ void rdfa_append_to_list_mapping(
  * @return value the value in the mapping for the given key.
  */
 const void* rdfa_get_list_mapping(
-   void** mapping, const char* subject, const char* key);
+   rdfamapping* mapping, const char* subject, const char* key);
 
 /**
  * Copies the entire contents of a mapping verbatim and returns a
@@ -162,8 +245,26 @@ const void* rdfa_get_list_mapping(
  *         allocated. You MUST free the returned mapping when you are
  *         done with it.
  */
-void** rdfa_copy_mapping(
-   void** mapping, copy_mapping_value_fp copy_mapping_value);
+rdfamapping* rdfa_copy_mapping(
+   rdfamapping* mapping, copy_mapping_value_fp copy_mapping_value);
+
+/**
+ * Replaces the contents of the old mapping with a copy of the contents
+ * of the new mapping. The memory used by the old mapping is re-used.
+ *
+ * @param old_mapping the mapping to replace, or NULL to create a new
+ *                    mapping.
+ * @param new_mapping the mapping to copy.
+ * @param copy_mapping_value the function used to copy each value.
+ * @param free_value the function to free the values of the old mapping.
+ *
+ * @return the replaced mapping. You MUST free the returned mapping when
+ *         you are done with it.
+ */
+rdfamapping* rdfa_replace_mapping(
+   rdfamapping* old_mapping, rdfamapping* new_mapping,
+   copy_mapping_value_fp copy_mapping_value,
+   free_mapping_value_fp free_value);
 
 /**
  * Updates the given mapping when presented with a key and a value. If
@@ -175,7 +276,7 @@ void** rdfa_copy_mapping(
  * @param replace_mapping_value a pointer to a function that will replace the
  *    old
  */
-void rdfa_update_mapping(void** mapping, const char* key, const void* value,
+void rdfa_update_mapping(rdfamapping* mapping, const char* key, const void* value,
    update_mapping_value_fp update_mapping_value);
 
 /**
@@ -187,19 +288,92 @@ void rdfa_update_mapping(void** mapping, const char* key, const void* value,
  *
  * @return value the value in the mapping for the given key.
  */
-const void* rdfa_get_mapping(void** mapping, const char* key);
+const void* rdfa_get_mapping(rdfamapping* mapping, const char* key);
+
+/**
+ * Checks to see if a key is contained in the given mapping, even if the
+ * value that is associated with the key is NULL.
+ *
+ * @param mapping the mapping to search.
+ * @param key the key.
+ *
+ * @return 1 if the key is in the mapping, 0 otherwise.
+ */
+int rdfa_has_mapping(rdfamapping* mapping, const char* key);
+
+/**
+ * Gets the value for a given mapping when presented with a key that is
+ * passed as a view. If the key doesn't exist in the mapping, NULL is
+ * returned.
+ *
+ * @param mapping the mapping to search.
+ * @param key the key.
+ *
+ * @return value the value in the mapping for the given key.
+ */
+const void* rdfa_get_mapping_view(rdfamapping* mapping, rdfaview key);
+
+/**
+ * Checks to see if a key that is passed as a view is contained in the
+ * given mapping, even if the value that is associated with the key is
+ * NULL.
+ *
+ * @param mapping the mapping to search.
+ * @param key the key.
+ *
+ * @return 1 if the key is in the mapping, 0 otherwise.
+ */
+int rdfa_has_mapping_view(rdfamapping* mapping, rdfaview key);
+
+/**
+ * Updates the given mapping when presented with a key that is passed as
+ * a view and a value. If the key doesn't exist in the mapping, it is
+ * created with a copy of the key.
+ *
+ * @param mapping the mapping to update.
+ * @param key the key.
+ * @param value the value, which is passed to update_mapping_value.
+ * @param update_mapping_value a pointer to a function that will replace
+ *                             the old value.
+ *
+ * @return the updated entry, which is valid until the mapping is
+ *         changed again.
+ */
+const rdfamappingentry* rdfa_update_mapping_view(rdfamapping* mapping,
+   rdfaview key, const void* value,
+   update_mapping_value_fp update_mapping_value);
 
 /**
- * Gets the current mapping for the given mapping and increments the
- * mapping to the next value in the chain. 
+ * Removes a key and its value from the given mapping. The order of the
+ * remaining keys in the mapping is preserved. Nothing happens if the key
+ * doesn't exist in the mapping.
  *
- * @param mapping the mapping to use and increment.
+ * @param mapping the mapping to update.
+ * @param key the key to remove.
+ * @param free_value the function to free the removed value.
+ */
+void rdfa_delete_mapping(
+   rdfamapping* mapping, const char* key, free_mapping_value_fp free_value);
+
+/**
+ * Gets the key and value at the given position in the mapping and
+ * advances the position to the next key in the mapping. Keys are
+ * returned in the order in which they were added to the mapping. It is
+ * safe to delete the key that was just returned while iterating.
+ *
+ * @param mapping the mapping to iterate over.
+ * @param position the iteration position, which must be 0 for the
+ *                 first call.
  * @param key the key that will be retrieved, NULL if the mapping is
  *            blank or you are at the end of the mapping.
  * @param value the value that is associated with the key. NULL if the
  *              mapping is blank or you are at the end of the mapping.
+ *
+ * @return 1 if a key was retrieved, 0 if you are at the end of the
+ *         mapping.
  */
-void rdfa_next_mapping(void** mapping, char** key, void** value);
+int rdfa_next_mapping(
+   rdfamapping* mapping, size_t* position, char** key, void** value);
 
 /**
  * Prints the mapping to the screen in a human-readable way.
@@ -207,7 +381,17 @@ void rdfa_next_mapping(void** mapping, char** key, void** value);
  * @param mapping the mapping to print to the screen.
  * @param print_value the function pointer to use to print the mapping values.
  */
-void rdfa_print_mapping(void** mapping, print_mapping_value_fp print_value);
+void rdfa_print_mapping(rdfamapping* mapping, print_mapping_value_fp print_value);
+
+/**
+ * Removes all of the keys and values from a mapping. The mapping keeps
+ * its memory so that it can be filled again.
+ *
+ * @param mapping the mapping to clear.
+ * @param free_value the function to free mapping values.
+ */
+void rdfa_clear_mapping(
+   rdfamapping* mapping, free_mapping_value_fp free_value);
 
 /**
  * Frees all memory associated with a mapping.
@@ -215,7 +399,7 @@ void rdfa_print_mapping(void** mapping, print_mapping_value_fp print_value);
  * @param mapping the mapping to free.
  * @param free_value the function to free mapping values.
  */
-void rdfa_free_mapping(void** mapping, free_mapping_value_fp free_value);
+void rdfa_free_mapping(rdfamapping* mapping, free_mapping_value_fp free_value);
 
 /**
  * Creates a list and initializes it to the given size.
@@ -235,11 +419,11 @@ rdfalist* rdfa_create_list(size_t size);
 rdfalist* rdfa_copy_list(rdfalist* list);
 
 /**
- * Replaced the old_list by free'ing the memory associated with it. A
- * copy is made of the new list and then returned.
+ * Replaces the contents of the old_list with a copy of the new list. The
+ * memory associated with the old list is re-used.
  *
- * @param old_list the list to replace. The memory associated with this list
- *                 is freed.
+ * @param old_list the list to replace, or NULL to create a new list. The
+ *                 items of this list are freed.
  * @param new_list the new list to copy in replacement of the old list. A
  *                 deep copy is performed on the new list.
  *
@@ -286,6 +470,14 @@ void* rdfa_pop_item(rdfalist* stack);
  */
 void rdfa_print_list(rdfalist* list);
 
+/**
+ * Removes all of the items from the given list. The list keeps its
+ * memory so that it can be filled again.
+ *
+ * @param list the list to clear.
+ */
+void rdfa_clear_list(rdfalist* list);
+
 /**
  * Frees all memory associated with the given list.
  *
@@ -293,6 +485,97 @@ void rdfa_print_list(rdfalist* list);
  */
 void rdfa_free_list(rdfalist* list);
 
+/**
+ * Creates an arena that allocates memory in blocks of the given size.
+ *
+ * @param block_size the size of each block of the arena. Allocations
+ *                   that are larger than this get a block of their own.
+ *
+ * @return the arena. You MUST free the arena with rdfa_free_arena().
+ */
+rdfaarena* rdfa_create_arena(size_t block_size);
+
+/**
+ * Allocates memory from an arena. The memory is released when the arena
+ * is rewound to a mark that was taken before the allocation, or when the
+ * arena is freed. It MUST NOT be passed to free().
+ *
+ * @param arena the arena to allocate from.
+ * @param size the number of bytes to allocate.
+ *
+ * @return a pointer to the allocated memory.
+ */
+void* rdfa_arena_alloc(rdfaarena* arena, size_t size);
+
+/**
+ * Copies a string of the given length into an arena and terminates it.
+ *
+ * @param arena the arena to allocate from.
+ * @param str the string to copy.
+ * @param length the number of characters of the string to copy.
+ *
+ * @return the copied string, allocated from the arena.
+ */
+char* rdfa_arena_strndup(rdfaarena* arena, const char* str, size_t length);
+
+/**
+ * Records the current position of an arena.
+ *
+ * @param arena the arena to mark.
+ * @param mark the mark to fill in.
+ */
+void rdfa_arena_mark(rdfaarena* arena, rdfaarenamark* mark);
+
+/**
+ * Rewinds an arena to a mark, which releases all of the memory that was
+ * allocated from the arena after the mark was taken.
+ *
+ * @param arena the arena to rewind.
+ * @param mark a mark that was taken with rdfa_arena_mark().
+ */
+void rdfa_arena_rewind(rdfaarena* arena, const rdfaarenamark* mark);
+
+/**
+ * Frees an arena and all of the memory that was allocated from it.
+ *
+ * @param arena the arena to free.
+ */
+void rdfa_free_arena(rdfaarena* arena);
+
+/**
+ * Creates an empty buffer.
+ *
+ * @param size the number of characters the buffer can initially hold.
+ *
+ * @return the buffer. You MUST free the buffer with rdfa_free_buffer().
+ */
+rdfabuffer* rdfa_create_buffer(size_t size);
+
+/**
+ * Appends characters to the end of a buffer, growing it if needed.
+ *
+ * @param buffer the buffer to append to.
+ * @param data the characters to append.
+ * @param length the number of characters to append.
+ */
+void rdfa_buffer_append(rdfabuffer* buffer, const char* data, size_t length);
+
+/**
+ * Shortens a buffer to the given length. The memory of the buffer is kept.
+ *
+ * @param buffer the buffer to shorten.
+ * @param length the new length, which must not be larger than the
+ *               current length.
+ */
+void rdfa_buffer_truncate(rdfabuffer* buffer, size_t length);
+
+/**
+ * Frees a buffer and its contents.
+ *
+ * @param buffer the buffer to free.
+ */
+void rdfa_free_buffer(rdfabuffer* buffer);
+
 /**
  * Replaces an old string with a new string, freeing the old memory
  * and allocating new memory for the new string.
@@ -305,6 +588,18 @@ void rdfa_free_list(rdfalist* list);
  */
 char* rdfa_replace_string(char* old_string, const char* new_string);
 
+/**
+ * Replaces an old string with a copy of a view in the same way as
+ * rdfa_replace_string(). A view without data is treated like a NULL
+ * string.
+ *
+ * @param old_string the old string to free and replace.
+ * @param new_view the view to copy to the old_string's location.
+ *
+ * @return a pointer to the newly allocated string.
+ */
+char* rdfa_replace_view(char* old_string, const rdfaview* new_view);
+
 /**
  * Appends a new string to the old string, expanding the old string's
  * memory area if needed. The old string's size must be provided and
@@ -333,6 +628,98 @@ char* rdfa_n_append_string(
  */
 char* rdfa_join_string(const char* prefix, const char* suffix);
 
+/**
+ * Joins two strings of known lengths together and returns a newly
+ * allocated string with both strings joined. Neither string has to be
+ * NUL-terminated.
+ *
+ * @param prefix the beginning part of the string.
+ * @param prefix_size the length of the beginning part.
+ * @param suffix the ending part of the string.
+ * @param suffix_size the length of the ending part.
+ *
+ * @return a pointer to the newly allocated string that has both
+ *         prefix and suffix in it.
+ */
+char* rdfa_n_join_string(const char* prefix, size_t prefix_size,
+   const char* suffix, size_t suffix_size);
+
+/**
+ * Gets the next token from a view in the same way as strtok_r(), but
+ * without modifying or copying the string. Delimiters in front of the
+ * token are skipped and the delimiter that ends the token is consumed.
+ *
+ * @param rest the rest of the string, which is updated to start after
+ *             the token.
+ * @param delimiters the characters that separate the tokens.
+ * @param token set to the token that was found.
+ *
+ * @return 1 if a token was found, 0 if the rest of the string only
+ *         contains delimiters.
+ */
+int rdfa_next_view_token(
+   rdfaview* rest, const char* delimiters, rdfaview* token);
+
+/**
+ * Gets the next token from a view that is separated by RDFA_WHITESPACE,
+ * in the same way as rdfa_next_view_token() but many characters at a
+ * time.
+ *
+ * @param rest the rest of the string, which is updated to start after
+ *             the token.
+ * @param token set to the token that was found.
+ *
+ * @return 1 if a token was found, 0 if the rest of the string only
+ *         contains whitespace.
+ */
+int rdfa_next_whitespace_token(rdfaview* rest, rdfaview* token);
+
+/**
+ * Finds the first RDFA_WHITESPACE character in a string.
+ *
+ * @param ptr the start of the string.
+ * @param end the end of the string.
+ *
+ * @return the first whitespace character, or end if there is none.
+ */
+const char* rdfa_find_whitespace(const char* ptr, const char* end);
+
+/**
+ * Finds the first character in a string that isn't RDFA_WHITESPACE.
+ *
+ * @param ptr the start of the string.
+ * @param end the end of the string.
+ *
+ * @return the first other character, or end if there is none.
+ */
+const char* rdfa_skip_whitespace(const char* ptr, const char* end);
+
+/**
+ * Collapses all whitespace in a string to single spaces and strips
+ * leading and trailing whitespace, as rdfa_canonicalize_string() does.
+ *
+ * @param dest the buffer to write the NUL-terminated result into, which
+ *             must hold length + 1 characters and may be src.
+ * @param src the string to collapse.
+ * @param length the length of the string.
+ *
+ * @return the length of the result.
+ */
+size_t rdfa_collapse_whitespace(char* dest, const char* src, size_t length);
+
+/**
+ * Finds the first occurrence of each of a number of strings in one pass
+ * over the data.
+ *
+ * @param data the data to search.
+ * @param length the length of the data.
+ * @param needles the non-empty, NUL-terminated strings to search for.
+ * @param num_needles the number of strings to search for.
+ * @param found set to the first occurrence of each string, or NULL.
+ */
+void rdfa_find_strings(const char* data, size_t length,
+   const char* const* needles, size_t num_needles, const char** found);
+
 /**
  * Prints a string to stdout. This function is used by the rdfa_print_mapping
  * function.
@@ -371,6 +758,38 @@ rdftriple* rdfa_create_triple(const char* subject, const char* predicate,
    const char* object, rdfresource_t object_type, const char* datatype,
    const char* language);
 
+/**
+ * Sets the bnode numbers of a triple, see rdftriple. The number of the
+ * object is only kept if the object is an IRI.
+ *
+ * @param triple the triple to set the numbers of.
+ * @param subject_bnode the bnode number of the subject, or RDFA_NO_BNODE.
+ * @param object_bnode the bnode number of the object, or RDFA_NO_BNODE.
+ */
+void rdfa_set_triple_bnodes(
+   rdftriple* triple, size_t subject_bnode, size_t object_bnode);
+
+/**
+ * Creates a triple whose subject or object may be a bnode that is only
+ * kept as its number, see rdfa_create_triple(). The names of numbered
+ * bnodes are written into the triple and their numbers are set.
+ *
+ * @param subject the subject for the triple, NULL for a numbered bnode.
+ * @param subject_bnode the bnode number of the subject, or RDFA_NO_BNODE.
+ * @param predicate the predicate for the triple.
+ * @param object the object for the triple, NULL for a numbered bnode.
+ * @param object_bnode the bnode number of the object, or RDFA_NO_BNODE.
+ * @param object_type the type of the object, which must be an rdfresource_t.
+ * @param datatype the datatype of the triple.
+ * @param language the language for the triple.
+ *
+ * @return a newly allocated triple, which MUST be freed.
+ */
+rdftriple* rdfa_create_resource_triple(const char* subject,
+   size_t subject_bnode, const char* predicate, const char* object,
+   size_t object_bnode, rdfresource_t object_type, const char* datatype,
+   const char* language);
+
 /**
  * Prints a triple in a human-readable fashion.
  *
@@ -390,6 +809,46 @@ void rdfa_print_triple_list(rdfalist* list);
  */
 void rdfa_free_triple(rdftriple* triple);
 
+/**
+ * Passes a triple in the default graph to the application, either to
+ * the default graph triple handler, to the borrowed triple handler or,
+ * split into namespaces and local names, to the compact triple handler.
+ *
+ * @param context the current processing context.
+ * @param triple the triple, which the application takes ownership of.
+ */
+void rdfa_emit_default_graph_triple(rdfacontext* context, rdftriple* triple);
+
+/**
+ * Passes a triple in the default graph to the application, see
+ * rdfa_emit_default_graph_triple(). The triple is only allocated if the
+ * application takes ownership of it.
+ *
+ * @param context the current processing context.
+ * @param subject the subject for the triple, NULL for a numbered bnode.
+ * @param subject_bnode the bnode number of the subject, or RDFA_NO_BNODE.
+ * @param predicate the predicate for the triple.
+ * @param object the object for the triple, NULL for a numbered bnode.
+ * @param object_bnode the bnode number of the object, or RDFA_NO_BNODE.
+ * @param object_type the type of the object, which must be an rdfresource_t.
+ * @param datatype the datatype of the triple.
+ * @param language the language for the triple.
+ */
+void rdfa_generate_default_graph_triple(rdfacontext* context,
+   const char* subject, size_t subject_bnode, const char* predicate,
+   const char* object, size_t object_bnode, rdfresource_t object_type,
+   const char* datatype, const char* language);
+
+/**
+ * Sets the base of a context and finds the parts of it that relative IRIs
+ * are resolved against, so that they don't have to be found again for
+ * every IRI.
+ *
+ * @param context the context to set the base of.
+ * @param base the new base, without a query or a fragment.
+ */
+void rdfa_update_base(rdfacontext* context, const char* base);
+
 /**
  * Resolves a given uri by appending it to the context's base parameter.
  *
@@ -401,6 +860,27 @@ void rdfa_free_triple(rdftriple* triple);
  */
 char* rdfa_resolve_uri(rdfacontext* context, const char* uri);
 
+/* the value that rdfa_resolve_uri_into() returns for an IRI that can't be
+ * resolved against the base */
+#define RDFA_UNRESOLVED_IRI ((size_t)-1)
+
+/**
+ * Resolves a uri against the context's base into a buffer that is owned
+ * by the caller. Nothing is written if the buffer is too small, the
+ * returned length is then the size that the buffer needs to have, less
+ * the NUL terminator.
+ *
+ * @param context the current processing context.
+ * @param uri the URI part to process.
+ * @param buffer the buffer to write the NUL-terminated IRI into.
+ * @param buffer_size the size of the buffer, which may be 0.
+ *
+ * @return the length of the IRI if it was written, a length that is at
+ *         least buffer_size if it wasn't, or RDFA_UNRESOLVED_IRI.
+ */
+size_t rdfa_resolve_uri_into(rdfacontext* context, rdfaview uri,
+   char* buffer, size_t buffer_size);
+
 /**
  * Resolves a given uri depending on whether or not it is a fully
  * qualified IRI or a CURIE.
@@ -429,16 +909,276 @@ char* rdfa_resolve_curie(
 rdfalist* rdfa_resolve_curie_list(
    rdfacontext* rdfa_context, const char* uris, curieparse_t mode);
 
+/**
+ * Resolves a given uri that is passed as a view depending on whether or
+ * not it is a fully qualified IRI or a CURIE.
+ *
+ * @param context the current processing context.
+ * @param uri the URI part to process.
+ * @param mode the CURIE processing mode to use when parsing the CURIE.
+ *
+ * @return the fully qualified IRI. The memory returned from this
+ *         function MUST be freed.
+ */
+char* rdfa_resolve_curie_view(
+   rdfacontext* context, rdfaview uri, curieparse_t mode);
+
+/**
+ * Resolves the value of an attribute that carries a resource, see
+ * rdfa_resolve_curie_view(), and gets the number of the bnode that it
+ * refers to if it is _:, the only bnode that the parser creates for a
+ * resource that the document gives.
+ *
+ * @param context the current processing context.
+ * @param uri the URI part to process.
+ * @param mode the CURIE processing mode to use when parsing the CURIE.
+ * @param bnode set to the number of the bnode, or to RDFA_NO_BNODE.
+ *
+ * @return the fully qualified IRI, or NULL for _:, which is only kept as
+ *         its number. The memory returned from this function MUST be
+ *         freed.
+ */
+char* rdfa_resolve_resource_view(
+   rdfacontext* context, rdfaview uri, curieparse_t mode, size_t* bnode);
+
+/**
+ * Resolves one or more CURIEs that are passed as a view into fully
+ * qualified IRIs.
+ *
+ * @param rdfa_context the current processing context.
+ * @param uris a list of URIs.
+ * @param mode the CURIE parsing mode to use, one of
+ *             CURIE_PARSE_INSTANCEOF, CURIE_PARSE_RELREV, or
+ *             CURIE_PARSE_PROPERTY.
+ *
+ * @return an RDFa list if one or more IRIs were generated, NULL if not.
+ */
+rdfalist* rdfa_resolve_curie_list_view(
+   rdfacontext* rdfa_context, rdfaview uris, curieparse_t mode);
+
+/**
+ * Resolves one or more CURIEs that are passed as a view into fully
+ * qualified IRIs, allocating the list and the IRIs from an arena. IRIs
+ * that are in the CURIE cache are copied straight into the arena, so
+ * only the CURIEs that have to be resolved are allocated on the heap.
+ *
+ * @param rdfa_context the current processing context.
+ * @param uris a list of URIs.
+ * @param mode the CURIE parsing mode to use, one of
+ *             CURIE_PARSE_INSTANCEOF, CURIE_PARSE_RELREV, or
+ *             CURIE_PARSE_PROPERTY.
+ * @param arena the arena to allocate the list from.
+ *
+ * @return an RDFa list of the IRIs that were generated, which may be
+ *         empty. The list MUST NOT be freed or added to, it is released
+ *         when the arena is rewound.
+ */
+rdfalist* rdfa_resolve_curie_list_into(rdfacontext* rdfa_context,
+   rdfaview uris, curieparse_t mode, rdfaarena* arena);
+
 char* rdfa_resolve_relrev_curie(rdfacontext* context, const char* uri);
 
+/**
+ * Creates a CURIE cache.
+ *
+ * @param size the number of entries, which must be a power of two.
+ *
+ * @return the CURIE cache.
+ */
+rdfacuriecache* rdfa_create_curie_cache(size_t size);
+
+/**
+ * Removes all entries from a CURIE cache.
+ *
+ * @param cache the CURIE cache to clear.
+ */
+void rdfa_clear_curie_cache(rdfacuriecache* cache);
+
+/**
+ * Frees a CURIE cache and all of its entries.
+ *
+ * @param cache the CURIE cache to free.
+ */
+void rdfa_free_curie_cache(rdfacuriecache* cache);
+
+/**
+ * Gives the URI mappings and the default vocabulary of a context a new
+ * version, which must be done whenever the context changes them.
+ * CURIEs that were resolved with other versions aren't taken from the
+ * CURIE cache.
+ *
+ * @param context the context that changed its mappings.
+ */
+void rdfa_update_mapping_version(rdfacontext* context);
+
+/* the kinds of mappings that make up a mapping fingerprint */
+#define RDFA_FINGERPRINT_URI_MAPPING 'u'
+#define RDFA_FINGERPRINT_TERM_MAPPING 't'
+#define RDFA_FINGERPRINT_VOCABULARY 'v'
+
+/**
+ * Adds a mapping to, or removes a mapping from, the mapping fingerprint
+ * of a context. The fingerprint is only kept when the context has a
+ * shared CURIE cache.
+ *
+ * @param context the context whose mappings changed.
+ * @param type the kind of mapping, one of the RDFA_FINGERPRINT_* values.
+ * @param key the key of the mapping.
+ * @param key_length the length of the key.
+ * @param value the value of the mapping, NULL if it has no value.
+ * @param add 1 to add the mapping, 0 to remove it.
+ */
+void rdfa_update_mapping_fingerprint(rdfacontext* context, int type,
+   const char* key, size_t key_length, const char* value, int add);
+
+/**
+ * Computes the mapping fingerprint of a context from all of the URI and
+ * term mappings and the default vocabulary of the context.
+ *
+ * @param context the context to compute the fingerprint for.
+ */
+void rdfa_init_mapping_fingerprint(rdfacontext* context);
+
 char* rdfa_resolve_property_curie(rdfacontext* context, const char* uri);
 
 void rdfa_update_language(rdfacontext* context, const char* lang);
 
-char* rdfa_create_bnode(rdfacontext* context);
+/**
+ * Creates a new bnode. Only its number is kept, the name of the bnode is
+ * written by rdfa_format_bnode() when a string is needed.
+ *
+ * @param context the RDFa context.
+ *
+ * @return the number of the new bnode.
+ */
+size_t rdfa_create_bnode(rdfacontext* context);
+
+/**
+ * Writes the name of a numbered bnode, without going through sprintf().
+ *
+ * @param bnode the number of the bnode.
+ * @param buffer the RDFA_BNODE_NAME_SIZE characters to write the name to.
+ *
+ * @return the buffer.
+ */
+char* rdfa_format_bnode(size_t bnode, char* buffer);
+
+/**
+ * Gets the string of a resource of a context, for the consumers that
+ * need one.
+ *
+ * @param iri the IRI of the resource, or NULL.
+ * @param bnode the number of the resource if it is a bnode that the
+ *              parser created, or RDFA_NO_BNODE.
+ * @param buffer the RDFA_BNODE_NAME_SIZE characters to write the name of
+ *               a numbered bnode to.
+ *
+ * @return the IRI, the name of the bnode in the buffer, or NULL if the
+ *         resource isn't set.
+ */
+const char* rdfa_resource_name(const char* iri, size_t bnode, char* buffer);
+
+/**
+ * Replaces a resource of a context with another one, which may not be
+ * set. A numbered bnode replaces the IRI with NULL.
+ *
+ * @param iri the IRI of the resource to replace, which is freed.
+ * @param bnode the bnode number of the resource to replace.
+ * @param new_iri the IRI of the new resource, which is copied, or NULL.
+ * @param new_bnode the bnode number of the new resource, or
+ *                  RDFA_NO_BNODE.
+ */
+void rdfa_replace_resource(char** iri, size_t* bnode,
+   const char* new_iri, size_t new_bnode);
 
 /* All functions that rdfa.c needs. */
 void rdfa_update_uri_mappings(rdfacontext* context, const char* attr, const char* value);
+
+/**
+ * Updates the uri mappings in the given context with a prefix and an IRI
+ * that are passed as views, such as the ones that are found in @prefix.
+ *
+ * @param context the current element context.
+ * @param prefix the prefix, a view without data for the default mapping.
+ * @param iri the IRI that the prefix maps to, a view without data if
+ *            there is none.
+ */
+void rdfa_update_uri_mappings_view(
+   rdfacontext* context, rdfaview prefix, rdfaview iri);
+
+/**
+ * Sets the default vocabulary for the given context. If the context
+ * belongs to an element, the vocabulary of the parent context is
+ * restored by rdfa_restore_mappings() once the element ends.
+ *
+ * @param context the current element context.
+ * @param vocab the new default vocabulary, or NULL to clear it.
+ */
+void rdfa_update_default_vocabulary(rdfacontext* context, const char* vocab);
+
+#ifndef LIBRDFA_IN_RAPTOR
+/**
+ * Gets the IRI that a prefix maps to, either in the URI mappings of the
+ * document or in the URI mappings of the initial context.
+ *
+ * @param context the current context.
+ * @param prefix the prefix to look up.
+ *
+ * @return the IRI, or NULL if the prefix isn't mapped.
+ */
+const char* rdfa_get_uri_mapping_view(rdfacontext* context, rdfaview prefix);
+
+/**
+ * Checks if a prefix is mapped, either in the URI mappings of the
+ * document or in the URI mappings of the initial context.
+ *
+ * @param context the current context.
+ * @param prefix the NUL-terminated prefix to look up.
+ *
+ * @return 1 if the prefix is mapped, 0 otherwise.
+ */
+int rdfa_has_uri_mapping(rdfacontext* context, const char* prefix);
+
+/**
+ * Gets the next prefix that is mapped in a context. The prefixes of the
+ * initial context come first, with the IRIs that the document gave them,
+ * followed by the other prefixes that the document declared, in the order
+ * in which they were declared.
+ *
+ * @param context the current context.
+ * @param position the position in the mappings, which must start at 0.
+ * @param key set to the next prefix.
+ * @param value set to the IRI of the next prefix.
+ *
+ * @return 1 if there was a next prefix, 0 otherwise.
+ */
+int rdfa_next_uri_mapping(
+   rdfacontext* context, size_t* position, char** key, void** value);
+
+/**
+ * Gets the xmlns declarations of all URI mappings, as they are written
+ * into the start tag of an element in an XML literal. The declarations
+ * are serialized once for every prefix scope and then re-used.
+ *
+ * @param context the current element context.
+ * @param attributes the attributes of the element.
+ * @param length set to the length of the declarations.
+ *
+ * @return the declarations, which are owned by the prefix scope, or NULL
+ *         if some of them must be left out for the element's attributes.
+ */
+const char* rdfa_get_xmlns_preamble(
+   rdfacontext* context, const char** attributes, size_t* length);
+#endif
+
+/**
+ * Undoes every change that the element for the given context made to the
+ * shared URI mappings and to the default vocabulary.
+ *
+ * @param context the element context that is ending.
+ */
+void rdfa_restore_mappings(rdfacontext* context);
+
 void rdfa_establish_new_1_0_subject(
    rdfacontext* context, const char* name, const char* about, const char* src,
    const char* resource, const char* href, const rdfalist* type_of);
@@ -463,6 +1203,29 @@ void rdfa_save_incomplete_triples(
 void rdfa_complete_object_literal_triples(rdfacontext* context);
 void rdfa_complete_current_property_value_triples(rdfacontext* context);
 
+/**
+ * Checks whether the current property value of an element can be passed
+ * to the literal chunk handler while the element's text is parsed, rather
+ * than being built up and generated as a triple when the element ends.
+ *
+ * @param context the element context, after its attributes are processed.
+ *
+ * @return 1 if the current property value can be streamed, 0 otherwise.
+ */
+int rdfa_can_stream_current_property_value(rdfacontext* context);
+
+/**
+ * Passes a chunk of the current property value of an element to the
+ * literal chunk handler, once for every predicate of the element.
+ *
+ * @param context the element context that streams its property value.
+ * @param chunk the next chunk of the value, or NULL once the value is
+ *              complete.
+ * @param chunk_length the number of characters in the chunk.
+ */
+void rdfa_stream_current_property_value(
+   rdfacontext* context, const char* chunk, size_t chunk_length);
+
 /* Declarations needed by namespace.c */
 void rdfa_generate_namespace_triple(
    rdfacontext* context, const char* prefix, const char* iri);
@@ -471,11 +1234,38 @@ void rdfa_processor_triples(
 
 /* Declarations needed by rdfa.c */
 void rdfa_setup_initial_context(rdfacontext* context);
+
+/**
+ * Gets the IRI that a term maps to, either in the terms of the initial
+ * contexts of the document or in the term mappings of the context. The
+ * initial terms are found without allocating memory.
+ *
+ * @param context the current context.
+ * @param term the term to look up.
+ * @param fold_case 1 if the initial terms should be matched without
+ *                  regard to case, as XHTML1 @rel and @rev values are.
+ *
+ * @return the IRI, or NULL if the term isn't mapped.
+ */
+const char* rdfa_get_term_mapping_view(
+   rdfacontext* context, rdfaview term, int fold_case);
 void rdfa_establish_new_inlist_triples(
    rdfacontext* context, rdfalist* predicates, const char* object,
-   rdfresource_t object_type);
+   size_t object_bnode, rdfresource_t object_type);
 void rdfa_complete_list_triples(rdfacontext* context);
 rdfacontext* rdfa_create_new_element_context(rdfalist* context_stack);
+
+/**
+ * Releases the context of an element that has ended. The context is
+ * cleared and put into the pool of the root context so that it can be
+ * re-used by rdfa_create_new_element_context().
+ *
+ * @param context_stack the context stack that is associated with this
+ *                      processing run.
+ * @param context the element context to release.
+ */
+void rdfa_release_element_context(
+   rdfalist* context_stack, rdfacontext* context);
 void rdfa_free_context_stack(rdfacontext* context);
 
 #ifdef __cplusplus
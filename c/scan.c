@@ -0,0 +1,343 @@
+/*
+ * Copyright 2008-2011 Digital Bazaar, Inc.
+ *
+ * This file is part of librdfa.
+ *
+ * librdfa is Free Software, and can be licensed under any of the
+ * following three licenses:
+ *
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any
+ *      newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE-* at the top of this software distribution for more
+ * information regarding the details of each license.
+ *
+ * The scan module finds characters in strings. Whitespace is found and
+ * collapsed one character at a time, which is fastest for the short
+ * attribute values and the text that RDFa documents have. The bytes that
+ * the head of a document is sniffed for are found with a scalar kernel
+ * that works everywhere or an SSE2 kernel.
+ */
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>
+#endif
+#include "rdfa_utils.h"
+#include "rdfa_scan.h"
+#include "rdfa.h"
+
+#if defined(__SSE2__) && defined(HAVE_EMMINTRIN_H)
+#  define RDFA_SCAN_SSE2
+#  include <emmintrin.h>
+#endif
+
+/* the most different bytes that the SSE2 kernel searches for at once,
+ * more bytes than this are searched for by the scalar kernel */
+#define RDFA_SCAN_MAX_BYTES 8
+
+/* the whitespace of RDFa attributes starts at '\t', the whitespace that
+ * rdfa_canonicalize_string() has always collapsed also has '\a' and '\b' */
+#define RDFA_SCAN_ATTRIBUTE_CONTROLS '\t'
+#define RDFA_SCAN_CANONICAL_CONTROLS '\a'
+
+/**
+ * The bytes that a kernel searches for. The kernel searches for them
+ * again after every byte that it finds, so anything that it needs to
+ * search for them is built only once.
+ */
+typedef struct rdfascanbytes
+{
+   const char* bytes;
+   size_t num_bytes;
+#ifdef RDFA_SCAN_SSE2
+   /* every byte repeated across a register */
+   __m128i needles[RDFA_SCAN_MAX_BYTES];
+#endif
+} rdfascanbytes;
+
+/**
+ * The scan kernels of one instruction set.
+ */
+typedef struct rdfascankernels
+{
+   /* finds the first character that is one of the given bytes */
+   const char* (*find_bytes)(const char* ptr, const char* end,
+      const rdfascanbytes* bytes);
+} rdfascankernels;
+
+/**
+ * Finds the first character that is whitespace, or that isn't, where
+ * whitespace is ' ' or a control character from first_control to '\r'.
+ */
+static const char* rdfa_find_class(const char* ptr, const char* end,
+   int first_control, int whitespace)
+{
+   while(ptr < end)
+   {
+      int c = (unsigned char)*ptr;
+
+      if((c == ' ' || (c >= first_control && c <= '\r')) == whitespace)
+      {
+         break;
+      }
+      ptr++;
+   }
+
+   return ptr;
+}
+
+static const char* rdfa_find_bytes_scalar(const char* ptr, const char* end,
+   const rdfascanbytes* bytes)
+{
+   while(ptr < end && memchr(bytes->bytes, *ptr, bytes->num_bytes) == NULL)
+   {
+      ptr++;
+   }
+
+   return ptr;
+}
+
+#ifdef RDFA_SCAN_SSE2
+/**
+ * Gets the index of the lowest bit that is set in a non-zero mask.
+ */
+static unsigned int rdfa_first_bit(unsigned int mask)
+{
+#ifdef __GNUC__
+   return (unsigned int)__builtin_ctz(mask);
+#else
+   unsigned int rval = 0;
+
+   while((mask & 1) == 0)
+   {
+      mask >>= 1;
+      rval++;
+   }
+
+   return rval;
+#endif
+}
+
+static const char* rdfa_find_bytes_sse2(const char* ptr, const char* end,
+   const rdfascanbytes* bytes)
+{
+   size_t i;
+
+   if(bytes->num_bytes > RDFA_SCAN_MAX_BYTES)
+   {
+      return rdfa_find_bytes_scalar(ptr, end, bytes);
+   }
+
+   while(end - ptr >= 16)
+   {
+      __m128i chunk = _mm_loadu_si128((const __m128i*)ptr);
+      __m128i matches = _mm_setzero_si128();
+      unsigned int mask;
+
+      for(i = 0; i < bytes->num_bytes; i++)
+      {
+         matches = _mm_or_si128(
+            matches, _mm_cmpeq_epi8(chunk, bytes->needles[i]));
+      }
+      mask = (unsigned int)_mm_movemask_epi8(matches);
+      if(mask != 0)
+      {
+         return ptr + rdfa_first_bit(mask);
+      }
+      ptr += 16;
+   }
+
+   return rdfa_find_bytes_scalar(ptr, end, bytes);
+}
+#endif
+
+/**
+ * The kernels of every instruction set, indexed by RDFA_SCAN_KERNELS_*.
+ * Instruction sets that the library wasn't compiled for have no kernels.
+ */
+static const rdfascankernels g_rdfa_scan_kernels[] =
+{
+   { &rdfa_find_bytes_scalar },
+#ifdef RDFA_SCAN_SSE2
+   { &rdfa_find_bytes_sse2 }
+#else
+   { NULL }
+#endif
+};
+
+/* the kernels are picked once, by the first thread that scans */
+static const rdfascankernels* g_rdfa_current_scan_kernels = NULL;
+#ifdef HAVE_PTHREAD_H
+static pthread_once_t g_rdfa_scan_kernels_once = PTHREAD_ONCE_INIT;
+#else
+static int g_rdfa_scan_kernels_picked = 0;
+#endif
+
+/**
+ * Checks if the library was compiled with the given kernels. The compiler
+ * only targets CPUs that have SSE2 if it was enabled, so every kernel that
+ * was compiled can run.
+ */
+static int rdfa_scan_kernels_supported(int kernels)
+{
+   return kernels >= RDFA_SCAN_KERNELS_SCALAR &&
+      kernels <= RDFA_SCAN_KERNELS_SSE2 &&
+      g_rdfa_scan_kernels[kernels].find_bytes != NULL;
+}
+
+/**
+ * Picks the fastest kernels that the library was compiled with.
+ */
+static void rdfa_pick_scan_kernels(void)
+{
+   int kernels = RDFA_SCAN_KERNELS_SSE2;
+
+   while(!rdfa_scan_kernels_supported(kernels))
+   {
+      kernels--;
+   }
+   g_rdfa_current_scan_kernels = &g_rdfa_scan_kernels[kernels];
+}
+
+/**
+ * Gets the kernels to scan with, picking them if they haven't been
+ * picked yet.
+ */
+static const rdfascankernels* rdfa_get_scan_kernels(void)
+{
+#ifdef HAVE_PTHREAD_H
+   pthread_once(&g_rdfa_scan_kernels_once, &rdfa_pick_scan_kernels);
+#else
+   if(!g_rdfa_scan_kernels_picked)
+   {
+      rdfa_pick_scan_kernels();
+      g_rdfa_scan_kernels_picked = 1;
+   }
+#endif
+
+   return g_rdfa_current_scan_kernels;
+}
+
+int rdfa_use_scan_kernels(int kernels)
+{
+   int rval = (int)(rdfa_get_scan_kernels() - g_rdfa_scan_kernels);
+
+   if(!rdfa_scan_kernels_supported(kernels))
+   {
+      return -1;
+   }
+   g_rdfa_current_scan_kernels = &g_rdfa_scan_kernels[kernels];
+
+   return rval;
+}
+
+const char* rdfa_find_whitespace(const char* ptr, const char* end)
+{
+   return rdfa_find_class(ptr, end, RDFA_SCAN_ATTRIBUTE_CONTROLS, 1);
+}
+
+const char* rdfa_skip_whitespace(const char* ptr, const char* end)
+{
+   return rdfa_find_class(ptr, end, RDFA_SCAN_ATTRIBUTE_CONTROLS, 0);
+}
+
+size_t rdfa_collapse_whitespace(char* dest, const char* src, size_t length)
+{
+   const char* end = src + length;
+   char* dptr = dest;
+   /* set if whitespace was skipped after a word, so a space is written
+    * before the next word */
+   int space = 0;
+
+   for(; src < end; src++)
+   {
+      int c = (unsigned char)*src;
+
+      if(c == ' ' || (c >= RDFA_SCAN_CANONICAL_CONTROLS && c <= '\r'))
+      {
+         space = (dptr != dest);
+      }
+      else
+      {
+         if(space)
+         {
+            *dptr++ = ' ';
+            space = 0;
+         }
+         *dptr++ = *src;
+      }
+   }
+   *dptr = '\0';
+
+   return dptr - dest;
+}
+
+void rdfa_find_strings(const char* data, size_t length,
+   const char* const* needles, size_t num_needles, const char** found)
+{
+   const rdfascankernels* kernels = rdfa_get_scan_kernels();
+   const char* end = data + length;
+   char first_bytes[256];
+   rdfascanbytes bytes;
+   size_t remaining = num_needles;
+   size_t i;
+
+   /* the first bytes of the needles are searched for, then the needles
+    * that start with the byte that was found are compared */
+   bytes.bytes = first_bytes;
+   bytes.num_bytes = 0;
+   for(i = 0; i < num_needles; i++)
+   {
+      found[i] = NULL;
+      if(memchr(first_bytes, needles[i][0], bytes.num_bytes) == NULL)
+      {
+         first_bytes[bytes.num_bytes++] = needles[i][0];
+      }
+   }
+#ifdef RDFA_SCAN_SSE2
+   for(i = 0; i < bytes.num_bytes && i < RDFA_SCAN_MAX_BYTES; i++)
+   {
+      bytes.needles[i] = _mm_set1_epi8(first_bytes[i]);
+   }
+#endif
+
+   while(remaining > 0)
+   {
+      data = kernels->find_bytes(data, end, &bytes);
+      if(data == end)
+      {
+         break;
+      }
+
+      for(i = 0; i < num_needles; i++)
+      {
+         const char* needle = needles[i];
+         const char* ptr = data;
+
+         if(found[i] != NULL)
+         {
+            continue;
+         }
+         while(*needle != '\0' && ptr < end && *ptr == *needle)
+         {
+            needle++;
+            ptr++;
+         }
+         if(*needle == '\0')
+         {
+            found[i] = data;
+            remaining--;
+         }
+      }
+      data++;
+   }
+}
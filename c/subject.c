@@ -29,30 +29,63 @@
 #include "rdfa_utils.h"
 #include "rdfa.h"
 
-/**
- * Creates a new bnode given an RDFa context.
- *
- * @param context the RDFa context.
- *
- * @return a newly allocated string containing the bnode name. This
- *         string MUST be memory collected.
- */
-char* rdfa_create_bnode(rdfacontext* context)
+size_t rdfa_create_bnode(rdfacontext* context)
 {
-   char* rval = NULL;
-   char buffer[64];
-   
-   /* print and increment the bnode count */
-   sprintf(buffer, "_:bnode%i", (int)context->bnode_count++);
-   rval = rdfa_replace_string(rval, buffer);
+   return context->bnode_count++;
+}
+
+char* rdfa_format_bnode(size_t bnode, char* buffer)
+{
+   char digits[3 * sizeof(size_t)];
+   char* dptr = digits + sizeof(digits);
+   size_t length;
+
+   /* the digits are written backwards from the end of the buffer */
+   do
+   {
+      *--dptr = (char)('0' + (bnode % 10));
+      bnode /= 10;
+   }
+   while(bnode != 0);
+
+   length = (digits + sizeof(digits)) - dptr;
+   memcpy(buffer, RDFA_BNODE_PREFIX, RDFA_BNODE_PREFIX_LENGTH);
+   memcpy(buffer + RDFA_BNODE_PREFIX_LENGTH, dptr, length);
+   buffer[RDFA_BNODE_PREFIX_LENGTH + length] = '\0';
 
-   return rval;
+   return buffer;
+}
+
+const char* rdfa_resource_name(const char* iri, size_t bnode, char* buffer)
+{
+   if(bnode != RDFA_NO_BNODE)
+   {
+      return rdfa_format_bnode(bnode, buffer);
+   }
+
+   return iri;
+}
+
+void rdfa_replace_resource(char** iri, size_t* bnode,
+   const char* new_iri, size_t new_bnode)
+{
+   rdfa_free(*iri);
+   *iri = NULL;
+   *bnode = new_bnode;
+
+   /* a numbered bnode doesn't have a name until a string is needed */
+   if(new_bnode == RDFA_NO_BNODE && new_iri != NULL)
+   {
+      *iri = rdfa_strdup(new_iri);
+   }
 }
 
 /**
  * Establishes a new subject for the given context given the
  * attributes on the current element. The given context's new_subject
- * value is updated if a new subject is found.
+ * value is updated if a new subject is found. The bnode numbers of the
+ * attributes are taken from the context, an attribute that is _: is NULL
+ * and only has a number.
  *
  * @param context the RDFa context.
  * @param name the name of the current element that is being processed.
@@ -73,50 +106,51 @@ void rdfa_establish_new_1_0_subject(
     * [new subject]. Any of the attributes that can carry a
     * resource can set [new subject]; */
 
-   if(about != NULL)
+   if(RDFA_RESOURCE_IS_SET(about, context->about_bnode))
    {
       /* * by using the URI from @about, if present, obtained according
        *   to the section on CURIE and URI Processing; */
-      context->new_subject =
-         rdfa_replace_string(context->new_subject, about);
+      rdfa_replace_resource(&context->new_subject,
+         &context->new_subject_bnode, about, context->about_bnode);
    }
-   else if(src != NULL)
+   else if(RDFA_RESOURCE_IS_SET(src, context->src_bnode))
    {   
       /* * otherwise, by using the URI from @src, if present, obtained
        *   according to the section on CURIE and URI Processing. */
-      context->new_subject =
-         rdfa_replace_string(context->new_subject, src);
+      rdfa_replace_resource(&context->new_subject,
+         &context->new_subject_bnode, src, context->src_bnode);
    }
-   else if(resource != NULL)
+   else if(RDFA_RESOURCE_IS_SET(resource, context->resource_bnode))
    {   
       /* * otherwise, by using the URI from @resource, if present,
        *   obtained according to the section on CURIE and URI
        *   Processing; */
-      context->new_subject =
-         rdfa_replace_string(context->new_subject, resource);
+      rdfa_replace_resource(&context->new_subject,
+         &context->new_subject_bnode, resource, context->resource_bnode);
    }
-   else if(href != NULL)
+   else if(RDFA_RESOURCE_IS_SET(href, context->href_bnode))
    {
       /* * otherwise, by using the URI from @href, if present, obtained
        *   according to the section on CURIE and URI Processing. */
-      context->new_subject =
-         rdfa_replace_string(context->new_subject, href);
+      rdfa_replace_resource(&context->new_subject,
+         &context->new_subject_bnode, href, context->href_bnode);
    }
    else if((type_of != NULL) && (type_of->num_items > 0))
    {
       /* * if @type_of is present, obtained according to the
        * section on CURIE and URI Processing, then [new subject] is
        * set to be a newly created [bnode]; */
-      char* bnode = rdfa_create_bnode(context);
-      context->new_subject = rdfa_replace_string(context->new_subject, bnode);
-      free(bnode);
+      rdfa_replace_resource(&context->new_subject,
+         &context->new_subject_bnode, NULL, rdfa_create_bnode(context));
    }
-   else if(context->parent_object != NULL)
+   else if(RDFA_RESOURCE_IS_SET(
+      context->parent_object, context->parent_object_bnode))
    {
       /* * otherwise, if [parent object] is present, [new subject] is
        * set to that and the [skip element] flag is set to 'true'; */
-      context->new_subject =
-         rdfa_replace_string(context->new_subject, context->parent_object);
+      rdfa_replace_resource(&context->new_subject,
+         &context->new_subject_bnode, context->parent_object,
+         context->parent_object_bnode);
 
       /* TODO: The skip element flag will be set even if there is a
        * @property value, which is a bug, isn't it? */
@@ -127,7 +161,9 @@ void rdfa_establish_new_1_0_subject(
 /**
  * Establishes a new subject for the given context given the
  * attributes on the current element. The given context's new_subject
- * value is updated if a new subject is found.
+ * value is updated if a new subject is found. The bnode numbers of the
+ * attributes are taken from the context, an attribute that is _: is NULL
+ * and only has a number.
  *
  * @param context the RDFa context.
  * @param name the name of the current element that is being processed.
@@ -155,7 +191,7 @@ void rdfa_establish_new_1_1_subject(
       /* by using the resource from @about, if present, obtained according to
        * the section on CURIE and IRI Processing;
        */
-      if(about != NULL)
+      if(RDFA_RESOURCE_IS_SET(about, context->about_bnode))
       {
          /* NOTE: this statement achieves this part of the processing rule
           * as well because @about is set if depth == 1 in RDFa 1.1 in
@@ -164,16 +200,18 @@ void rdfa_establish_new_1_1_subject(
           * @about present, and process it according to the rule for
           * @about, above;
           */
-         context->new_subject =
-            rdfa_replace_string(context->new_subject, about);
+         rdfa_replace_resource(&context->new_subject,
+            &context->new_subject_bnode, about, context->about_bnode);
       }
-      else if(context->parent_object != NULL)
+      else if(RDFA_RESOURCE_IS_SET(
+         context->parent_object, context->parent_object_bnode))
       {
          /* otherwise, if parent object is present, new subject is set
           * to the value of parent object.
           */
-         context->new_subject =
-            rdfa_replace_string(context->new_subject, context->parent_object);
+         rdfa_replace_resource(&context->new_subject,
+            &context->new_subject_bnode, context->parent_object,
+            context->parent_object_bnode);
       }
 
       /* If @typeof is present then typed resource is set to the resource
@@ -181,7 +219,7 @@ void rdfa_establish_new_1_1_subject(
        */
       if(type_of != NULL)
       {
-         if(about != NULL)
+         if(RDFA_RESOURCE_IS_SET(about, context->about_bnode))
          {
             /* by using the resource from @about, if present, obtained
              * according to the section on CURIE and IRI Processing;
@@ -194,51 +232,52 @@ void rdfa_establish_new_1_1_subject(
              * document, then act as if there is an empty @about present
              * and process it according to the previous rule;
              */
-            context->typed_resource =
-               rdfa_replace_string(context->typed_resource, about);
+            rdfa_replace_resource(&context->typed_resource,
+               &context->typed_resource_bnode, about, context->about_bnode);
          }
          else
          {
-            if(resource != NULL)
+            if(RDFA_RESOURCE_IS_SET(resource, context->resource_bnode))
             {
                /* by using the resource from @resource, if present, obtained
                 * according to the section on CURIE and IRI Processing;
                 */
-               context->typed_resource =
-                  rdfa_replace_string(context->typed_resource, resource);
+               rdfa_replace_resource(&context->typed_resource,
+                  &context->typed_resource_bnode, resource,
+                  context->resource_bnode);
             }
-            else if(href != NULL)
+            else if(RDFA_RESOURCE_IS_SET(href, context->href_bnode))
             {
                /* otherwise, by using the IRI from @href, if present, obtained
                 * according to the section on CURIE and IRI Processing;
                 */
-               context->typed_resource =
-                  rdfa_replace_string(context->typed_resource, href);
+               rdfa_replace_resource(&context->typed_resource,
+                  &context->typed_resource_bnode, href, context->href_bnode);
             }
-            else if(src != NULL)
+            else if(RDFA_RESOURCE_IS_SET(src, context->src_bnode))
             {
                /* otherwise, by using the IRI from @src, if present, obtained
                 * according to the section on CURIE and IRI Processing;
                 */
-               context->typed_resource =
-                  rdfa_replace_string(context->typed_resource, src);
+               rdfa_replace_resource(&context->typed_resource,
+                  &context->typed_resource_bnode, src, context->src_bnode);
             }
             else
             {
                /* otherwise, the value of typed resource is set to a newly
                 * created bnode.
                 */
-               char* bnode = rdfa_create_bnode(context);
-               context->typed_resource = rdfa_replace_string(
-                  context->typed_resource, bnode);
-               free(bnode);
+               rdfa_replace_resource(&context->typed_resource,
+                  &context->typed_resource_bnode, NULL,
+                  rdfa_create_bnode(context));
             }
 
             /* The value of the current object resource is then set to the value
              * of typed resource.
              */
-            context->current_object_resource = rdfa_replace_string(
-               context->current_object_resource, context->typed_resource);
+            rdfa_replace_resource(&context->current_object_resource,
+               &context->current_object_resource_bnode, context->typed_resource,
+               context->typed_resource_bnode);
          }
       }
    }
@@ -248,39 +287,42 @@ void rdfa_establish_new_1_1_subject(
        * If the element contains an @about, @href, @src, or @resource attribute,
        * new subject is set to the resource obtained as follows:
        */
-      if(about != NULL || href != NULL || src != NULL || resource != NULL)
+      if(RDFA_RESOURCE_IS_SET(about, context->about_bnode) ||
+         RDFA_RESOURCE_IS_SET(href, context->href_bnode) ||
+         RDFA_RESOURCE_IS_SET(src, context->src_bnode) ||
+         RDFA_RESOURCE_IS_SET(resource, context->resource_bnode))
       {
-         if(about != NULL)
+         if(RDFA_RESOURCE_IS_SET(about, context->about_bnode))
          {
             /* by using the resource from @about, if present, obtained
              * according to the section on CURIE and IRI Processing;
              */
-            context->new_subject =
-               rdfa_replace_string(context->new_subject, about);
+            rdfa_replace_resource(&context->new_subject,
+               &context->new_subject_bnode, about, context->about_bnode);
          }
-         else if(resource != NULL)
+         else if(RDFA_RESOURCE_IS_SET(resource, context->resource_bnode))
          {
             /* otherwise, by using the resource from @resource, if present,
              * obtained according to the section on CURIE and IRI Processing;
              */
-            context->new_subject =
-               rdfa_replace_string(context->new_subject, resource);
+            rdfa_replace_resource(&context->new_subject,
+               &context->new_subject_bnode, resource, context->resource_bnode);
          }
-         else if(href != NULL)
+         else if(RDFA_RESOURCE_IS_SET(href, context->href_bnode))
          {
             /* otherwise, by using the IRI from @href, if present, obtained
              * according to the section on CURIE and IRI Processing;
              */
-            context->new_subject =
-               rdfa_replace_string(context->new_subject, href);
+            rdfa_replace_resource(&context->new_subject,
+               &context->new_subject_bnode, href, context->href_bnode);
          }
-         else if(src != NULL)
+         else if(RDFA_RESOURCE_IS_SET(src, context->src_bnode))
          {
             /* otherwise, by using the IRI from @src, if present, obtained
              * according to the section on CURIE and IRI Processing.
              */
-            context->new_subject =
-               rdfa_replace_string(context->new_subject, src);
+            rdfa_replace_resource(&context->new_subject,
+               &context->new_subject_bnode, src, context->src_bnode);
          }
       }
       else
@@ -301,18 +343,18 @@ void rdfa_establish_new_1_1_subject(
             /* otherwise, if @typeof is present, then new subject is set
              * to be a newly created bnode;
              */
-            char* bnode = rdfa_create_bnode(context);
-            context->new_subject = rdfa_replace_string(context->new_subject,
-               bnode);
-            free(bnode);
+            rdfa_replace_resource(&context->new_subject,
+               &context->new_subject_bnode, NULL, rdfa_create_bnode(context));
          }
-         else if(context->parent_object != NULL)
+         else if(RDFA_RESOURCE_IS_SET(
+         context->parent_object, context->parent_object_bnode))
          {
             /* otherwise, if parent object is present, new subject is set to
              * the value of parent object.
              */
-            context->new_subject = rdfa_replace_string(context->new_subject,
-               context->parent_object);
+            rdfa_replace_resource(&context->new_subject,
+               &context->new_subject_bnode, context->parent_object,
+               context->parent_object_bnode);
 
             /* Additionally, if @property is not present then the skip
              * element flag is set to 'true'.
@@ -329,8 +371,9 @@ void rdfa_establish_new_1_1_subject(
          /* Finally, if @typeof is present, set the typed resource to the value
           * of new subject.
           */
-         context->typed_resource = rdfa_replace_string(context->typed_resource,
-            context->new_subject);
+         rdfa_replace_resource(&context->typed_resource,
+            &context->typed_resource_bnode, context->new_subject,
+            context->new_subject_bnode);
       }
    }
 }
@@ -339,6 +382,8 @@ void rdfa_establish_new_1_1_subject(
  * Establishes a new subject for the given context when @rel or @rev
  * is present. The given context's new_subject and
  * current_object_resource values are updated if a new subject is found.
+ * The bnode numbers of the attributes are taken from the context, an
+ * attribute that is _: is NULL and only has a number.
  *
  * @param context the RDFa context.
  * @param about the full IRI for about, or NULL if there isn't one.
@@ -360,57 +405,61 @@ void rdfa_establish_new_1_0_subject_with_relrev(
     * [new subject] is set to the URI obtained from the first match
     * from the following rules: */
    
-   if(about != NULL)
+   if(RDFA_RESOURCE_IS_SET(about, context->about_bnode))
    {
       /* * by using the URI from @about, if present, obtained
        * according to the section on CURIE and URI Processing; */
-      context->new_subject =
-         rdfa_replace_string(context->new_subject, about);
+      rdfa_replace_resource(&context->new_subject,
+         &context->new_subject_bnode, about, context->about_bnode);
    }
-   else if(context->rdfa_version == RDFA_VERSION_1_0 &&  src != NULL)
+   else if(context->rdfa_version == RDFA_VERSION_1_0 &&
+      RDFA_RESOURCE_IS_SET(src, context->src_bnode))
    {
       /* * otherwise, by using the URI from @src, if present, obtained
        * according to the section on CURIE and URI Processing. */
-      context->new_subject =
-         rdfa_replace_string(context->new_subject, src);
+      rdfa_replace_resource(&context->new_subject,
+         &context->new_subject_bnode, src, context->src_bnode);
    }
    else if((type_of != NULL) && (type_of->num_items > 0))
    {
       /* * if @type_of is present, obtained according to the
        * section on CURIE and URI Processing, then [new subject] is
        * set to be a newly created [bnode]; */
-      char* bnode = rdfa_create_bnode(context);
-      context->new_subject = rdfa_replace_string(context->new_subject, bnode);
-      free(bnode);
+      rdfa_replace_resource(&context->new_subject,
+         &context->new_subject_bnode, NULL, rdfa_create_bnode(context));
    }
-   else if(context->parent_object != NULL)
+   else if(RDFA_RESOURCE_IS_SET(
+      context->parent_object, context->parent_object_bnode))
    {
       /* * otherwise, if [parent object] is present, [new subject] is
        * set to that; */
-      context->new_subject =
-         rdfa_replace_string(context->new_subject, context->parent_object);
+      rdfa_replace_resource(&context->new_subject,
+         &context->new_subject_bnode, context->parent_object,
+         context->parent_object_bnode);
    }
 
    /* Then the [current object resource] is set to the URI obtained
     * from the first match from the following rules: */
-   if(resource != NULL)
+   if(RDFA_RESOURCE_IS_SET(resource, context->resource_bnode))
    {
       /* * by using the URI from @resource, if present, obtained
        *   according to the section on CURIE and URI Processing; */
-      context->current_object_resource =
-         rdfa_replace_string(context->current_object_resource, resource);
+      rdfa_replace_resource(&context->current_object_resource,
+         &context->current_object_resource_bnode, resource,
+         context->resource_bnode);
    }
-   else if(href != NULL)
+   else if(RDFA_RESOURCE_IS_SET(href, context->href_bnode))
    {
       /* * otherwise, by using the URI from @href, if present,
        *   obtained according to the section on CURIE and URI Processing. */
-      context->current_object_resource =
-         rdfa_replace_string(context->current_object_resource, href);
+      rdfa_replace_resource(&context->current_object_resource,
+         &context->current_object_resource_bnode, href, context->href_bnode);
    }
    else
    {
       /* * otherwise, null. */
-      context->current_object_resource = NULL;
+      rdfa_replace_resource(&context->current_object_resource,
+         &context->current_object_resource_bnode, NULL, RDFA_NO_BNODE);
    }
 
    /* Note that final value of the [current object resource] will
@@ -421,6 +470,8 @@ void rdfa_establish_new_1_0_subject_with_relrev(
  * Establishes a new subject for the given context when @rel or @rev
  * is present. The given context's new_subject and
  * current_object_resource values are updated if a new subject is found.
+ * The bnode numbers of the attributes are taken from the context, an
+ * attribute that is _: is NULL and only has a number.
  *
  * @param context the RDFa context.
  * @param about the full IRI for about, or NULL if there isn't one.
@@ -443,7 +494,7 @@ void rdfa_establish_new_1_1_subject_with_relrev(
     * the following rules:
     */
 
-   if(about != NULL)
+   if(RDFA_RESOURCE_IS_SET(about, context->about_bnode))
    {
       /* by using the resource from @about, if present, obtained according
        * to the section on CURIE and IRI Processing;
@@ -455,8 +506,8 @@ void rdfa_establish_new_1_1_subject_with_relrev(
        * there is an empty @about present, and process it according to the
        * rule for @about, above;
        */
-      context->new_subject =
-         rdfa_replace_string(context->new_subject, about);
+      rdfa_replace_resource(&context->new_subject,
+         &context->new_subject_bnode, about, context->about_bnode);
    }
 
    if(type_of != NULL)
@@ -464,68 +515,74 @@ void rdfa_establish_new_1_1_subject_with_relrev(
       /* if the @typeof attribute is present, set typed resource to
        * new subject.
        */
-      context->typed_resource =
-         rdfa_replace_string(context->typed_resource, context->new_subject);
+      rdfa_replace_resource(&context->typed_resource,
+         &context->typed_resource_bnode, context->new_subject,
+         context->new_subject_bnode);
    }
 
    /* If no resource is provided then the first match from the following rules
     * will apply:
     *
     */
-   if(context->new_subject == NULL && context->parent_object != NULL)
+   if(!RDFA_RESOURCE_IS_SET(context->new_subject, context->new_subject_bnode) &&
+      RDFA_RESOURCE_IS_SET(
+         context->parent_object, context->parent_object_bnode))
    {
       /* otherwise, if parent object is present, new subject is set to that.
        */
-      context->new_subject = rdfa_replace_string(
-         context->new_subject, context->parent_object);
+      rdfa_replace_resource(&context->new_subject,
+         &context->new_subject_bnode, context->parent_object,
+         context->parent_object_bnode);
    }
 
    /* Then the current object resource is set to the resource obtained from
     * the first match from the following rules:
     */
 
-   if(resource != NULL)
+   if(RDFA_RESOURCE_IS_SET(resource, context->resource_bnode))
    {
       /* by using the resource from @resource, if present, obtained according
        * to the section on CURIE and IRI Processing;
        */
-      context->current_object_resource = rdfa_replace_string(
-         context->current_object_resource, resource);
+      rdfa_replace_resource(&context->current_object_resource,
+         &context->current_object_resource_bnode, resource,
+         context->resource_bnode);
    }
-   else if(href != NULL)
+   else if(RDFA_RESOURCE_IS_SET(href, context->href_bnode))
    {
       /* otherwise, by using the IRI from @href, if present, obtained
        * according to the section on CURIE and IRI Processing;
        */
-      context->current_object_resource = rdfa_replace_string(
-         context->current_object_resource, href);
+      rdfa_replace_resource(&context->current_object_resource,
+         &context->current_object_resource_bnode, href, context->href_bnode);
    }
-   else if(src != NULL)
+   else if(RDFA_RESOURCE_IS_SET(src, context->src_bnode))
    {
       /* otherwise, by using the IRI from @src, if present, obtained
        * according to the section on CURIE and IRI Processing;
        */
-      context->current_object_resource = rdfa_replace_string(
-         context->current_object_resource, src);
+      rdfa_replace_resource(&context->current_object_resource,
+         &context->current_object_resource_bnode, src, context->src_bnode);
    }
-   else if(type_of != NULL && about == NULL)
+   else if(type_of != NULL &&
+      !RDFA_RESOURCE_IS_SET(about, context->about_bnode))
    {
       /* otherwise, if @typeof is present and @about is not, use a
        * newly created bnode.
        */
-      char* bnode = rdfa_create_bnode(context);
-      context->current_object_resource = rdfa_replace_string(
-         context->current_object_resource, bnode);
-      free(bnode);
+      rdfa_replace_resource(&context->current_object_resource,
+         &context->current_object_resource_bnode, NULL,
+         rdfa_create_bnode(context));
    }
 
-   if(type_of != NULL && about == NULL)
+   if(type_of != NULL && !RDFA_RESOURCE_IS_SET(about, context->about_bnode))
    {
       /* If @typeof is present and @about is not, set typed resource to current
        * object resource.
        */
-      context->typed_resource = rdfa_replace_string(
-         context->typed_resource, context->current_object_resource);
+      rdfa_replace_resource(&context->typed_resource,
+         &context->typed_resource_bnode, context->current_object_resource,
+         context->current_object_resource_bnode);
    }
 
    /* Note that final value of the current object resource will either be
@@ -36,7 +36,7 @@ rdftriple* rdfa_create_triple(const char* subject, const char* predicate,
    const char* object, rdfresource_t object_type, const char* datatype,
    const char* language)
 {
-   rdftriple* rval = (rdftriple*)malloc(sizeof(rdftriple));
+   rdftriple* rval = (rdftriple*)rdfa_malloc(sizeof(rdftriple));
 
    /* clear the memory */
    rval->subject = NULL;
@@ -45,6 +45,9 @@ rdftriple* rdfa_create_triple(const char* subject, const char* predicate,
    rval->object_type = object_type;
    rval->datatype = NULL;
    rval->language = NULL;
+   rval->subject_bnode = RDFA_NO_BNODE;
+   rval->object_bnode = RDFA_NO_BNODE;
+   rval->allocator = rdfa_get_allocator();
 
 #if 0
    printf("SUBJECT  : %s\n", subject);
@@ -78,6 +81,37 @@ rdftriple* rdfa_create_triple(const char* subject, const char* predicate,
    return rval;
 }
 
+void rdfa_set_triple_bnodes(
+   rdftriple* triple, size_t subject_bnode, size_t object_bnode)
+{
+   /* a triple that isn't complete doesn't have any strings either */
+   if(triple->subject != NULL)
+   {
+      triple->subject_bnode = subject_bnode;
+      if(triple->object_type == RDF_TYPE_IRI)
+      {
+         triple->object_bnode = object_bnode;
+      }
+   }
+}
+
+rdftriple* rdfa_create_resource_triple(const char* subject,
+   size_t subject_bnode, const char* predicate, const char* object,
+   size_t object_bnode, rdfresource_t object_type, const char* datatype,
+   const char* language)
+{
+   char subject_name[RDFA_BNODE_NAME_SIZE];
+   char object_name[RDFA_BNODE_NAME_SIZE];
+   rdftriple* rval = rdfa_create_triple(
+      rdfa_resource_name(subject, subject_bnode, subject_name), predicate,
+      rdfa_resource_name(object, object_bnode, object_name), object_type,
+      datatype, language);
+
+   rdfa_set_triple_bnodes(rval, subject_bnode, object_bnode);
+
+   return rval;
+}
+
 void rdfa_print_triple(rdftriple* triple)
 {
    if(triple->object_type == RDF_TYPE_NAMESPACE_PREFIX)
@@ -165,12 +199,215 @@ void rdfa_print_triple(rdftriple* triple)
 
 void rdfa_free_triple(rdftriple* triple)
 {
-   free(triple->subject);
-   free(triple->predicate);
-   free(triple->object);
-   free(triple->datatype);
-   free(triple->language);
-   free(triple);
+   /* triples are usually freed by the application after the parse, so
+    * the allocator that created the triple has to be used explicitly */
+   const rdfaallocator* previous_allocator =
+      rdfa_use_allocator(triple->allocator);
+
+   rdfa_free(triple->subject);
+   rdfa_free(triple->predicate);
+   rdfa_free(triple->object);
+   rdfa_free(triple->datatype);
+   rdfa_free(triple->language);
+   rdfa_free(triple);
+   rdfa_use_allocator(previous_allocator);
+}
+
+/**
+ * Keeps the value of a namespace in the namespaces of a parse, which is
+ * always NULL as the position of the namespace is its id.
+ */
+static void* rdfa_keep_namespace_value(
+   const void* old_value, const void* new_value)
+{
+   (void)new_value;
+
+   return (void*)old_value;
+}
+
+/**
+ * Splits an IRI after its last '#', '/' or ':' into a namespace and a
+ * local name. The namespace is announced to the namespace handler the
+ * first time that it is seen.
+ *
+ * @param context the current processing context.
+ * @param iri the IRI to split, or NULL.
+ * @param namespace_id set to the id of the namespace of the IRI, or to
+ *                     RDFA_NO_NAMESPACE if the IRI isn't split.
+ *
+ * @return the local name of the IRI, which points into the IRI.
+ */
+static const char* rdfa_compact_iri(
+   rdfacontext* context, const char* iri, unsigned int* namespace_id)
+{
+   rdfamapping* namespaces = context->namespaces;
+   const rdfamappingentry* entry;
+   const char* local_name = iri;
+   const char* ptr;
+   size_t num_namespaces;
+   rdfaview name;
+
+   *namespace_id = RDFA_NO_NAMESPACE;
+
+   /* blank nodes don't have a namespace */
+   if(iri == NULL || namespaces == NULL || (iri[0] == '_' && iri[1] == ':'))
+   {
+      return iri;
+   }
+
+   for(ptr = iri; *ptr != '\0'; ptr++)
+   {
+      if(*ptr == '#' || *ptr == '/' || *ptr == ':')
+      {
+         local_name = ptr + 1;
+      }
+   }
+
+   if(local_name != iri)
+   {
+      name.data = iri;
+      name.length = local_name - iri;
+      num_namespaces = namespaces->num_entries;
+      entry = rdfa_update_mapping_view(
+         namespaces, name, NULL, &rdfa_keep_namespace_value);
+      *namespace_id = (unsigned int)(entry - namespaces->entries) + 1;
+
+      if(namespaces->num_entries != num_namespaces &&
+         context->namespace_callback != NULL)
+      {
+         context->namespace_callback(
+            *namespace_id, entry->key, context->callback_data);
+      }
+   }
+
+   return local_name;
+}
+
+/**
+ * Sets up a triple that borrows its strings from the caller, in the same
+ * way as rdfa_create_triple() sets up a triple that copies them. The
+ * subject and the object of the triple may be names that the caller
+ * wrote for numbered bnodes.
+ *
+ * @param triple the triple to set up.
+ * @param subject the subject for the triple.
+ * @param subject_bnode the bnode number of the subject, or RDFA_NO_BNODE.
+ * @param predicate the predicate for the triple.
+ * @param object the object for the triple.
+ * @param object_bnode the bnode number of the object, or RDFA_NO_BNODE.
+ * @param object_type the type of the object, which must be an rdfresource_t.
+ * @param datatype the datatype of the triple.
+ * @param language the language for the triple.
+ */
+static void rdfa_init_borrowed_triple(rdftriple* triple,
+   const char* subject, size_t subject_bnode, const char* predicate,
+   const char* object, size_t object_bnode, rdfresource_t object_type,
+   const char* datatype, const char* language)
+{
+   triple->subject = NULL;
+   triple->predicate = NULL;
+   triple->object = NULL;
+   triple->object_type = object_type;
+   triple->datatype = NULL;
+   triple->language = NULL;
+   triple->subject_bnode = RDFA_NO_BNODE;
+   triple->object_bnode = RDFA_NO_BNODE;
+   triple->allocator = NULL;
+
+   /* a triple needs a subject, predicate and object at minimum to be
+    * considered a triple. */
+   if((subject != NULL) && (predicate != NULL) && (object != NULL))
+   {
+      triple->subject = (char*)subject;
+      triple->predicate = (char*)predicate;
+      triple->object = (char*)object;
+      triple->datatype = (char*)datatype;
+      triple->language = (char*)language;
+      rdfa_set_triple_bnodes(triple, subject_bnode, object_bnode);
+   }
+}
+
+/**
+ * Passes a default graph triple that the application doesn't take
+ * ownership of to the compact or the borrowed triple handler.
+ *
+ * @param context the current processing context.
+ * @param triple the triple, which is only valid during the call.
+ */
+static void rdfa_lend_default_graph_triple(
+   rdfacontext* context, const rdftriple* triple)
+{
+   if(context->compact_triple_callback != NULL)
+   {
+      rdfcompacttriple compact;
+
+      compact.subject = rdfa_compact_iri(
+         context, triple->subject, &compact.subject_namespace);
+      compact.predicate = rdfa_compact_iri(
+         context, triple->predicate, &compact.predicate_namespace);
+      compact.object_namespace = RDFA_NO_NAMESPACE;
+      compact.object = triple->object;
+      if(triple->object_type == RDF_TYPE_IRI)
+      {
+         compact.object = rdfa_compact_iri(
+            context, triple->object, &compact.object_namespace);
+      }
+      compact.object_type = triple->object_type;
+      compact.datatype = rdfa_compact_iri(
+         context, triple->datatype, &compact.datatype_namespace);
+      compact.language = triple->language;
+      compact.subject_bnode = triple->subject_bnode;
+      compact.object_bnode = triple->object_bnode;
+
+      context->compact_triple_callback(&compact, context->callback_data);
+   }
+   else
+   {
+      context->borrowed_triple_callback(triple, context->callback_data);
+   }
+}
+
+void rdfa_emit_default_graph_triple(rdfacontext* context, rdftriple* triple)
+{
+   if(context->compact_triple_callback != NULL ||
+      context->borrowed_triple_callback != NULL)
+   {
+      rdfa_lend_default_graph_triple(context, triple);
+      rdfa_free_triple(triple);
+   }
+   else
+   {
+      context->default_graph_triple_callback(triple, context->callback_data);
+   }
+}
+
+void rdfa_generate_default_graph_triple(rdfacontext* context,
+   const char* subject, size_t subject_bnode, const char* predicate,
+   const char* object, size_t object_bnode, rdfresource_t object_type,
+   const char* datatype, const char* language)
+{
+   if(context->compact_triple_callback != NULL ||
+      context->borrowed_triple_callback != NULL)
+   {
+      char subject_name[RDFA_BNODE_NAME_SIZE];
+      char object_name[RDFA_BNODE_NAME_SIZE];
+      rdftriple triple;
+
+      /* the triple only borrows the strings of the caller, the names of
+       * numbered bnodes are written on the stack */
+      rdfa_init_borrowed_triple(&triple,
+         rdfa_resource_name(subject, subject_bnode, subject_name),
+         subject_bnode, predicate,
+         rdfa_resource_name(object, object_bnode, object_name),
+         object_bnode, object_type, datatype, language);
+      rdfa_lend_default_graph_triple(context, &triple);
+   }
+   else
+   {
+      rdfa_emit_default_graph_triple(context, rdfa_create_resource_triple(
+         subject, subject_bnode, predicate, object, object_bnode,
+         object_type, datatype, language));
+   }
 }
 
 #ifndef LIBRDFA_IN_RAPTOR
@@ -223,45 +460,42 @@ void rdfa_processor_triples(
    if(context->processor_graph_triple_callback != NULL)
    {
       char buffer[32];
-      char* subject = rdfa_create_bnode(context);
-      char* context_subject = rdfa_create_bnode(context);
+      size_t subject = rdfa_create_bnode(context);
+      size_t context_subject = rdfa_create_bnode(context);
 
       /* generate the RDFa Processing Graph warning type triple */
-      rdftriple* triple = rdfa_create_triple(
-         subject, "http://www.w3.org/1999/02/22-rdf-syntax-ns#type",
-         type, RDF_TYPE_IRI, NULL, NULL);
+      rdftriple* triple = rdfa_create_resource_triple(
+         NULL, subject, "http://www.w3.org/1999/02/22-rdf-syntax-ns#type",
+         type, RDFA_NO_BNODE, RDF_TYPE_IRI, NULL, NULL);
       context->processor_graph_triple_callback(triple, context->callback_data);
 
       /* generate the description */
-      triple = rdfa_create_triple(
-         subject, "http://purl.org/dc/terms/description", msg,
-         RDF_TYPE_PLAIN_LITERAL, NULL, "en");
+      triple = rdfa_create_resource_triple(
+         NULL, subject, "http://purl.org/dc/terms/description", msg,
+         RDFA_NO_BNODE, RDF_TYPE_PLAIN_LITERAL, NULL, "en");
       context->processor_graph_triple_callback(triple, context->callback_data);
 
       /* generate the context triple for the error */
-      triple = rdfa_create_triple(
-         subject, "http://www.w3.org/ns/rdfa#context",
-         context_subject, RDF_TYPE_IRI, NULL, NULL);
+      triple = rdfa_create_resource_triple(
+         NULL, subject, "http://www.w3.org/ns/rdfa#context",
+         NULL, context_subject, RDF_TYPE_IRI, NULL, NULL);
       context->processor_graph_triple_callback(triple, context->callback_data);
 
       /* generate the type for the context triple */
-      triple = rdfa_create_triple(
-         context_subject, "http://www.w3.org/1999/02/22-rdf-syntax-ns#type",
-         "http://www.w3.org/2009/pointers#LineCharPointer",
+      triple = rdfa_create_resource_triple(NULL, context_subject,
+         "http://www.w3.org/1999/02/22-rdf-syntax-ns#type",
+         "http://www.w3.org/2009/pointers#LineCharPointer", RDFA_NO_BNODE,
          RDF_TYPE_IRI, NULL, NULL);
       context->processor_graph_triple_callback(triple, context->callback_data);
 
       /* generate the line number */
       snprintf(buffer, sizeof(buffer) - 1, "%d",
          (int)xmlSAX2GetLineNumber(context->parser));
-      triple = rdfa_create_triple(
-         context_subject, "http://www.w3.org/2009/pointers#lineNumber",
-         buffer, RDF_TYPE_TYPED_LITERAL,
+      triple = rdfa_create_resource_triple(NULL, context_subject,
+         "http://www.w3.org/2009/pointers#lineNumber", buffer, RDFA_NO_BNODE,
+         RDF_TYPE_TYPED_LITERAL,
          "http://www.w3.org/2001/XMLSchema#positiveInteger", NULL);
       context->processor_graph_triple_callback(triple, context->callback_data);
-
-      free(context_subject);
-      free(subject);
    }
 }
 #endif
@@ -300,17 +534,22 @@ void rdfa_complete_incomplete_triples(rdfacontext* context)
          /* If direction is 'none', the new subject is added to the list
           * from the iterated incomplete triple. */
          const char* predicate = (const char*)incomplete_triple->data;
-         rdftriple* triple = rdfa_create_triple(context->parent_subject,
-            predicate, context->new_subject, RDF_TYPE_IRI, NULL, NULL);
+         char name[RDFA_BNODE_NAME_SIZE];
+         const char* parent_subject = rdfa_resource_name(
+            context->parent_subject, context->parent_subject_bnode, name);
+         rdftriple* triple = rdfa_create_resource_triple(
+            context->parent_subject, context->parent_subject_bnode,
+            predicate, context->new_subject, context->new_subject_bnode,
+            RDF_TYPE_IRI, NULL, NULL);
 
-         /* ensure the list mapping exists */
-         rdfa_create_list_mapping(
-            context, context->local_list_mappings,
-            context->parent_subject, predicate);
+         /* ensure the list mapping exists, the lists are found by the
+          * name of their subject */
+         rdfa_create_list_mapping(context, context->local_list_mappings,
+            parent_subject, context->parent_subject_bnode, predicate);
 
          /* add the predicate to the list mapping */
          rdfa_append_to_list_mapping(context->local_list_mappings,
-            context->parent_subject, predicate, (void*)triple);
+            parent_subject, predicate, (void*)triple);
       }
       else if(incomplete_triple->flags & RDFALIST_FLAG_DIR_FORWARD)
       {
@@ -322,11 +561,11 @@ void rdfa_complete_incomplete_triples(rdfacontext* context)
           *    the predicate from the iterated incomplete triple
           * object
           *    [new subject] */
-         rdftriple* triple =
-            rdfa_create_triple(context->parent_subject,
-               (const char*)incomplete_triple->data, context->new_subject,
-               RDF_TYPE_IRI, NULL, NULL);
-         context->default_graph_triple_callback(triple, context->callback_data);
+         rdfa_generate_default_graph_triple(context,
+            context->parent_subject, context->parent_subject_bnode,
+            (const char*)incomplete_triple->data,
+            context->new_subject, context->new_subject_bnode,
+            RDF_TYPE_IRI, NULL, NULL);
       }
       else
       {
@@ -338,14 +577,14 @@ void rdfa_complete_incomplete_triples(rdfacontext* context)
           *    the predicate from the iterated incomplete triple
           * object
           *    [parent subject] */
-         rdftriple* triple =
-            rdfa_create_triple(context->new_subject,
-               (const char*)incomplete_triple->data, context->parent_subject,
-               RDF_TYPE_IRI, NULL, NULL);
-         context->default_graph_triple_callback(triple, context->callback_data);
+         rdfa_generate_default_graph_triple(context,
+            context->new_subject, context->new_subject_bnode,
+            (const char*)incomplete_triple->data,
+            context->parent_subject, context->parent_subject_bnode,
+            RDF_TYPE_IRI, NULL, NULL);
       }
-      free(incomplete_triple->data);
-      free(incomplete_triple);
+      rdfa_free(incomplete_triple->data);
+      rdfa_free(incomplete_triple);
    }
    context->incomplete_triples->num_items = 0;
 }
@@ -356,6 +595,7 @@ void rdfa_complete_type_triples(
    unsigned int i;
    rdfalistitem** iptr = type_of->items;
    const char* subject;
+   size_t subject_bnode;
    const char* type;
 
    if(context->rdfa_version == RDFA_VERSION_1_0)
@@ -373,6 +613,7 @@ void rdfa_complete_type_triples(
        *    full URI of 'type'
        */
       subject = context->new_subject;
+      subject_bnode = context->new_subject_bnode;
    }
    else
    {
@@ -389,19 +630,24 @@ void rdfa_complete_type_triples(
        *    current full IRI of 'type' from typed resource
        */
       subject = context->typed_resource;
+      subject_bnode = context->typed_resource_bnode;
    }
 
    for(i = 0; i < type_of->num_items; i++)
    {
       rdfalistitem* iri = *iptr;
-      rdftriple* triple;
+      size_t type_bnode = RDFA_NO_BNODE;
       type = (const char*)iri->data;
 
-      triple = rdfa_create_triple(subject,
-         "http://www.w3.org/1999/02/22-rdf-syntax-ns#type", type, RDF_TYPE_IRI,
-         NULL, NULL);
+      /* a type can be the bnode that _: refers to */
+      if(iri->flags & RDFALIST_FLAG_UNDERSCORE_COLON_BNODE)
+      {
+         type_bnode = context->underscore_colon_bnode;
+      }
 
-      context->default_graph_triple_callback(triple, context->callback_data);
+      rdfa_generate_default_graph_triple(context, subject, subject_bnode,
+         "http://www.w3.org/1999/02/22-rdf-syntax-ns#type",
+         type, type_bnode, RDF_TYPE_IRI, NULL, NULL);
       iptr++;
    }
 }
@@ -433,11 +679,10 @@ void rdfa_complete_relrev_triples(
       {
          rdfalistitem* curie = *relptr;
 
-         rdftriple* triple = rdfa_create_triple(context->new_subject,
+         rdfa_generate_default_graph_triple(context,
+            context->new_subject, context->new_subject_bnode,
             (const char*)curie->data, context->current_object_resource,
-            RDF_TYPE_IRI, NULL, NULL);
-
-         context->default_graph_triple_callback(triple, context->callback_data);
+            context->current_object_resource_bnode, RDF_TYPE_IRI, NULL, NULL);
          relptr++;
       }
    }
@@ -459,11 +704,11 @@ void rdfa_complete_relrev_triples(
       {
          rdfalistitem* curie = *revptr;
 
-         rdftriple* triple = rdfa_create_triple(
-            context->current_object_resource, (const char*)curie->data,
-            context->new_subject, RDF_TYPE_IRI, NULL, NULL);
-
-         context->default_graph_triple_callback(triple, context->callback_data);
+         rdfa_generate_default_graph_triple(context,
+            context->current_object_resource,
+            context->current_object_resource_bnode, (const char*)curie->data,
+            context->new_subject, context->new_subject_bnode,
+            RDF_TYPE_IRI, NULL, NULL);
          revptr++;
       }
    }
@@ -478,9 +723,12 @@ void rdfa_save_incomplete_triples(
     * [incomplete triple]s, pending the discovery of a subject that
     * can be used as the object. Also, [current object resource]
     * should be set to a newly created [bnode] */
-   if(context->current_object_resource == NULL)
+   if(!RDFA_RESOURCE_IS_SET(context->current_object_resource,
+      context->current_object_resource_bnode))
    {
-      context->current_object_resource = rdfa_create_bnode(context);
+      rdfa_replace_resource(&context->current_object_resource,
+         &context->current_object_resource_bnode, NULL,
+         rdfa_create_bnode(context));
    }
 
    /* If present, @rel must contain one or more URIs, obtained
@@ -657,13 +905,11 @@ void rdfa_complete_object_literal_triples(rdfacontext* context)
    {
 
       rdfalistitem* curie = *pptr;
-      rdftriple* triple = NULL;
-
-      triple = rdfa_create_triple(context->new_subject,
-         (const char*)curie->data, current_object_literal, type,
-         context->datatype, context->language);
 
-      context->default_graph_triple_callback(triple, context->callback_data);
+      rdfa_generate_default_graph_triple(context,
+         context->new_subject, context->new_subject_bnode,
+         (const char*)curie->data, current_object_literal, RDFA_NO_BNODE,
+         type, context->datatype, context->language);
       pptr++;
    }
 
@@ -684,6 +930,7 @@ void rdfa_complete_current_property_value_triples(rdfacontext* context)
     * on CURIE and IRI Processing, and then the actual literal value is
     * obtained as follows: */
    char* current_property_value = NULL;
+   size_t current_property_value_bnode = RDFA_NO_BNODE;
    rdfresource_t type = RDF_TYPE_UNKNOWN;
 
    unsigned int i;
@@ -757,32 +1004,38 @@ void rdfa_complete_current_property_value_triples(rdfacontext* context)
    {
       /* otherwise, if the @rel, @rev, and @content attributes are not present,
        * as a resource obtained from one of the following: */
-      if(context->resource != NULL)
+      if(RDFA_RESOURCE_IS_SET(context->resource, context->resource_bnode))
       {
          /* by using the resource from @resource, if present, obtained
           * according to the section on CURIE and IRI Processing; */
          current_property_value = context->resource;
+         current_property_value_bnode = context->resource_bnode;
          type = RDF_TYPE_IRI;
       }
-      else if(context->href != NULL)
+      else if(RDFA_RESOURCE_IS_SET(context->href, context->href_bnode))
       {
          /* otherwise, by using the IRI from @href, if present, obtained
           * according to the section on CURIE and IRI Processing; */
          current_property_value = context->href;
+         current_property_value_bnode = context->href_bnode;
          type = RDF_TYPE_IRI;
       }
-      else if(context->src != NULL)
+      else if(RDFA_RESOURCE_IS_SET(context->src, context->src_bnode))
       {
          /* otherwise, by using the IRI from @src, if present, obtained
           * according to the section on CURIE and IRI Processing. */
          current_property_value = context->src;
+         current_property_value_bnode = context->src_bnode;
          type = RDF_TYPE_IRI;
       }
-      else if((context->about == NULL) && (context->typed_resource != NULL))
+      else if(!RDFA_RESOURCE_IS_SET(context->about, context->about_bnode) &&
+         RDFA_RESOURCE_IS_SET(
+            context->typed_resource, context->typed_resource_bnode))
       {
          /* otherwise, if @typeof is present and @about is not, the value of
           * typed resource. */
          current_property_value = context->typed_resource;
+         current_property_value_bnode = context->typed_resource_bnode;
          type = RDF_TYPE_IRI;
       }
       else
@@ -818,8 +1071,8 @@ void rdfa_complete_current_property_value_triples(rdfacontext* context)
        * the predicate IRI, instantiate a new list and add to local list
        * mappings add the current property value to the list associated
        * with the predicate IRI in the local list mapping */
-      rdfa_establish_new_inlist_triples(
-         context, context->property, current_property_value, type);
+      rdfa_establish_new_inlist_triples(context, context->property,
+         current_property_value, current_property_value_bnode, type);
    }
    else
    {
@@ -835,13 +1088,90 @@ void rdfa_complete_current_property_value_triples(rdfacontext* context)
           * object
           *   current property value */
          rdfalistitem* curie = *pptr;
-         rdftriple* triple = rdfa_create_triple(context->new_subject,
-            (const char*)curie->data, current_property_value, type,
-            context->datatype, context->language);
-
-         context->default_graph_triple_callback(triple, context->callback_data);
+         rdfa_generate_default_graph_triple(context,
+            context->new_subject, context->new_subject_bnode,
+            (const char*)curie->data, current_property_value,
+            current_property_value_bnode, type, context->datatype,
+            context->language);
 
          pptr++;
       }
    }
 }
+
+int rdfa_can_stream_current_property_value(rdfacontext* context)
+{
+   /* only the values that are built from the text of the element's
+    * descendants can be streamed, see
+    * rdfa_complete_current_property_value_triples() */
+   if(context->literal_chunk_callback == NULL ||
+      context->rdfa_version != RDFA_VERSION_1_1 ||
+      context->property == NULL ||
+      !RDFA_RESOURCE_IS_SET(context->new_subject, context->new_subject_bnode) ||
+      context->inlist_present || context->content != NULL)
+   {
+      return 0;
+   }
+
+   if(context->datatype != NULL)
+   {
+      return strcmp(context->datatype,
+         "http://www.w3.org/1999/02/22-rdf-syntax-ns#XMLLiteral") != 0;
+   }
+
+   if((context->rel_present == 0) && (context->rev_present == 0))
+   {
+      if(RDFA_RESOURCE_IS_SET(context->resource, context->resource_bnode) ||
+         RDFA_RESOURCE_IS_SET(context->href, context->href_bnode) ||
+         RDFA_RESOURCE_IS_SET(context->src, context->src_bnode))
+      {
+         return 0;
+      }
+
+      return RDFA_RESOURCE_IS_SET(context->about, context->about_bnode) ||
+         !RDFA_RESOURCE_IS_SET(
+            context->typed_resource, context->typed_resource_bnode);
+   }
+
+   return 1;
+}
+
+void rdfa_stream_current_property_value(
+   rdfacontext* context, const char* chunk, size_t chunk_length)
+{
+   char name[RDFA_BNODE_NAME_SIZE];
+   rdftriple triple;
+   unsigned int i;
+   rdfalistitem** pptr;
+
+   /* the triple only borrows the strings of the context */
+   triple.subject = (char*)rdfa_resource_name(
+      context->new_subject, context->new_subject_bnode, name);
+   triple.object = NULL;
+   triple.object_type = RDF_TYPE_PLAIN_LITERAL;
+   triple.datatype = NULL;
+   triple.language = context->language;
+   triple.subject_bnode = context->new_subject_bnode;
+   triple.object_bnode = RDFA_NO_BNODE;
+   triple.allocator = NULL;
+   if(context->datatype != NULL)
+   {
+      triple.datatype = context->datatype;
+      if(strlen(context->datatype) > 0)
+      {
+         triple.object_type = RDF_TYPE_TYPED_LITERAL;
+      }
+   }
+
+   pptr = context->property->items;
+   for(i = 0; i < context->property->num_items; i++)
+   {
+      rdfalistitem* curie = *pptr;
+
+      triple.predicate = (char*)curie->data;
+      context->literal_chunk_callback(
+         &triple, chunk, chunk_length, context->callback_data);
+
+      pptr++;
+   }
+}
@@ -0,0 +1,305 @@
+/*
+ * Copyright 2008-2011 Digital Bazaar, Inc.
+ *
+ * This file is part of librdfa.
+ *
+ * librdfa is Free Software, and can be licensed under any of the
+ * following three licenses:
+ *
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any
+ *      newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE-* at the top of this software distribution for more
+ * information regarding the details of each license.
+ *
+ * This test counts the number of heap allocations that librdfa makes
+ * for every element in a document, so that changes that add per-element
+ * allocations are noticed. It also checks that all of the memory that
+ * librdfa allocates goes through an allocator set with
+ * rdfa_set_allocator(), that an allocator that is missing a callback
+ * isn't used, and that triples that are passed to a borrowed triple
+ * handler aren't allocated at all.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <rdfa.h>
+#include "test_util.h"
+
+#define BASE_URI "http://example.org/allocations.html"
+
+/* the most heap allocations that may be made for every element in the
+ * test document, including the ones that are made by the XML parser */
+#define MAX_ALLOCATIONS_PER_ELEMENT 8
+
+/* the number of elements in the smaller of the two test documents */
+#define NUM_ELEMENTS 1000
+
+/* an element without triples and an element with one triple */
+#define EMPTY_ELEMENT "<div></div>"
+#define TRIPLE_ELEMENT "<div property=\"dc:title\" content=\"t\"></div>"
+
+/* the exit status that tells automake that the test was skipped */
+#define SKIPPED 77
+
+/* gcc says that AddressSanitizer is in use with a macro, clang with
+ * __has_feature() */
+#ifdef __SANITIZE_ADDRESS__
+#define ADDRESS_SANITIZER 1
+#endif
+#ifdef __has_feature
+#if __has_feature(address_sanitizer)
+#define ADDRESS_SANITIZER 1
+#endif
+#endif
+
+/* allocation counting replaces the allocator, which is only possible
+ * with glibc and not when a sanitizer owns the allocator */
+#if defined(__GLIBC__) && !defined(ADDRESS_SANITIZER)
+#define COUNT_ALLOCATIONS 1
+
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t nmemb, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void __libc_free(void* ptr);
+
+/* the number of allocations made since the counter was last reset */
+static unsigned long g_allocations = 0;
+
+void* malloc(size_t size)
+{
+   g_allocations++;
+   return __libc_malloc(size);
+}
+
+void* calloc(size_t nmemb, size_t size)
+{
+   g_allocations++;
+   return __libc_calloc(nmemb, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+   g_allocations++;
+   return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr)
+{
+   __libc_free(ptr);
+}
+#endif
+
+/**
+ * The allocator status struct keeps track of the memory that is allocated
+ * through the allocator callbacks.
+ */
+typedef struct allocator_status
+{
+   unsigned long allocations;
+   unsigned long outstanding;
+   /* 1 to set the allocator without its realloc callback */
+   int partial;
+} allocator_status;
+
+static void* test_alloc(size_t size, void* user_data)
+{
+   allocator_status* astatus = (allocator_status*)user_data;
+
+   astatus->allocations++;
+   astatus->outstanding++;
+
+   return malloc(size);
+}
+
+static void* test_realloc(void* ptr, size_t size, void* user_data)
+{
+   allocator_status* astatus = (allocator_status*)user_data;
+
+   astatus->allocations++;
+   if(ptr == NULL)
+   {
+      astatus->outstanding++;
+   }
+
+   return realloc(ptr, size);
+}
+
+static void test_free(void* ptr, void* user_data)
+{
+   allocator_status* astatus = (allocator_status*)user_data;
+
+   astatus->outstanding--;
+   free(ptr);
+}
+
+static void borrowed_triple(const rdftriple* triple, void* callback_data)
+{
+}
+
+/**
+ * Builds an XHTML document that contains the given number of elements in
+ * its body.
+ *
+ * @param element the element to put into the body.
+ * @param num_elements the number of elements to put into the body.
+ *
+ * @return the document, which must be freed.
+ */
+static char* create_document(const char* element, int num_elements)
+{
+   const char* header =
+      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      "<html xmlns=\"http://www.w3.org/1999/xhtml\""
+      " prefix=\"dc: http://purl.org/dc/terms/\"><head><title>test</title>"
+      "</head><body>";
+   const char* footer = "</body></html>";
+   size_t length =
+      strlen(header) + (strlen(element) * num_elements) + strlen(footer);
+   char* rval = (char*)malloc(length + 1);
+   char* rptr = rval;
+   int i;
+
+   strcpy(rptr, header);
+   rptr += strlen(header);
+   for(i = 0; i < num_elements; i++)
+   {
+      strcpy(rptr, element);
+      rptr += strlen(element);
+   }
+   strcpy(rptr, footer);
+
+   return rval;
+}
+
+/**
+ * Parses a document with the given number of elements in its body.
+ *
+ * @param element the element to put into the body.
+ * @param num_elements the number of elements to put into the body.
+ * @param astatus the status of the allocator to parse with, or NULL to
+ *                parse with the standard allocator.
+ * @param borrowed 1 to pass the triples to a borrowed triple handler, 0
+ *                 to pass them to the default graph triple handler.
+ *
+ * @return the number of allocations made while parsing the document.
+ */
+static unsigned long parse_document(const char* element,
+   int num_elements, allocator_status* astatus, int borrowed)
+{
+   unsigned long rval = 0;
+   char* buffer = create_document(element, num_elements);
+   test_document document;
+   rdfacontext* context;
+
+#ifdef COUNT_ALLOCATIONS
+   g_allocations = 0;
+#endif
+
+   context = test_create_context(
+      BASE_URI, buffer, &document, &test_free_triple);
+   if(borrowed)
+   {
+      rdfa_set_borrowed_triple_handler(context, &borrowed_triple);
+   }
+   if(astatus != NULL)
+   {
+      rdfa_set_allocator(context, &test_alloc,
+         astatus->partial ? NULL : &test_realloc, &test_free, astatus);
+   }
+   test_parse_context(context);
+
+#ifdef COUNT_ALLOCATIONS
+   rval = g_allocations;
+#endif
+
+   free(buffer);
+
+   return rval;
+}
+
+int main(int argc, char** argv)
+{
+   int rval = 0;
+   allocator_status astatus;
+#ifdef COUNT_ALLOCATIONS
+   unsigned long small;
+   unsigned long large;
+   unsigned long per_element;
+   unsigned long per_triple;
+#endif
+
+   printf("Running allocation tests\n");
+
+   /* everything that librdfa allocates must go through the allocator and
+    * be freed again by the time the context is freed */
+   astatus.allocations = 0;
+   astatus.outstanding = 0;
+   astatus.partial = 0;
+   parse_document(TRIPLE_ELEMENT, NUM_ELEMENTS, &astatus, 0);
+   printf("%lu allocations through the allocator, %lu not freed\n",
+      astatus.allocations, astatus.outstanding);
+   if(astatus.allocations == 0 || astatus.outstanding != 0)
+   {
+      printf("FAIL: the allocator was not used for all memory\n");
+      rval = 1;
+   }
+
+   /* the standard allocator is used instead of an allocator that is
+    * missing a callback */
+   astatus.allocations = 0;
+   astatus.outstanding = 0;
+   astatus.partial = 1;
+   parse_document(TRIPLE_ELEMENT, NUM_ELEMENTS, &astatus, 0);
+   if(astatus.allocations != 0 || astatus.outstanding != 0)
+   {
+      printf("FAIL: an allocator without a realloc callback was used\n");
+      rval = 1;
+   }
+
+#ifdef COUNT_ALLOCATIONS
+   /* the document setup cost is the same for both documents, so the
+    * difference is what the extra elements cost */
+   small = parse_document(EMPTY_ELEMENT, NUM_ELEMENTS, NULL, 0);
+   large = parse_document(EMPTY_ELEMENT, NUM_ELEMENTS * 2, NULL, 0);
+   per_element = (large - small) / NUM_ELEMENTS;
+
+   printf("%lu allocations per element, at most %d are allowed\n",
+      per_element, MAX_ALLOCATIONS_PER_ELEMENT);
+
+   if(per_element > MAX_ALLOCATIONS_PER_ELEMENT)
+   {
+      printf("FAIL: too many allocations per element\n");
+      rval = 1;
+   }
+
+   /* an element with a triple costs no more than an empty element when
+    * the triple is borrowed */
+   small = parse_document(TRIPLE_ELEMENT, NUM_ELEMENTS, NULL, 1);
+   large = parse_document(TRIPLE_ELEMENT, NUM_ELEMENTS * 2, NULL, 1);
+   per_triple = (large - small) / NUM_ELEMENTS;
+   per_triple = (per_triple > per_element) ? per_triple - per_element : 0;
+
+   printf("%lu allocations per borrowed triple, none are allowed\n",
+      per_triple);
+
+   if(per_triple > 0)
+   {
+      printf("FAIL: borrowed triples were allocated\n");
+      rval = 1;
+   }
+#else
+   printf("Allocation counting is not supported, skipping test\n");
+   if(rval == 0)
+   {
+      rval = SKIPPED;
+   }
+#endif
+
+   return rval;
+}
@@ -0,0 +1,330 @@
+/*
+ * Copyright 2008-2011 Digital Bazaar, Inc.
+ *
+ * This file is part of librdfa.
+ *
+ * librdfa is Free Software, and can be licensed under any of the
+ * following three licenses:
+ *
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any
+ *      newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE-* at the top of this software distribution for more
+ * information regarding the details of each license.
+ *
+ * This test checks that a document that is parsed with a compact triple
+ * handler gives the same triples as it does with the default graph
+ * triple handler, once the IRIs are joined with their namespaces again,
+ * and that every namespace is announced once before it is used. It also
+ * checks that the bnode numbers of the triples match the bnode names and
+ * that a bnode that the document names doesn't get a number, even if its
+ * name is the same as the name of a bnode that the parser created.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <rdfa.h>
+#include <rdfa_utils.h>
+#include "test_util.h"
+
+#define BASE_URI "http://example.org/compact.html"
+
+/* the local name of the predicate of the triple whose subject and object
+ * are the bnode that the document names */
+#define NAMED_PREDICATE "named"
+
+/* the most namespaces that the test document uses */
+#define MAX_TEST_NAMESPACES 32
+
+#define DOCUMENT \
+   "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n" \
+   "<html xmlns=\"http://www.w3.org/1999/xhtml\"" \
+   " prefix=\"dc: http://purl.org/dc/terms/ ex: http://example.org/ns#" \
+   " urn: urn:isbn:\"><head><title>test</title></head>" \
+   "<body vocab=\"http://schema.org/\">" \
+   "<div about=\"#a\" typeof=\"ex:Thing Person\" property=\"ex:name dc:title\"" \
+   " rel=\"ex:knows\" resource=\"[urn:0451450523]\">a</div>" \
+   "<p property=\"dc:date\" datatype=\"ex:date\">2012</p>" \
+   "<p property=\"ex:list\" inlist=\"\" resource=\"ex:one\"></p>" \
+   "<p property=\"ex:list\" inlist=\"\" resource=\"_:b\"></p>" \
+   "<div rel=\"ex:child\"><span property=\"name\" lang=\"en\">c</span></div>" \
+   "<p about=\"[_:]\" property=\"ex:name\">u</p>" \
+   "<p about=\"#u\" rel=\"ex:knows\" resource=\"[_:]\"></p>" \
+   "<p about=\"_:bnode0\" property=\"ex:" NAMED_PREDICATE "\"" \
+   " resource=\"_:bnode0\"></p>" \
+   "</body></html>"
+
+/**
+ * The parse status struct keeps track of the document that is parsed,
+ * the namespaces that were announced and the triples that it gave.
+ */
+typedef struct parse_status
+{
+   test_document document;
+
+   /* the namespaces, the namespace with the id n is at index n - 1 */
+   char* namespaces[MAX_TEST_NAMESPACES];
+   unsigned int num_namespaces;
+   int failed;
+
+   /* the triples, one per line */
+   char* triples;
+   size_t triples_length;
+} parse_status;
+
+/**
+ * Appends a triple to the triples of a parse.
+ *
+ * @param status the status of the parse.
+ * @param subject_namespace the namespace of the subject, or NULL.
+ * @param subject the subject.
+ * @param predicate_namespace the namespace of the predicate, or NULL.
+ * @param predicate the predicate.
+ * @param object_namespace the namespace of the object, or NULL.
+ * @param object the object.
+ * @param object_type the type of the object.
+ * @param datatype_namespace the namespace of the datatype, or NULL.
+ * @param datatype the datatype, or NULL.
+ * @param language the language, or NULL.
+ */
+static void append_triple(parse_status* status,
+   const char* subject_namespace, const char* subject,
+   const char* predicate_namespace, const char* predicate,
+   const char* object_namespace, const char* object,
+   rdfresource_t object_type, const char* datatype_namespace,
+   const char* datatype, const char* language)
+{
+   /* the spaces, the object type and the newline fit in 24 characters */
+   size_t length = strlen(subject) + strlen(predicate) + strlen(object) +
+      ((subject_namespace != NULL) ? strlen(subject_namespace) : 0) +
+      ((predicate_namespace != NULL) ? strlen(predicate_namespace) : 0) +
+      ((object_namespace != NULL) ? strlen(object_namespace) : 0) +
+      ((datatype_namespace != NULL) ? strlen(datatype_namespace) : 0) +
+      ((datatype != NULL) ? strlen(datatype) : 0) +
+      ((language != NULL) ? strlen(language) : 0) + 24;
+
+   status->triples = (char*)realloc(
+      status->triples, status->triples_length + length + 1);
+   sprintf(status->triples + status->triples_length,
+      "%s%s %s%s %s%s %d %s%s %s\n",
+      (subject_namespace != NULL) ? subject_namespace : "", subject,
+      (predicate_namespace != NULL) ? predicate_namespace : "", predicate,
+      (object_namespace != NULL) ? object_namespace : "", object,
+      (int)object_type,
+      (datatype_namespace != NULL) ? datatype_namespace : "",
+      (datatype != NULL) ? datatype : "",
+      (language != NULL) ? language : "");
+   status->triples_length += strlen(status->triples + status->triples_length);
+}
+
+/**
+ * Checks that the number of a bnode matches its name.
+ *
+ * @param status the status of the parse.
+ * @param name the name of the subject or object.
+ * @param bnode the number of the subject or object.
+ * @param named 1 if the document named the subject or object, 0 if not.
+ */
+static void check_bnode(
+   parse_status* status, const char* name, size_t bnode, int named)
+{
+   char expected[64];
+
+   if(named)
+   {
+      if(bnode != RDFA_NO_BNODE)
+      {
+         printf("FAIL: the named bnode %s has the bnode number %lu\n",
+            name, (unsigned long)bnode);
+         status->failed = 1;
+      }
+      return;
+   }
+
+   if(bnode != RDFA_NO_BNODE)
+   {
+      sprintf(expected, "_:bnode%lu", (unsigned long)bnode);
+   }
+   else
+   {
+      strcpy(expected, name);
+   }
+
+   if(strcmp(name, expected) != 0 ||
+      (bnode == RDFA_NO_BNODE && strncmp(name, "_:bnode", 7) == 0))
+   {
+      printf("FAIL: %s has the bnode number %lu\n",
+         name, (unsigned long)bnode);
+      status->failed = 1;
+   }
+}
+
+static void default_graph_triple(rdftriple* triple, void* callback_data)
+{
+   parse_status* status = (parse_status*)callback_data;
+   size_t length = strlen(triple->predicate);
+   int named = length >= strlen(NAMED_PREDICATE) && strcmp(
+      triple->predicate + length - strlen(NAMED_PREDICATE),
+      NAMED_PREDICATE) == 0;
+
+   check_bnode(status, triple->subject, triple->subject_bnode, named);
+   if(triple->object_type == RDF_TYPE_IRI)
+   {
+      check_bnode(status, triple->object, triple->object_bnode, named);
+   }
+   append_triple(status,
+      NULL, triple->subject, NULL, triple->predicate, NULL, triple->object,
+      triple->object_type, NULL, triple->datatype, triple->language);
+
+   rdfa_free_triple(triple);
+}
+
+/**
+ * Finds the IRI of a namespace that was announced.
+ *
+ * @param status the status of the parse.
+ * @param namespace_id the id of the namespace.
+ *
+ * @return the namespace, or NULL if it is RDFA_NO_NAMESPACE or wasn't
+ *         announced, which fails the test.
+ */
+static const char* get_namespace(
+   parse_status* status, unsigned int namespace_id)
+{
+   if(namespace_id == RDFA_NO_NAMESPACE)
+   {
+      return NULL;
+   }
+   if(namespace_id > status->num_namespaces)
+   {
+      printf("FAIL: namespace %u was used before it was announced\n",
+         namespace_id);
+      status->failed = 1;
+      return NULL;
+   }
+
+   return status->namespaces[namespace_id - 1];
+}
+
+static void compact_triple(const rdfcompacttriple* triple, void* callback_data)
+{
+   parse_status* status = (parse_status*)callback_data;
+   int named = strcmp(triple->predicate, NAMED_PREDICATE) == 0;
+
+   /* bnodes don't have a namespace, so their names are complete */
+   if(triple->subject_namespace == RDFA_NO_NAMESPACE)
+   {
+      check_bnode(status, triple->subject, triple->subject_bnode, named);
+   }
+   if(triple->object_type == RDF_TYPE_IRI &&
+      triple->object_namespace == RDFA_NO_NAMESPACE)
+   {
+      check_bnode(status, triple->object, triple->object_bnode, named);
+   }
+   append_triple(status,
+      get_namespace(status, triple->subject_namespace), triple->subject,
+      get_namespace(status, triple->predicate_namespace), triple->predicate,
+      get_namespace(status, triple->object_namespace), triple->object,
+      triple->object_type,
+      get_namespace(status, triple->datatype_namespace), triple->datatype,
+      triple->language);
+}
+
+static void announce_namespace(
+   unsigned int namespace_id, const char* iri, void* callback_data)
+{
+   parse_status* status = (parse_status*)callback_data;
+
+   /* the namespaces are numbered in the order in which they are seen */
+   if(namespace_id != status->num_namespaces + 1 ||
+      status->num_namespaces == MAX_TEST_NAMESPACES)
+   {
+      printf("FAIL: namespace %u (%s) was announced out of order\n",
+         namespace_id, iri);
+      status->failed = 1;
+      return;
+   }
+
+   status->namespaces[status->num_namespaces++] = strdup(iri);
+}
+
+/**
+ * Parses the test document.
+ *
+ * @param status the status of the parse.
+ * @param compact 1 to parse with the compact triple handler, 0 to parse
+ *                with the default graph triple handler.
+ */
+static void parse_document(parse_status* status, int compact)
+{
+   rdfacontext* context;
+
+   memset(status, 0, sizeof(parse_status));
+
+   context = test_create_context(
+      BASE_URI, DOCUMENT, &status->document, &default_graph_triple);
+   if(compact)
+   {
+      rdfa_set_compact_triple_handler(
+         context, &announce_namespace, &compact_triple);
+   }
+   test_parse_context(context);
+}
+
+int main(int argc, char** argv)
+{
+   int rval = 0;
+   parse_status expected;
+   parse_status compact;
+   unsigned int i;
+   unsigned int j;
+
+   printf("Running compact triple tests\n");
+
+   parse_document(&expected, 0);
+   parse_document(&compact, 1);
+
+   if(expected.triples == NULL || compact.triples == NULL ||
+      strcmp(expected.triples, compact.triples) != 0)
+   {
+      printf("FAIL: the compact triples differ from the triples\n");
+      printf("expected:\n%s\ncompact:\n%s\n",
+         (expected.triples != NULL) ? expected.triples : "",
+         (compact.triples != NULL) ? compact.triples : "");
+      rval = 1;
+   }
+
+   for(i = 0; i < compact.num_namespaces; i++)
+   {
+      for(j = i + 1; j < compact.num_namespaces; j++)
+      {
+         if(strcmp(compact.namespaces[i], compact.namespaces[j]) == 0)
+         {
+            printf("FAIL: namespace %s was announced twice\n",
+               compact.namespaces[i]);
+            rval = 1;
+         }
+      }
+   }
+
+   if(expected.failed || compact.failed)
+   {
+      rval = 1;
+   }
+
+   printf("%u namespaces were announced\n", compact.num_namespaces);
+
+   for(i = 0; i < compact.num_namespaces; i++)
+   {
+      free(compact.namespaces[i]);
+   }
+   free(expected.triples);
+   free(compact.triples);
+
+   return rval;
+}
@@ -0,0 +1,281 @@
+/*
+ * Copyright 2008-2011 Digital Bazaar, Inc.
+ *
+ * This file is part of librdfa.
+ *
+ * librdfa is Free Software, and can be licensed under any of the
+ * following three licenses:
+ *
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any
+ *      newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE-* at the top of this software distribution for more
+ * information regarding the details of each license.
+ *
+ * This test checks that very large literals that are passed to the
+ * literal chunk handler are the same as the literals that are passed to
+ * the default graph triple handler, and that streaming them keeps the
+ * memory that librdfa uses bounded.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <rdfa.h>
+#include <rdfa_utils.h>
+#include "test_util.h"
+
+#define BASE_URI "http://example.org/literals.html"
+#define LARGE_PREDICATE "http://example.org/vocab#large"
+#define SMALL_PREDICATE "http://example.org/vocab#small"
+
+/* the number of text runs in the large literal */
+#define NUM_TEXT_RUNS 20000
+
+/* the most memory that librdfa may hold at once while streaming */
+#define MAX_STREAMING_MEMORY (256 * 1024)
+
+/* the size of the header that the test allocator puts before each block,
+ * large enough to keep the memory aligned */
+#define HEADER_SIZE 16
+
+/**
+ * The parse status struct keeps track of what the handlers have seen.
+ */
+typedef struct parse_status
+{
+   test_document document;
+
+   /* the large literal, as a triple or as the chunks that made it up */
+   char* large_literal;
+   size_t large_literal_length;
+   int large_literal_triples;
+   int large_literal_ends;
+   int small_literal_triples;
+   int failed;
+
+   /* the memory that is allocated through the allocator */
+   size_t allocated;
+   size_t max_allocated;
+} parse_status;
+
+static void* test_alloc(size_t size, void* user_data)
+{
+   parse_status* status = (parse_status*)user_data;
+   char* rval = (char*)malloc(size + HEADER_SIZE);
+
+   *(size_t*)rval = size;
+   status->allocated += size;
+   if(status->allocated > status->max_allocated)
+   {
+      status->max_allocated = status->allocated;
+   }
+
+   return rval + HEADER_SIZE;
+}
+
+static void* test_realloc(void* ptr, size_t size, void* user_data)
+{
+   parse_status* status = (parse_status*)user_data;
+   char* rval;
+
+   if(ptr == NULL)
+   {
+      return test_alloc(size, user_data);
+   }
+
+   rval = (char*)ptr - HEADER_SIZE;
+   status->allocated -= *(size_t*)rval;
+   rval = (char*)realloc(rval, size + HEADER_SIZE);
+   *(size_t*)rval = size;
+   status->allocated += size;
+   if(status->allocated > status->max_allocated)
+   {
+      status->max_allocated = status->allocated;
+   }
+
+   return rval + HEADER_SIZE;
+}
+
+static void test_free(void* ptr, void* user_data)
+{
+   parse_status* status = (parse_status*)user_data;
+   char* block = (char*)ptr - HEADER_SIZE;
+
+   status->allocated -= *(size_t*)block;
+   free(block);
+}
+
+static void append_to_large_literal(
+   parse_status* status, const char* data, size_t length)
+{
+   status->large_literal = (char*)realloc(
+      status->large_literal, status->large_literal_length + length + 1);
+   memcpy(status->large_literal + status->large_literal_length, data, length);
+   status->large_literal_length += length;
+   status->large_literal[status->large_literal_length] = '\0';
+}
+
+static void default_graph_triple(rdftriple* triple, void* callback_data)
+{
+   parse_status* status = (parse_status*)callback_data;
+
+   if(strcmp(triple->predicate, LARGE_PREDICATE) == 0)
+   {
+      append_to_large_literal(
+         status, triple->object, strlen(triple->object));
+      status->large_literal_triples++;
+   }
+   else if(strcmp(triple->predicate, SMALL_PREDICATE) == 0)
+   {
+      status->small_literal_triples++;
+   }
+
+   rdfa_free_triple(triple);
+}
+
+static void literal_chunk(const rdftriple* triple, const char* chunk,
+   size_t chunk_length, void* callback_data)
+{
+   parse_status* status = (parse_status*)callback_data;
+
+   if(strcmp(triple->predicate, LARGE_PREDICATE) != 0 ||
+      strcmp(triple->subject, BASE_URI "#large") != 0 ||
+      triple->object_type != RDF_TYPE_PLAIN_LITERAL)
+   {
+      printf("FAIL: unexpected streamed literal for <%s> <%s>\n",
+         triple->subject, triple->predicate);
+      status->failed = 1;
+      return;
+   }
+
+   if(chunk == NULL)
+   {
+      status->large_literal_ends++;
+   }
+   else
+   {
+      append_to_large_literal(status, chunk, chunk_length);
+   }
+}
+
+/**
+ * Builds an XHTML document with a very large literal that is made up of
+ * many text runs, entities and child elements, followed by a small
+ * literal that is taken from @content.
+ *
+ * @return the document, which must be freed.
+ */
+static char* create_document(void)
+{
+   const char* header =
+      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      "<html xmlns=\"http://www.w3.org/1999/xhtml\""
+      " prefix=\"ex: http://example.org/vocab#\"><head><title>test</title>"
+      "</head><body><div about=\"#large\" property=\"ex:large\">";
+   const char* text = "Some text &amp; <b>bold text</b> <i>more</i>\n";
+   const char* footer =
+      "</div><p about=\"#small\" property=\"ex:small\" content=\"small\">"
+      "ignored</p></body></html>";
+   size_t length =
+      strlen(header) + (strlen(text) * NUM_TEXT_RUNS) + strlen(footer);
+   char* rval = (char*)malloc(length + 1);
+   char* rptr = rval;
+   int i;
+
+   strcpy(rptr, header);
+   rptr += strlen(header);
+   for(i = 0; i < NUM_TEXT_RUNS; i++)
+   {
+      strcpy(rptr, text);
+      rptr += strlen(text);
+   }
+   strcpy(rptr, footer);
+
+   return rval;
+}
+
+/**
+ * Parses the test document.
+ *
+ * @param status the status to fill in.
+ * @param document the document to parse.
+ * @param stream 1 if the literal chunk handler should be used.
+ */
+static void parse_document(
+   parse_status* status, char* document, int stream)
+{
+   rdfacontext* context;
+
+   memset(status, 0, sizeof(parse_status));
+
+   context = test_create_context(
+      BASE_URI, document, &status->document, &default_graph_triple);
+   rdfa_set_allocator(context, &test_alloc, &test_realloc, &test_free, status);
+   if(stream)
+   {
+      rdfa_set_literal_chunk_handler(context, &literal_chunk);
+   }
+   test_parse_context(context);
+}
+
+int main(int argc, char** argv)
+{
+   int rval = 0;
+   char* document = create_document();
+   parse_status complete;
+   parse_status streamed;
+
+   printf("Running literal streaming tests\n");
+
+   parse_document(&complete, document, 0);
+   parse_document(&streamed, document, 1);
+
+   printf("%lu byte literal, at most %lu bytes held as a triple, "
+      "%lu bytes held when streamed\n",
+      (unsigned long)complete.large_literal_length,
+      (unsigned long)complete.max_allocated,
+      (unsigned long)streamed.max_allocated);
+
+   if(complete.large_literal_triples != 1 ||
+      streamed.large_literal_triples != 0 || streamed.large_literal_ends != 1)
+   {
+      printf("FAIL: the large literal was not streamed exactly once\n");
+      rval = 1;
+   }
+   else if(complete.large_literal_length != streamed.large_literal_length ||
+      memcmp(complete.large_literal, streamed.large_literal,
+         complete.large_literal_length) != 0)
+   {
+      printf("FAIL: the streamed literal differs from the complete one\n");
+      rval = 1;
+   }
+
+   if(complete.small_literal_triples != 1 ||
+      streamed.small_literal_triples != 1)
+   {
+      printf("FAIL: the @content literal was not passed as a triple\n");
+      rval = 1;
+   }
+
+   if(streamed.max_allocated > MAX_STREAMING_MEMORY)
+   {
+      printf("FAIL: streaming the literal used too much memory\n");
+      rval = 1;
+   }
+
+   if(complete.failed || streamed.failed)
+   {
+      rval = 1;
+   }
+
+   free(complete.large_literal);
+   free(streamed.large_literal);
+   free(document);
+
+   return rval;
+}
@@ -0,0 +1,235 @@
+/*
+ * Copyright 2008-2011 Digital Bazaar, Inc.
+ *
+ * This file is part of librdfa.
+ *
+ * librdfa is Free Software, and can be licensed under any of the
+ * following three licenses:
+ *
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any
+ *      newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE-* at the top of this software distribution for more
+ * information regarding the details of each license.
+ *
+ * This test checks how quickly the scan kernels split attribute values
+ * on whitespace, collapse the whitespace of text and sniff the head of a
+ * document, with each of the kernels that the CPU supports. The kernels
+ * must all give the same results.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <rdfa.h>
+#include <rdfa_utils.h>
+#include <rdfa_scan.h>
+
+#define ATTRIBUTE_ITERATIONS 2000000
+#define TEXT_ITERATIONS 20000
+#define HEAD_ITERATIONS 200
+
+/* the number of lines of text and of elements in the head */
+#define TEXT_LINES 40
+#define HEAD_ELEMENTS 1000
+
+/* a @property value as it is often written, with several CURIEs and
+ * terms and some extra whitespace */
+#define ATTRIBUTE_VALUE \
+   "  dc:title foaf:name\n      schema:name rdfs:label   og:title name "
+
+static const char* g_kernel_names[] = { "scalar", "SSE2" };
+
+static const char* const g_needles[] =
+{
+   "-//W3C//DTD XHTML+RDFa 1.0//EN",
+   "-//W3C//DTD XHTML+RDFa 1.1//EN",
+   "<html",
+   "</head>",
+   "</HEAD>",
+   "<base ",
+   "<BASE "
+};
+
+#define NUM_NEEDLES (sizeof(g_needles) / sizeof(g_needles[0]))
+
+/**
+ * The results of a run, which are the same for all kernels.
+ */
+typedef struct scan_results
+{
+   unsigned long tokens;
+   unsigned long collapsed_length;
+   size_t found[NUM_NEEDLES];
+} scan_results;
+
+/**
+ * Builds an indented paragraph of text like the text of an element with
+ * @property.
+ *
+ * @return the text, which must be freed.
+ */
+static char* create_text(void)
+{
+   const char* line =
+      "      The quick brown fox jumps over the lazy dog, and\t then it\n";
+   char* rval = (char*)malloc(strlen(line) * TEXT_LINES + 1);
+   int i;
+
+   rval[0] = '\0';
+   for(i = 0; i < TEXT_LINES; i++)
+   {
+      strcat(rval, line);
+   }
+
+   return rval;
+}
+
+/**
+ * Builds the head of an XHTML+RDFa document without a <base>, as the
+ * parser sniffs it before it starts to parse.
+ *
+ * @return the head, which must be freed.
+ */
+static char* create_head(void)
+{
+   const char* header =
+      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      "<!DOCTYPE html PUBLIC \"-//W3C//DTD XHTML+RDFa 1.1//EN\"\n"
+      "  \"http://www.w3.org/MarkUp/DTD/xhtml-rdfa-2.dtd\">\n"
+      "<html xmlns=\"http://www.w3.org/1999/xhtml\">\n<head>\n";
+   const char* element =
+      "   <meta property=\"dc:creator\" content=\"Some Author\" />\n";
+   char* rval = (char*)malloc(
+      strlen(header) + strlen(element) * HEAD_ELEMENTS + 1);
+   char* rptr = rval;
+   int i;
+
+   strcpy(rptr, header);
+   rptr += strlen(header);
+   for(i = 0; i < HEAD_ELEMENTS; i++)
+   {
+      strcpy(rptr, element);
+      rptr += strlen(element);
+   }
+
+   return rval;
+}
+
+static float seconds_since(clock_t stime)
+{
+   return (float)(clock() - stime) / CLOCKS_PER_SEC;
+}
+
+/**
+ * Runs the benchmarks with the kernels that are in use.
+ *
+ * @param text the text to collapse.
+ * @param head the head to sniff.
+ * @param results set to the results of the run.
+ */
+static void run_benchmarks(
+   const char* text, const char* head, scan_results* results)
+{
+   size_t attribute_length = strlen(ATTRIBUTE_VALUE);
+   size_t text_length = strlen(text);
+   size_t head_length = strlen(head);
+   char* collapsed = (char*)malloc(text_length + 1);
+   const char* found[NUM_NEEDLES];
+   clock_t stime;
+   float delta;
+   size_t n;
+   long i;
+
+   memset(results, 0, sizeof(scan_results));
+
+   stime = clock();
+   for(i = 0; i < ATTRIBUTE_ITERATIONS; i++)
+   {
+      rdfaview rest;
+      rdfaview token;
+
+      rest.data = ATTRIBUTE_VALUE;
+      rest.length = attribute_length;
+      while(rdfa_next_whitespace_token(&rest, &token))
+      {
+         results->tokens++;
+      }
+   }
+   delta = seconds_since(stime);
+   printf("   split %lu byte attribute: %8.1f ns\n",
+      (unsigned long)attribute_length, delta * 1e9 / ATTRIBUTE_ITERATIONS);
+
+   stime = clock();
+   for(i = 0; i < TEXT_ITERATIONS; i++)
+   {
+      results->collapsed_length +=
+         rdfa_collapse_whitespace(collapsed, text, text_length);
+   }
+   delta = seconds_since(stime);
+   printf("   collapse %lu byte text: %8.1f ns\n",
+      (unsigned long)text_length, delta * 1e9 / TEXT_ITERATIONS);
+
+   stime = clock();
+   for(i = 0; i < HEAD_ITERATIONS; i++)
+   {
+      rdfa_find_strings(head, head_length, g_needles, NUM_NEEDLES, found);
+   }
+   delta = seconds_since(stime);
+   printf("   sniff %lu byte head:    %8.1f us\n",
+      (unsigned long)head_length, delta * 1e6 / HEAD_ITERATIONS);
+
+   for(n = 0; n < NUM_NEEDLES; n++)
+   {
+      results->found[n] = (found[n] != NULL) ? (size_t)(found[n] - head) + 1 : 0;
+   }
+
+   free(collapsed);
+}
+
+int main(int argc, char** argv)
+{
+   int rval = 0;
+   char* text = create_text();
+   char* head = create_head();
+   scan_results expected;
+   int kernels;
+
+   printf("Scan speed test...\n");
+
+   for(kernels = RDFA_SCAN_KERNELS_SCALAR; kernels <= RDFA_SCAN_KERNELS_SSE2;
+      kernels++)
+   {
+      scan_results results;
+
+      if(rdfa_use_scan_kernels(kernels) < 0)
+      {
+         printf("%s kernels are not supported\n", g_kernel_names[kernels]);
+         continue;
+      }
+
+      printf("%s kernels:\n", g_kernel_names[kernels]);
+      run_benchmarks(text, head, &results);
+
+      if(kernels == RDFA_SCAN_KERNELS_SCALAR)
+      {
+         expected = results;
+      }
+      else if(memcmp(&results, &expected, sizeof(scan_results)) != 0)
+      {
+         printf("FAIL: the %s kernels gave different results\n",
+            g_kernel_names[kernels]);
+         rval = 1;
+      }
+   }
+
+   free(text);
+   free(head);
+
+   return rval;
+}
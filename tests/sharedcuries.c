@@ -0,0 +1,235 @@
+/*
+ * Copyright 2008-2011 Digital Bazaar, Inc.
+ *
+ * This file is part of librdfa.
+ *
+ * librdfa is Free Software, and can be licensed under any of the
+ * following three licenses:
+ *
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any
+ *      newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE-* at the top of this software distribution for more
+ * information regarding the details of each license.
+ *
+ * This test checks that documents that are parsed with a shared CURIE
+ * cache give the same triples as documents that are parsed without one,
+ * when the documents declare the same prefixes to different IRIs, use
+ * different vocabularies and have different bases, and when they are
+ * parsed in several threads at once.
+ */
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>
+#endif
+#include <rdfa.h>
+#include <rdfa_utils.h>
+#include "test_util.h"
+
+/* the number of threads that parse at once and how often they parse
+ * every document */
+#define NUM_THREADS 4
+#define NUM_ROUNDS 50
+
+/* the number of CURIEs that the shared cache keeps */
+#define SHARED_CACHE_SIZE 64
+
+#define DOCUMENT(prefix, vocab, body) \
+   "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n" \
+   "<html xmlns=\"http://www.w3.org/1999/xhtml\" prefix=\"" prefix "\">" \
+   "<head><title>test</title></head><body vocab=\"" vocab "\">" \
+   body "</body></html>"
+
+#define BODY \
+   "<div about=\"#a\" typeof=\"ex:Thing name\" property=\"ex:name dc:title\"" \
+   " rel=\"ex:knows next\" resource=\"[ex:b]\">a</div>" \
+   "<div about=\"relative\" property=\"name\" content=\"c\"></div>" \
+   "<div prefix=\"ex: http://example.org/inner#\">" \
+   "<p about=\"[ex:c]\" property=\"ex:name\">c</p></div>" \
+   "<p about=\"[ex:d]\" property=\"ex:name\">d</p>"
+
+/**
+ * The test documents, which are parsed in this order with the same
+ * shared cache.
+ */
+static const struct
+{
+   const char* base;
+   const char* document;
+} g_documents[] =
+{
+   { "http://example.org/one.html",
+     DOCUMENT("ex: http://example.org/a# dc: http://purl.org/dc/terms/",
+        "http://example.org/vocab#", BODY) },
+   { "http://example.org/two.html",
+     DOCUMENT("ex: http://example.org/b# dc: http://purl.org/dc/terms/",
+        "http://example.org/vocab#", BODY) },
+   { "http://example.org/dir/three.html",
+     DOCUMENT("ex: http://example.org/a# dc: http://purl.org/dc/terms/",
+        "http://example.org/vocab#", BODY) },
+   { "http://example.org/four.html",
+     DOCUMENT("ex: http://example.org/a# dc: http://purl.org/dc/terms/",
+        "http://example.org/other#", BODY) },
+   { "http://example.org/five.html",
+     DOCUMENT("ex: http://example.org/a#",
+        "http://example.org/vocab#", BODY) }
+};
+
+#define NUM_DOCUMENTS (sizeof(g_documents) / sizeof(g_documents[0]))
+
+/**
+ * The parse status struct keeps track of the document that is parsed and
+ * the triples that it gave.
+ */
+typedef struct parse_status
+{
+   test_document document;
+
+   /* the triples, one per line */
+   char* triples;
+   size_t triples_length;
+} parse_status;
+
+static void append_triple(rdftriple* triple, void* callback_data)
+{
+   parse_status* status = (parse_status*)callback_data;
+   /* the spaces, the object type and the newline fit in 16 characters */
+   size_t length = strlen(triple->subject) + strlen(triple->predicate) +
+      strlen(triple->object) + 16;
+
+   status->triples = (char*)realloc(
+      status->triples, status->triples_length + length + 1);
+   sprintf(status->triples + status->triples_length, "%s %s %s %d\n",
+      triple->subject, triple->predicate, triple->object,
+      (int)triple->object_type);
+   status->triples_length += strlen(status->triples + status->triples_length);
+
+   rdfa_free_triple(triple);
+}
+
+/**
+ * Parses a test document.
+ *
+ * @param index the index of the document to parse.
+ * @param cache the shared CURIE cache to use, or NULL.
+ *
+ * @return the triples of the document, which must be freed.
+ */
+static char* parse_document(size_t index, rdfasharedcuriecache* cache)
+{
+   parse_status status;
+   rdfacontext* context;
+
+   memset(&status, 0, sizeof(parse_status));
+
+   context = test_create_context(g_documents[index].base,
+      g_documents[index].document, &status.document, &append_triple);
+   rdfa_set_shared_curie_cache(context, cache);
+   test_parse_context(context);
+
+   return status.triples;
+}
+
+/**
+ * The expected triples of every document, and the shared cache that the
+ * threads parse with.
+ */
+static char* g_expected[NUM_DOCUMENTS];
+static rdfasharedcuriecache* g_cache = NULL;
+
+/**
+ * Parses all of the documents a number of times with the shared cache.
+ *
+ * @param arg unused.
+ *
+ * @return NULL if the triples were always the expected ones, a non-NULL
+ *         value otherwise.
+ */
+static void* parse_documents(void* arg)
+{
+   void* rval = NULL;
+   int round;
+   size_t i;
+
+   for(round = 0; round < NUM_ROUNDS; round++)
+   {
+      for(i = 0; i < NUM_DOCUMENTS; i++)
+      {
+         char* triples = parse_document(i, g_cache);
+
+         if(triples == NULL || strcmp(triples, g_expected[i]) != 0)
+         {
+            rval = (void*)g_documents[i].base;
+         }
+         free(triples);
+      }
+   }
+
+   return rval;
+}
+
+int main(int argc, char** argv)
+{
+   int rval = 0;
+   size_t i;
+#ifdef HAVE_PTHREAD_H
+   pthread_t threads[NUM_THREADS];
+   int t;
+#endif
+
+   printf("Running shared CURIE cache tests\n");
+
+   for(i = 0; i < NUM_DOCUMENTS; i++)
+   {
+      g_expected[i] = parse_document(i, NULL);
+   }
+
+   /* the documents are parsed in order, so each one finds the CURIEs of
+    * the ones before it in the cache */
+   g_cache = rdfa_create_shared_curie_cache(SHARED_CACHE_SIZE);
+   if(parse_documents(NULL) != NULL)
+   {
+      printf("FAIL: the shared cache changed the triples of a document\n");
+      rval = 1;
+   }
+
+#ifdef HAVE_PTHREAD_H
+   for(t = 0; t < NUM_THREADS; t++)
+   {
+      pthread_create(&threads[t], NULL, &parse_documents, NULL);
+   }
+   for(t = 0; t < NUM_THREADS; t++)
+   {
+      void* result = NULL;
+
+      pthread_join(threads[t], &result);
+      if(result != NULL)
+      {
+         printf("FAIL: the triples of %s changed while parsing in "
+            "threads\n", (const char*)result);
+         rval = 1;
+      }
+   }
+#else
+   printf("Threads are not supported, skipping threaded test\n");
+#endif
+
+   rdfa_free_shared_curie_cache(g_cache);
+   for(i = 0; i < NUM_DOCUMENTS; i++)
+   {
+      free(g_expected[i]);
+   }
+
+   return rval;
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2008-2011 Digital Bazaar, Inc.
+ *
+ * This file is part of librdfa.
+ *
+ * librdfa is Free Software, and can be licensed under any of the
+ * following three licenses:
+ *
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any
+ *      newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE-* at the top of this software distribution for more
+ * information regarding the details of each license.
+ *
+ * This file contains the functions that the tests use to parse a
+ * document from memory.
+ */
+#include <string.h>
+#include <rdfa.h>
+#include <rdfa_utils.h>
+#include "test_util.h"
+
+void test_free_triple(rdftriple* triple, void* callback_data)
+{
+   rdfa_free_triple(triple);
+}
+
+static size_t fill_buffer(char* buffer, size_t buffer_length, void* callback_data)
+{
+   test_document* document = (test_document*)callback_data;
+   size_t rval = document->total_length - document->current_offset;
+
+   if(rval > buffer_length)
+   {
+      rval = buffer_length;
+   }
+   memcpy(buffer, &document->buffer[document->current_offset], rval);
+   document->current_offset += rval;
+
+   return rval;
+}
+
+rdfacontext* test_create_context(const char* base, const char* buffer,
+   test_document* document, triple_handler_fp default_graph_triple)
+{
+   rdfacontext* context;
+
+   document->buffer = buffer;
+   document->current_offset = 0;
+   document->total_length = strlen(buffer);
+
+   context = rdfa_create_context(base);
+   rdfa_set_default_graph_triple_handler(context, default_graph_triple);
+   rdfa_set_processor_graph_triple_handler(context, &test_free_triple);
+   rdfa_set_buffer_filler(context, &fill_buffer);
+   context->callback_data = document;
+
+   return context;
+}
+
+void test_parse_context(rdfacontext* context)
+{
+   rdfa_parse(context);
+   rdfa_free_context(context);
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2008-2011 Digital Bazaar, Inc.
+ *
+ * This file is part of librdfa.
+ *
+ * librdfa is Free Software, and can be licensed under any of the
+ * following three licenses:
+ *
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any
+ *      newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE-* at the top of this software distribution for more
+ * information regarding the details of each license.
+ *
+ * This file contains the functions that the tests use to parse a
+ * document from memory.
+ */
+#ifndef _RDFA_TEST_UTIL_H_
+#define _RDFA_TEST_UTIL_H_
+#include <rdfa.h>
+
+/**
+ * The test document struct keeps track of the document that is parsed
+ * and of how much of it was passed to the parser. It must be the first
+ * member of the data that is passed to the handlers.
+ */
+typedef struct test_document
+{
+   const char* buffer;
+   size_t current_offset;
+   size_t total_length;
+} test_document;
+
+/**
+ * A triple handler that only frees the triple.
+ *
+ * @param triple the triple to free.
+ * @param callback_data unused.
+ */
+void test_free_triple(rdftriple* triple, void* callback_data);
+
+/**
+ * Creates a context that parses a document from memory. The default
+ * graph triples are passed to the given handler and the processor graph
+ * triples are freed. Other handlers can be set on the context before it
+ * is passed to test_parse_context().
+ *
+ * @param base the base IRI of the document.
+ * @param buffer the document, which must be valid until it is parsed.
+ * @param document the struct that keeps track of the document, which is
+ *                 the start of the data that is passed to the handlers.
+ * @param default_graph_triple the default graph triple handler.
+ *
+ * @return the context.
+ */
+rdfacontext* test_create_context(const char* base, const char* buffer,
+   test_document* document, triple_handler_fp default_graph_triple);
+
+/**
+ * Parses the document of a context that was created with
+ * test_create_context() and frees the context.
+ *
+ * @param context the context to parse with.
+ */
+void test_parse_context(rdfacontext* context);
+
+#endif